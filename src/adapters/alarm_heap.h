@@ -0,0 +1,225 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "src/core/alarm_id.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace repowerd
+{
+
+// A 4-ary min-heap of deadlines with lazy cancellation, keyed by any
+// hashable key type. Cancelling only forgets the key, and the stale heap
+// entry is discarded when it reaches the top, or when stale entries
+// outnumber live ones. Keys with equal deadlines are popped in the order
+// they were pushed.
+template <typename Key, typename TimePointType>
+class BasicAlarmHeap
+{
+public:
+    using TimePoint = TimePointType;
+
+    BasicAlarmHeap();
+
+    void push(Key key, TimePoint deadline);
+    // Returns false if there is no live entry with this key
+    bool cancel(Key key);
+
+    // Appends the keys of the live entries with deadline <= now to due, in
+    // deadline order, and removes them from the heap
+    void pop_due(TimePoint now, std::vector<Key>& due);
+
+    // The earliest deadline of a live entry, or TimePoint::max() if none
+    TimePoint next_deadline();
+
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        TimePoint deadline;
+        uint64_t sequence;
+        Key key;
+    };
+
+    static size_t constexpr arity{4};
+    // Don't bother compacting small heaps
+    static size_t constexpr min_compaction_size{64};
+
+    static bool earlier(Entry const& a, Entry const& b);
+
+    void pop_top();
+    void discard_stale_top();
+    void compact();
+    void sift_up(size_t index);
+    void sift_down(size_t index);
+
+    std::vector<Entry> heap;
+    std::unordered_set<Key> live;
+    uint64_t next_sequence;
+};
+
+using AlarmHeap = BasicAlarmHeap<AlarmId, std::chrono::steady_clock::time_point>;
+
+template <typename Key, typename TimePoint>
+BasicAlarmHeap<Key,TimePoint>::BasicAlarmHeap()
+    : next_sequence{0}
+{
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::push(Key key, TimePoint deadline)
+{
+    live.insert(key);
+    heap.push_back({deadline, next_sequence++, key});
+    sift_up(heap.size() - 1);
+
+    if (heap.size() > min_compaction_size && heap.size() > 2 * live.size())
+        compact();
+}
+
+template <typename Key, typename TimePoint>
+bool BasicAlarmHeap<Key,TimePoint>::cancel(Key key)
+{
+    return live.erase(key) > 0;
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::pop_due(TimePoint now, std::vector<Key>& due)
+{
+    discard_stale_top();
+
+    while (!heap.empty() && heap.front().deadline <= now)
+    {
+        due.push_back(heap.front().key);
+        live.erase(heap.front().key);
+        pop_top();
+        discard_stale_top();
+    }
+}
+
+template <typename Key, typename TimePoint>
+TimePoint BasicAlarmHeap<Key,TimePoint>::next_deadline()
+{
+    discard_stale_top();
+
+    return heap.empty() ? TimePoint::max() : heap.front().deadline;
+}
+
+template <typename Key, typename TimePoint>
+size_t BasicAlarmHeap<Key,TimePoint>::size() const
+{
+    return live.size();
+}
+
+template <typename Key, typename TimePoint>
+bool BasicAlarmHeap<Key,TimePoint>::earlier(Entry const& a, Entry const& b)
+{
+    // Keys may wrap around (e.g. AlarmId), so order entries with equal
+    // deadlines by push sequence instead. A 64-bit sequence never wraps
+    // in practice.
+    return a.deadline < b.deadline ||
+           (a.deadline == b.deadline && a.sequence < b.sequence);
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::pop_top()
+{
+    heap.front() = heap.back();
+    heap.pop_back();
+    if (!heap.empty())
+        sift_down(0);
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::discard_stale_top()
+{
+    while (!heap.empty() && live.find(heap.front().key) == live.end())
+        pop_top();
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::compact()
+{
+    size_t live_entries = 0;
+    for (auto const& entry : heap)
+    {
+        if (live.find(entry.key) != live.end())
+            heap[live_entries++] = entry;
+    }
+    heap.resize(live_entries);
+
+    if (heap.size() > 1)
+    {
+        for (size_t i = (heap.size() - 2) / arity + 1; i-- > 0;)
+            sift_down(i);
+    }
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::sift_up(size_t index)
+{
+    auto const entry = heap[index];
+
+    while (index > 0)
+    {
+        auto const parent = (index - 1) / arity;
+        if (!earlier(entry, heap[parent]))
+            break;
+        heap[index] = heap[parent];
+        index = parent;
+    }
+
+    heap[index] = entry;
+}
+
+template <typename Key, typename TimePoint>
+void BasicAlarmHeap<Key,TimePoint>::sift_down(size_t index)
+{
+    auto const entry = heap[index];
+
+    while (true)
+    {
+        auto const first_child = arity * index + 1;
+        if (first_child >= heap.size())
+            break;
+
+        auto const last_child = std::min(first_child + arity, heap.size());
+        auto min_child = first_child;
+        for (auto child = first_child + 1; child < last_child; ++child)
+        {
+            if (earlier(heap[child], heap[min_child]))
+                min_child = child;
+        }
+
+        if (!earlier(heap[min_child], entry))
+            break;
+
+        heap[index] = heap[min_child];
+        index = min_child;
+    }
+
+    heap[index] = entry;
+}
+
+}
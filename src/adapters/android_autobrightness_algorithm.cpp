@@ -225,7 +225,7 @@ void repowerd::AndroidAutobrightnessAlgorithm::schedule_debounce()
 
     log->log(log_tag, "schedule_debounce(), seqnum=%d", debouncing_seqnum);
 
-    event_loop->schedule_in(
+    event_loop->post_in(
         debounce_delay,
         [this, expected_debouncing_seqnum=debouncing_seqnum]
         {
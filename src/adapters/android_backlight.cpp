@@ -24,6 +24,11 @@
 #include <cstring>
 #include <cmath>
 
+namespace
+{
+int const max_brightness = 255;
+}
+
 repowerd::AndroidBacklight::AndroidBacklight()
     : brightness{Backlight::unknown_brightness}
 {
@@ -46,7 +51,7 @@ repowerd::AndroidBacklight::~AndroidBacklight()
 
 void repowerd::AndroidBacklight::set_brightness(double value)
 {
-    int const value_abs = round(value * 255);
+    int const value_abs = round(value * max_brightness);
 
     light_state_t state;
     memset(&state, 0, sizeof(light_state_t));
@@ -63,3 +68,8 @@ double repowerd::AndroidBacklight::get_brightness()
 {
     return brightness;
 }
+
+int repowerd::AndroidBacklight::max_absolute_brightness()
+{
+    return max_brightness;
+}
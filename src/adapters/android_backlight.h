@@ -33,6 +33,7 @@ public:
 
     void set_brightness(double) override;
     double get_brightness() override;
+    int max_absolute_brightness() override;
 
 private:
     light_device_t* light_dev;
@@ -42,6 +42,12 @@ std::string determine_device_name()
     return name;
 }
 
+bool is_config_element(std::string const& element_name)
+{
+    return element_name == "integer" || element_name == "integer-array" ||
+           element_name == "bool" || element_name == "string";
+}
+
 }
 
 repowerd::AndroidDeviceConfig::AndroidDeviceConfig(
@@ -172,7 +178,7 @@ void repowerd::AndroidDeviceConfig::xml_start_element(
     std::string const& element_name,
     std::unordered_map<std::string,std::string> const& attribs)
 {
-    if (element_name != "integer" && element_name != "integer-array" && element_name != "bool")
+    if (!is_config_element(element_name))
         return;
 
     auto iter = attribs.find("name");
@@ -190,7 +196,7 @@ void repowerd::AndroidDeviceConfig::xml_start_element(
 void repowerd::AndroidDeviceConfig::xml_end_element(
     std::string const& element_name)
 {
-    if (element_name != "integer" && element_name != "integer-array" && element_name != "bool")
+    if (!is_config_element(element_name))
         return;
 
     last_config_name = "";
@@ -28,6 +28,9 @@ public:
 
     virtual void set_brightness(double) = 0;
     virtual double get_brightness() = 0;
+    // Relative brightness values are rounded to multiples of
+    // 1 / max_absolute_brightness() by the hardware
+    virtual int max_absolute_brightness() = 0;
 
     static double constexpr unknown_brightness = -1.0;
 
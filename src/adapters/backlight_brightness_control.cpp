@@ -19,19 +19,20 @@
 #include "autobrightness_algorithm.h"
 #include "backlight_brightness_control.h"
 #include "backlight.h"
+#include "brightness_curve.h"
 #include "brightness_params.h"
-#include "chrono.h"
+#include "brightness_transition_trace.h"
 #include "device_quirks.h"
 #include "event_loop_handler_registration.h"
 #include "light_sensor.h"
 
 #include "src/core/log.h"
+#include "src/core/timer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <chrono>
 #include <string>
-#include <thread>
-#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -39,7 +40,7 @@ namespace
 {
 
 char const* const log_tag = "BacklightBrightnessControl";
-auto const null_handler = [](double){};
+auto const null_handler = [](auto...){};
 
 double normal_brightness_percent(repowerd::DeviceConfig const& device_config)
 {
@@ -59,25 +60,42 @@ repowerd::BacklightBrightnessControl::BacklightBrightnessControl(
     std::shared_ptr<Backlight> const& backlight,
     std::shared_ptr<LightSensor> const& light_sensor,
     std::shared_ptr<AutobrightnessAlgorithm> const& autobrightness_algorithm,
-    std::shared_ptr<Chrono> const& chrono,
+    std::shared_ptr<Timer> const& timer,
     std::shared_ptr<Log> const& log,
     DeviceConfig const& device_config,
-    DeviceQuirks const& quirks)
+    DeviceQuirks const& quirks,
+    std::shared_ptr<EventLoop> const& shared_event_loop)
     : backlight{backlight},
       light_sensor{light_sensor},
       autobrightness_algorithm{autobrightness_algorithm},
-      chrono{chrono},
+      timer{timer},
       log{log},
       normal_before_display_on_autobrightness{
           quirks.normal_before_display_on_autobrightness()},
       ab_supported{autobrightness_algorithm->init(event_loop)},
+      transition_planner{
+          BrightnessCurve::from_device_config(device_config),
+          backlight->max_absolute_brightness()},
+      event_loop{shared_event_loop},
       brightness_handler{null_handler},
+      transition_complete_handler{null_handler},
+      next_off_transition_id{no_brightness_transition_id + 1},
       dim_brightness{dim_brightness_percent(device_config)},
       normal_brightness{normal_brightness_percent(device_config)},
       user_normal_brightness{normal_brightness},
       active_brightness_type{ActiveBrightnessType::off},
-      ab_active{false}
+      ab_active{false},
+      transition_start{0.0},
+      transition_current{0.0},
+      transition_target{0.0},
+      transition_id{no_brightness_transition_id},
+      transition_next_step{0},
+      transition_tick_pending{false},
+      transition_tick_alarm_id{AlarmId::invalid}
 {
+    alarm_handler_registration = timer->register_alarm_handler(
+        [this] (AlarmId id) { handle_alarm(id); });
+
     if (ab_supported)
     {
         ab_handler_registration = autobrightness_algorithm->register_autobrightness_handler(
@@ -99,7 +117,7 @@ repowerd::BacklightBrightnessControl::BacklightBrightnessControl(
         light_handler_registration = light_sensor->register_light_handler(
             [this] (double light)
             {
-                event_loop.enqueue(
+                event_loop.post(
                     [this, light]
                     {
                         this->autobrightness_algorithm->new_light_value(light);
@@ -112,7 +130,7 @@ void repowerd::BacklightBrightnessControl::disable_autobrightness()
 {
     if (!ab_supported) return;
 
-    event_loop.enqueue(
+    event_loop.post(
         [this]
         {
             if (ab_active)
@@ -124,14 +142,14 @@ void repowerd::BacklightBrightnessControl::disable_autobrightness()
                 if (active_brightness_type == ActiveBrightnessType::normal)
                     transition_to_brightness_value(normal_brightness, TransitionSpeed::slow);
             }
-        }).get();
+        });
 }
 
 void repowerd::BacklightBrightnessControl::enable_autobrightness()
 {
     if (!ab_supported) return;
 
-    event_loop.enqueue(
+    event_loop.post(
         [this]
         { 
             if (!ab_active)
@@ -143,22 +161,22 @@ void repowerd::BacklightBrightnessControl::enable_autobrightness()
                 }
                 ab_active = true;
             }
-        }).get();
+        });
 }
 
 void repowerd::BacklightBrightnessControl::set_dim_brightness()
 {
-    event_loop.enqueue(
+    event_loop.post(
         [this]
         { 
             transition_to_brightness_value(dim_brightness, TransitionSpeed::normal);
             active_brightness_type = ActiveBrightnessType::dim;
-        }).get();
+        });
 }
 
 void repowerd::BacklightBrightnessControl::set_normal_brightness()
 {
-    event_loop.enqueue(
+    event_loop.post(
         [this]
         { 
             if (ab_active && active_brightness_type == ActiveBrightnessType::off)
@@ -174,12 +192,12 @@ void repowerd::BacklightBrightnessControl::set_normal_brightness()
             }
 
             active_brightness_type = ActiveBrightnessType::normal;
-        }).get();
+        });
 }
 
 void repowerd::BacklightBrightnessControl::set_normal_brightness_value(double v)
 {
-    event_loop.enqueue(
+    event_loop.post(
         [this,v]
         { 
             user_normal_brightness = v;
@@ -188,19 +206,46 @@ void repowerd::BacklightBrightnessControl::set_normal_brightness_value(double v)
                 normal_brightness = user_normal_brightness;
                 transition_to_brightness_value(normal_brightness, TransitionSpeed::normal);
             }
-        }).get();
+        });
 }
 
-void repowerd::BacklightBrightnessControl::set_off_brightness()
+repowerd::BrightnessTransitionId repowerd::BacklightBrightnessControl::set_off_brightness()
 {
-    event_loop.enqueue(
-        [this]
+    auto id = next_off_transition_id++;
+    if (id == no_brightness_transition_id)
+        id = next_off_transition_id++;
+
+    event_loop.post(
+        [this,id]
         { 
-            transition_to_brightness_value(0, TransitionSpeed::normal);
+            transition_to_brightness_value(0, TransitionSpeed::normal, id);
             active_brightness_type = ActiveBrightnessType::off;
             autobrightness_algorithm->stop();
             light_sensor->disable_light_events();
-        }).get();
+        });
+
+    return id;
+}
+
+repowerd::BacklightBrightnessControl::~BacklightBrightnessControl()
+{
+    // Unregister our handlers while the event loop is still running, and
+    // then stop it, so that pending transition ticks don't access members
+    // that have been destroyed
+    { auto const reg = std::move(alarm_handler_registration); }
+    { auto const reg = std::move(ab_handler_registration); }
+    { auto const reg = std::move(light_handler_registration); }
+    event_loop.stop();
+}
+
+repowerd::HandlerRegistration
+repowerd::BacklightBrightnessControl::register_brightness_transition_complete_handler(
+    BrightnessTransitionCompleteHandler const& handler)
+{
+    return EventLoopHandlerRegistration(
+        event_loop,
+        [this,&handler] { transition_complete_handler = handler; },
+        [this] { transition_complete_handler = null_handler; });
 }
 
 repowerd::HandlerRegistration
@@ -213,57 +258,150 @@ repowerd::BacklightBrightnessControl::register_brightness_handler(
         [this] { brightness_handler = null_handler; });
 }
 
+void repowerd::BacklightBrightnessControl::flush()
+{
+    auto const flush_promise = std::make_shared<std::promise<void>>();
+    auto flush_future = flush_promise->get_future();
+
+    event_loop.post(
+        [this,flush_promise]
+        {
+            if (transition_tick_pending)
+                transition_flush_promises.push_back(flush_promise);
+            else
+                flush_promise->set_value();
+        });
+
+    flush_future.wait();
+}
+
+void repowerd::BacklightBrightnessControl::set_transition_trace(
+    std::shared_ptr<BrightnessTransitionTrace> const& trace)
+{
+    event_loop.enqueue([this, trace] { transition_trace = trace; }).wait();
+}
+
 void repowerd::BacklightBrightnessControl::transition_to_brightness_value(
-    double brightness, TransitionSpeed transition_speed)
+    double brightness, TransitionSpeed transition_speed, BrightnessTransitionId id)
 {
-    auto const step = 0.01;
-    auto const backlight_brightness = get_brightness_value();
-    auto const starting_brightness =
-        backlight_brightness == Backlight::unknown_brightness ?
-        brightness - step : backlight_brightness;
-    auto const num_steps = std::ceil(std::fabs(starting_brightness - brightness) / step);
-    auto const step_time = (transition_speed == TransitionSpeed::slow ||
-                            starting_brightness == 0.0
-                            || brightness == 0.0) ?
-                            100000us / num_steps : 1000us;
-
-    if (starting_brightness != brightness)
+    // Retarget an in-flight transition from the value it has reached
+    auto const backlight_brightness =
+        transition_tick_pending ? transition_current : get_brightness_value();
+
+    if (backlight_brightness == brightness)
     {
-        log->log(log_tag, "Transitioning brightness %.2f => %.2f in %.2f steps %.2fus each",
-                 starting_brightness, brightness, num_steps, step_time.count());
+        transition_target = brightness;
+        transition_id = id;
+
+        // Stop an in-flight transition where it is, and let it complete
+        // normally, otherwise we are already done
+        if (transition_tick_pending)
+        {
+            transition_plan = {{0ms, brightness}};
+            transition_next_step = 0;
+            transition_start_time = timer->now();
+        }
+        else
+        {
+            transition_complete_handler(id, brightness);
+        }
+
+        return;
     }
 
-    auto current_brightness = starting_brightness;
+    // If we don't know where we are starting from, just write the target
+    auto plan = backlight_brightness == Backlight::unknown_brightness ?
+        std::vector<BrightnessTransitionStep>{{0ms, brightness}} :
+        transition_planner.plan(backlight_brightness, brightness, transition_speed);
+
+    log->log(log_tag, "Transitioning brightness %.2f => %.2f in %d steps over %dms",
+             backlight_brightness, brightness,
+             static_cast<int>(plan.size()),
+             static_cast<int>(plan.back().time.count()));
+
+    // A retargeted transition still starts where the brightness was last
+    // left, so that only actual changes are reported when it completes
+    if (!transition_tick_pending)
+        transition_start = backlight_brightness;
+    transition_current = backlight_brightness;
+    transition_target = brightness;
+    transition_id = id;
+    transition_plan = std::move(plan);
+    transition_next_step = 0;
+    transition_start_time = timer->now();
+
+    // A pending tick continues with the new plan
+    if (!transition_tick_pending)
+        transition_tick();
+}
+
+void repowerd::BacklightBrightnessControl::transition_tick()
+{
+    transition_tick_pending = false;
+
+    auto const& step = transition_plan[transition_next_step++];
+    auto const brightness = step.brightness;
 
-    if (current_brightness < brightness)
+    // A retargeted plan may start at a value the backlight already has
+    if (transition_planner.absolute_brightness_for(brightness) !=
+        transition_planner.absolute_brightness_for(transition_current))
     {
-        while (current_brightness < brightness)
+        if (transition_trace)
         {
-            current_brightness += step;
-            if (current_brightness > brightness) current_brightness = brightness;
-            set_brightness_value(current_brightness);
-            chrono->sleep_for(std::chrono::duration_cast<std::chrono::nanoseconds>(step_time));
+            auto const write_time = timer->now();
+            set_brightness_value(brightness);
+            transition_trace->record(
+                {transition_target, brightness,
+                 transition_start_time + step.time,
+                 write_time,
+                 timer->now() - write_time});
         }
-    }
-    else if (current_brightness > brightness)
-    {
-        while (current_brightness > brightness)
+        else
         {
-            current_brightness -= step;
-            if (current_brightness < brightness) current_brightness = brightness;
-            set_brightness_value(current_brightness);
-            chrono->sleep_for(std::chrono::duration_cast<std::chrono::nanoseconds>(step_time));
+            set_brightness_value(brightness);
         }
     }
 
-    if (starting_brightness != brightness)
+    transition_current = brightness;
+
+    if (transition_next_step < transition_plan.size())
     {
-        log->log(log_tag, "Transitioning brightness %.2f => %.2f done",
-                 starting_brightness, current_brightness);
+        // Schedule relative to the start of the transition, so that late
+        // ticks don't stretch it
+        auto const next_time =
+            transition_start_time + transition_plan[transition_next_step].time;
+        auto const delay = std::max(
+            0ms,
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_time - timer->now()));
+
+        transition_tick_pending = true;
+        if (delay > 0ms)
+            transition_tick_alarm_id = timer->schedule_alarm_in(delay);
+        else
+            event_loop.post([this] { transition_tick(); });
+        return;
     }
 
-    if (starting_brightness != brightness)
-        brightness_handler(brightness);
+    log->log(log_tag, "Transitioning brightness %.2f => %.2f done",
+             transition_start, transition_current);
+
+    if (transition_current != transition_start)
+        brightness_handler(transition_current);
+    transition_complete_handler(transition_id, transition_current);
+
+    for (auto const& flush_promise : transition_flush_promises)
+        flush_promise->set_value();
+    transition_flush_promises.clear();
+}
+
+void repowerd::BacklightBrightnessControl::handle_alarm(AlarmId id)
+{
+    if (timer->consume_fired_alarm(id) && id == transition_tick_alarm_id)
+    {
+        transition_tick_alarm_id = AlarmId::invalid;
+        transition_tick();
+    }
 }
 
 void repowerd::BacklightBrightnessControl::set_brightness_value(double brightness)
@@ -18,22 +18,29 @@
 
 #pragma once
 
+#include "src/core/alarm_id.h"
 #include "src/core/brightness_control.h"
 #include "brightness_notification.h"
+#include "brightness_transition_planner.h"
 #include "event_loop.h"
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <vector>
 
 namespace repowerd
 {
 
 class AutobrightnessAlgorithm;
 class Backlight;
-class Chrono;
+class BrightnessTransitionTrace;
 class DeviceConfig;
 class DeviceQuirks;
 class LightSensor;
 class Log;
+class Timer;
 
 class BacklightBrightnessControl : public BrightnessControl, public BrightnessNotification
 {
@@ -42,46 +49,88 @@ public:
         std::shared_ptr<Backlight> const& backlight,
         std::shared_ptr<LightSensor> const& light_sensor,
         std::shared_ptr<AutobrightnessAlgorithm> const& autobrightness_algorithm,
-        std::shared_ptr<Chrono> const& chrono,
+        std::shared_ptr<Timer> const& timer,
         std::shared_ptr<Log> const& log,
         DeviceConfig const& device_config,
-        DeviceQuirks const& device_quirks);
+        DeviceQuirks const& device_quirks,
+        std::shared_ptr<EventLoop> const& shared_event_loop);
+    ~BacklightBrightnessControl();
 
+    // Brightness changes are requested asynchronously, and performed as
+    // transitions driven by timer alarms. Requests are handled on the thread
+    // of shared_event_loop, and the timer must call its alarm handler on
+    // that thread too, so that transition ticks run without another hop.
+    // The timer must not be used by anyone else, since it serves a single
+    // alarm handler. A new request retargets any in-flight transition from
+    // its current value.
     void disable_autobrightness() override;
     void enable_autobrightness() override;
     void set_dim_brightness() override;
     void set_normal_brightness() override;
     void set_normal_brightness_value(double) override;
-    void set_off_brightness() override;
+    BrightnessTransitionId set_off_brightness() override;
 
+    HandlerRegistration register_brightness_transition_complete_handler(
+        BrightnessTransitionCompleteHandler const& handler) override;
+
+    // The brightness handler is only called when a completed transition has
+    // actually changed the brightness
     HandlerRegistration register_brightness_handler(
         BrightnessHandler const& handler) override;
 
+    // Waits until all requests have been handled and the resulting
+    // transitions have completed
+    void flush();
+
+    // Records every backlight write made by transitions in the trace, or
+    // stops recording if the trace is null (the default)
+    void set_transition_trace(std::shared_ptr<BrightnessTransitionTrace> const& trace);
+
 private:
     enum class ActiveBrightnessType {normal, dim, off};
-    enum class TransitionSpeed {normal, slow};
-    void transition_to_brightness_value(double brightness, TransitionSpeed transition_speed);
+    using TransitionSpeed = BrightnessTransitionPlanner::Speed;
+    void transition_to_brightness_value(
+        double brightness, TransitionSpeed transition_speed,
+        BrightnessTransitionId id = no_brightness_transition_id);
+    void transition_tick();
+    void handle_alarm(AlarmId id);
     void set_brightness_value(double brightness);
     double get_brightness_value();
 
     std::shared_ptr<Backlight> const backlight;
     std::shared_ptr<LightSensor> const light_sensor;
     std::shared_ptr<AutobrightnessAlgorithm> const autobrightness_algorithm;
-    std::shared_ptr<Chrono> const chrono;
+    std::shared_ptr<Timer> const timer;
     std::shared_ptr<Log> const log;
     bool const normal_before_display_on_autobrightness;
     bool const ab_supported;
+    BrightnessTransitionPlanner const transition_planner;
 
     EventLoop event_loop;
+    HandlerRegistration alarm_handler_registration;
     HandlerRegistration light_handler_registration;
     HandlerRegistration ab_handler_registration;
     BrightnessHandler brightness_handler;
+    BrightnessTransitionCompleteHandler transition_complete_handler;
+    std::atomic<BrightnessTransitionId> next_off_transition_id;
 
     double dim_brightness;
     double normal_brightness;
     double user_normal_brightness;
     ActiveBrightnessType active_brightness_type;
     bool ab_active;
+
+    double transition_start;
+    double transition_current;
+    double transition_target;
+    BrightnessTransitionId transition_id;
+    std::vector<BrightnessTransitionStep> transition_plan;
+    size_t transition_next_step;
+    std::chrono::steady_clock::time_point transition_start_time;
+    bool transition_tick_pending;
+    AlarmId transition_tick_alarm_id;
+    std::shared_ptr<BrightnessTransitionTrace> transition_trace;
+    std::vector<std::shared_ptr<std::promise<void>>> transition_flush_promises;
 };
 
 }
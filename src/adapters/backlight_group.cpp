@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "backlight_group.h"
+#include "device_config.h"
+
+#include <cmath>
+
+namespace
+{
+
+double string_to_double(std::string const& value, double default_value)
+{
+    try { return std::stod(value); }
+    catch (...) { return default_value; }
+}
+
+int absolute_brightness_for(repowerd::Backlight& backlight, double brightness)
+{
+    return static_cast<int>(std::round(brightness * backlight.max_absolute_brightness()));
+}
+
+}
+
+repowerd::BacklightGroupMember repowerd::BacklightGroupMember::from_device_config(
+    std::shared_ptr<Backlight> const& backlight,
+    DeviceConfig const& device_config,
+    std::string const& name)
+{
+    auto const ratio_str = device_config.get(name + "Ratio", "1.0");
+
+    BacklightGroupMember member{
+        backlight,
+        BrightnessCurve::from_device_config(device_config, name),
+        string_to_double(ratio_str, 1.0)};
+
+    if (!(member.ratio >= 0.0))
+        member.ratio = 1.0;
+
+    return member;
+}
+
+repowerd::BacklightGroup::BacklightGroup(
+    std::shared_ptr<Backlight> const& primary,
+    BrightnessCurve const& primary_curve,
+    std::vector<BacklightGroupMember> const& secondaries)
+    : primary{primary},
+      primary_curve{primary_curve},
+      secondaries{secondaries},
+      secondary_abs_brightness(secondaries.size(), -1),
+      secondary_overridden(secondaries.size(), false)
+{
+}
+
+void repowerd::BacklightGroup::set_brightness(double value)
+{
+    primary->set_brightness(value);
+
+    auto const lightness = primary_curve.lightness_for(value);
+
+    for (size_t i = 0; i < secondaries.size(); ++i)
+    {
+        auto const& member = secondaries[i];
+        auto const brightness = member.curve.brightness_for(member.ratio * lightness);
+        auto const abs_brightness = absolute_brightness_for(*member.backlight, brightness);
+
+        if (value == 0.0)
+        {
+            // Turning off the display turns off all secondaries, including
+            // overridden ones, which we drive again from now on
+            secondary_overridden[i] = false;
+        }
+        else
+        {
+            if (secondary_overridden[i] || abs_brightness == secondary_abs_brightness[i])
+                continue;
+
+            // Someone else (e.g. the user) has changed the secondary since
+            // our last write, so leave it alone until the display turns off
+            if (secondary_abs_brightness[i] >= 0 &&
+                absolute_brightness_for(*member.backlight, member.backlight->get_brightness()) !=
+                    secondary_abs_brightness[i])
+            {
+                secondary_overridden[i] = true;
+                continue;
+            }
+        }
+
+        member.backlight->set_brightness(brightness);
+        secondary_abs_brightness[i] = abs_brightness;
+    }
+}
+
+double repowerd::BacklightGroup::get_brightness()
+{
+    return primary->get_brightness();
+}
+
+int repowerd::BacklightGroup::max_absolute_brightness()
+{
+    return primary->max_absolute_brightness();
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "backlight.h"
+#include "brightness_curve.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace repowerd
+{
+
+class DeviceConfig;
+
+struct BacklightGroupMember
+{
+    // Reads the member's curve and ratio from the <name>Curve,
+    // <name>CurveGamma and <name>Ratio entries
+    static BacklightGroupMember from_device_config(
+        std::shared_ptr<Backlight> const& backlight,
+        DeviceConfig const& device_config,
+        std::string const& name);
+
+    std::shared_ptr<Backlight> backlight;
+    // The member's brightness is curve.brightness_for(ratio * L), where L
+    // is the perceived lightness of the group's brightness
+    BrightnessCurve curve;
+    double ratio;
+};
+
+// Drives secondary backlights (e.g. keyboard LEDs) along with a primary
+// (display) backlight, so that every brightness write, and therefore every
+// transition step, applies to the whole group at once. The group reports
+// the brightness and resolution of the primary backlight.
+//
+// A secondary whose brightness has been changed by someone else (e.g. the
+// user) since we last wrote it is left alone until the display is turned
+// off, at which point all secondaries are turned off and driven again.
+class BacklightGroup : public Backlight
+{
+public:
+    BacklightGroup(
+        std::shared_ptr<Backlight> const& primary,
+        BrightnessCurve const& primary_curve,
+        std::vector<BacklightGroupMember> const& secondaries);
+
+    void set_brightness(double) override;
+    double get_brightness() override;
+    int max_absolute_brightness() override;
+
+private:
+    std::shared_ptr<Backlight> const primary;
+    BrightnessCurve const primary_curve;
+    std::vector<BacklightGroupMember> const secondaries;
+    // Secondaries usually have only a few levels, so we write them only when
+    // their absolute value changes
+    std::vector<int> secondary_abs_brightness;
+    std::vector<bool> secondary_overridden;
+};
+
+}
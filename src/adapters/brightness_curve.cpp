@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "brightness_curve.h"
+
+#include "device_config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+
+double const default_gamma = 2.2;
+
+// CIE 1976 L* is linear below this relative luminance, and cube-root above it
+double const cie_linear_threshold = 216.0 / 24389.0;
+double const cie_linear_slope = 24389.0 / 27.0;
+
+double string_to_double(std::string const& value, double default_value)
+{
+    try { return std::stod(value); }
+    catch (...) { return default_value; }
+}
+
+double clamp_unit(double v)
+{
+    return std::min(1.0, std::max(0.0, v));
+}
+
+}
+
+repowerd::BrightnessCurve repowerd::BrightnessCurve::from_device_config(
+    DeviceConfig const& device_config)
+{
+    return from_device_config(device_config, "brightnessTransition");
+}
+
+repowerd::BrightnessCurve repowerd::BrightnessCurve::from_device_config(
+    DeviceConfig const& device_config, std::string const& name)
+{
+    auto const type_str = device_config.get(name + "Curve", "cie");
+    auto const gamma_str = device_config.get(name + "CurveGamma", "2.2");
+
+    BrightnessCurve curve;
+
+    if (type_str == "linear")
+        curve.type = Type::linear;
+    else if (type_str == "gamma")
+        curve.type = Type::gamma;
+    else
+        curve.type = Type::cie_lightness;
+
+    curve.gamma = string_to_double(gamma_str, default_gamma);
+    if (!(curve.gamma > 0.0))
+        curve.gamma = default_gamma;
+
+    return curve;
+}
+
+double repowerd::BrightnessCurve::lightness_for(double brightness) const
+{
+    brightness = clamp_unit(brightness);
+
+    switch (type)
+    {
+    case Type::linear:
+        return brightness;
+    case Type::gamma:
+        return std::pow(brightness, 1.0 / gamma);
+    case Type::cie_lightness:
+        break;
+    }
+
+    if (brightness <= cie_linear_threshold)
+        return brightness * cie_linear_slope / 100.0;
+    else
+        return (116.0 * std::cbrt(brightness) - 16.0) / 100.0;
+}
+
+double repowerd::BrightnessCurve::brightness_for(double lightness) const
+{
+    lightness = clamp_unit(lightness);
+
+    switch (type)
+    {
+    case Type::linear:
+        return lightness;
+    case Type::gamma:
+        return std::pow(lightness, gamma);
+    case Type::cie_lightness:
+        break;
+    }
+
+    auto const l = lightness * 100.0;
+
+    if (l <= cie_linear_threshold * cie_linear_slope)
+        return l / cie_linear_slope;
+
+    auto const f = (l + 16.0) / 116.0;
+    return f * f * f;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include <string>
+
+namespace repowerd
+{
+
+class DeviceConfig;
+
+// Maps relative backlight brightness (light output) to perceived lightness,
+// both in [0.0, 1.0], so that transitions can be planned in the domain the
+// eye actually sees
+struct BrightnessCurve
+{
+    enum class Type {linear, cie_lightness, gamma};
+
+    static BrightnessCurve from_device_config(DeviceConfig const&);
+    // Reads the curve from the <name>Curve and <name>CurveGamma entries
+    static BrightnessCurve from_device_config(
+        DeviceConfig const&, std::string const& name);
+
+    double lightness_for(double brightness) const;
+    double brightness_for(double lightness) const;
+
+    Type type;
+    double gamma;
+};
+
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "brightness_transition_planner.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Normal speed transitions cover this much perceived lightness per ms
+double const lightness_per_ms = 0.01;
+// Steps larger than this may be noticeable mid-fade
+double const max_lightness_step = 0.02;
+auto const fixed_transition_time = 100ms;
+
+}
+
+repowerd::BrightnessTransitionPlanner::BrightnessTransitionPlanner(
+    BrightnessCurve const& curve,
+    int max_absolute_brightness)
+    : curve{curve},
+      max_absolute_brightness{std::max(1, max_absolute_brightness)}
+{
+}
+
+std::vector<repowerd::BrightnessTransitionStep>
+repowerd::BrightnessTransitionPlanner::plan(
+    double start, double target, Speed speed) const
+{
+    std::vector<BrightnessTransitionStep> steps;
+
+    if (start == target)
+        return steps;
+
+    auto const start_lightness = curve.lightness_for(start);
+    auto const delta_lightness = curve.lightness_for(target) - start_lightness;
+
+    // Slow transitions and transitions from/to zero take a fixed time
+    std::chrono::milliseconds duration{
+        static_cast<int64_t>(std::ceil(std::fabs(delta_lightness) / lightness_per_ms))};
+
+    if (speed == Speed::slow || start == 0.0 || target == 0.0)
+        duration = fixed_transition_time;
+
+    auto const num_steps = std::max<int64_t>(
+        1,
+        std::min<int64_t>(
+            std::ceil(std::fabs(delta_lightness) / max_lightness_step),
+            duration.count()));
+
+    auto prev_abs = absolute_brightness_for(start);
+
+    for (int64_t i = 1; i <= num_steps; ++i)
+    {
+        auto const last = i == num_steps;
+        auto const brightness = last ? target :
+            curve.brightness_for(start_lightness + delta_lightness * i / num_steps);
+        auto const abs = absolute_brightness_for(brightness);
+
+        if (abs == prev_abs)
+        {
+            // Make sure the plan ends at the exact target value
+            if (last && !steps.empty())
+                steps.back().brightness = target;
+            else if (last)
+                steps.push_back({0ms, target});
+            continue;
+        }
+
+        auto const time = num_steps > 1 ?
+            duration * (i - 1) / (num_steps - 1) : 0ms;
+
+        steps.push_back({time, brightness});
+        prev_abs = abs;
+    }
+
+    return steps;
+}
+
+int repowerd::BrightnessTransitionPlanner::absolute_brightness_for(
+    double brightness) const
+{
+    return static_cast<int>(std::round(brightness * max_absolute_brightness));
+}
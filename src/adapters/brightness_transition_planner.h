@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "brightness_curve.h"
+
+#include <chrono>
+#include <vector>
+
+namespace repowerd
+{
+
+struct BrightnessTransitionStep
+{
+    // Offset of the write from the start of the transition
+    std::chrono::milliseconds time;
+    double brightness;
+};
+
+class BrightnessTransitionPlanner
+{
+public:
+    enum class Speed {normal, slow};
+
+    BrightnessTransitionPlanner(
+        BrightnessCurve const& curve,
+        int max_absolute_brightness);
+
+    // Plans the backlight writes for a transition. Steps are spaced uniformly
+    // in perceived lightness, and only steps that change the backlight's
+    // absolute value are kept, so the plan contains at most one write per
+    // distinct absolute value and at most one write per ms. The first write
+    // happens immediately, and the last one writes the exact target value.
+    std::vector<BrightnessTransitionStep> plan(
+        double start, double target, Speed speed) const;
+
+    int absolute_brightness_for(double brightness) const;
+
+private:
+    BrightnessCurve const curve;
+    int const max_absolute_brightness;
+};
+
+}
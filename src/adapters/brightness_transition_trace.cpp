@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "brightness_transition_trace.h"
+
+#include <algorithm>
+
+repowerd::BrightnessTransitionTrace::BrightnessTransitionTrace(size_t capacity)
+    : capacity{std::max<size_t>(capacity, 1)},
+      next{0},
+      recorded{0}
+{
+    ring.reserve(this->capacity);
+}
+
+void repowerd::BrightnessTransitionTrace::record(BrightnessTransitionTraceStep const& step)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (ring.size() < capacity)
+        ring.push_back(step);
+    else
+        ring[next] = step;
+
+    next = (next + 1) % capacity;
+    ++recorded;
+}
+
+std::vector<repowerd::BrightnessTransitionTraceStep>
+repowerd::BrightnessTransitionTrace::steps() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (ring.size() < capacity)
+        return ring;
+
+    std::vector<BrightnessTransitionTraceStep> ordered;
+    ordered.reserve(capacity);
+    ordered.insert(ordered.end(), ring.begin() + next, ring.end());
+    ordered.insert(ordered.end(), ring.begin(), ring.begin() + next);
+    return ordered;
+}
+
+uint64_t repowerd::BrightnessTransitionTrace::total_recorded() const
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return recorded;
+}
+
+void repowerd::BrightnessTransitionTrace::clear()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    ring.clear();
+    next = 0;
+    recorded = 0;
+}
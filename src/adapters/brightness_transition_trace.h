@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace repowerd
+{
+
+struct BrightnessTransitionTraceStep
+{
+    // The brightness the transition is heading to
+    double target;
+    // The brightness written in this step
+    double brightness;
+    // When the step was planned to be written
+    std::chrono::steady_clock::time_point scheduled_time;
+    // When the write started, and how long it took
+    std::chrono::steady_clock::time_point write_time;
+    std::chrono::nanoseconds write_duration;
+};
+
+// Keeps the most recent backlight writes made by brightness transitions,
+// overwriting the oldest ones when full. Steps are recorded by the event
+// loop thread of the brightness control, and can be read from any thread.
+class BrightnessTransitionTrace
+{
+public:
+    explicit BrightnessTransitionTrace(size_t capacity);
+
+    void record(BrightnessTransitionTraceStep const& step);
+
+    // Returns the kept steps, oldest first
+    std::vector<BrightnessTransitionTraceStep> steps() const;
+    // Returns the number of steps recorded, including overwritten ones
+    uint64_t total_recorded() const;
+    void clear();
+
+private:
+    BrightnessTransitionTrace(BrightnessTransitionTrace const&) = delete;
+    BrightnessTransitionTrace& operator=(BrightnessTransitionTrace const&) = delete;
+
+    size_t const capacity;
+    mutable std::mutex mutex;
+    std::vector<BrightnessTransitionTraceStep> ring;
+    size_t next;
+    uint64_t recorded;
+};
+
+}
@@ -25,7 +25,7 @@ repowerd::DBusConnectionHandle::DBusConnectionHandle(std::string const& address)
 {
     repowerd::ScopedGError error;
 
-    connection = g_dbus_connection_new_for_address_sync(
+    auto const raw_connection = g_dbus_connection_new_for_address_sync(
         address.c_str(),
         GDBusConnectionFlags(
             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION |
@@ -34,17 +34,20 @@ repowerd::DBusConnectionHandle::DBusConnectionHandle(std::string const& address)
         nullptr,
         error);
 
-    if (!connection)
+    if (!raw_connection)
     {
         throw std::runtime_error(
             "Failed to connect to DBus bus with address '" +
                 address + "': " + error.message_str());
     }
-}
 
-repowerd::DBusConnectionHandle::~DBusConnectionHandle()
-{
-    g_dbus_connection_close_sync(connection, nullptr, nullptr);
+    connection = std::shared_ptr<GDBusConnection>(
+        raw_connection,
+        [] (GDBusConnection* c)
+        {
+            g_dbus_connection_close_sync(c, nullptr, nullptr);
+            g_object_unref(c);
+        });
 }
 
 void repowerd::DBusConnectionHandle::request_name(char const* name) const
@@ -57,7 +60,7 @@ void repowerd::DBusConnectionHandle::request_name(char const* name) const
     auto const null_cancellable = nullptr;
 
     auto result = g_dbus_connection_call_sync(
-        connection,
+        connection.get(),
         "org.freedesktop.DBus",
         "/org/freedesktop/DBus",
         "org.freedesktop.DBus",
@@ -91,5 +94,5 @@ void repowerd::DBusConnectionHandle::request_name(char const* name) const
 
 repowerd::DBusConnectionHandle::operator GDBusConnection*() const
 {
-    return connection;
+    return connection.get();
 }
@@ -20,26 +20,25 @@
 
 #include <gio/gio.h>
 
+#include <memory>
 #include <string>
 
 namespace repowerd
 {
 
+// Copies of a DBusConnectionHandle share the same underlying connection,
+// which is closed when the last copy is destroyed
 class DBusConnectionHandle
 {
 public:
     DBusConnectionHandle(std::string const& address);
-    ~DBusConnectionHandle();
 
     void request_name(char const* name) const;
 
     operator GDBusConnection*() const;
 
 private:
-    DBusConnectionHandle(DBusConnectionHandle const&) = delete;
-    DBusConnectionHandle& operator=(DBusConnectionHandle const&) = delete;
-
-    GDBusConnection* connection;
+    std::shared_ptr<GDBusConnection> connection;
 };
 
 }
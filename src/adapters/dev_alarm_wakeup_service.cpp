@@ -52,7 +52,6 @@ repowerd::DevAlarmWakeupService::DevAlarmWakeupService(
     : filesystem{filesystem},
       dev_alarm_fd{filesystem->open("/dev/alarm", O_RDWR)},
       running{true},
-      next_cookie{1},
       wakeup_handler{null_handler}
 {
     if (dev_alarm_fd == -1)
@@ -72,13 +71,17 @@ repowerd::DevAlarmWakeupService::DevAlarmWakeupService(
                     *this->filesystem, dev_alarm_fd, ANDROID_ALARM_WAIT, nullptr,
                     "Failed to wait for alarm on /dev/alarm");
                 lock.lock();
-                if (running && !wakeups.empty())
+                batch.clear();
+                if (running)
+                    wakeups.pop_next_batch(batch);
+                if (!batch.empty())
                 {
-                    auto const wakeup = *wakeups.begin();
-                    wakeups.erase(wakeups.begin());
+                    std::vector<std::string> cookies;
+                    for (auto const cookie : batch)
+                        cookies.push_back(std::to_string(cookie));
                     auto const handler = wakeup_handler;
                     lock.unlock();
-                    handler(wakeup.second);
+                    handler(cookies);
                     lock.lock();
                 }
                 reset_hardware_alarm();
@@ -98,30 +101,37 @@ repowerd::DevAlarmWakeupService::~DevAlarmWakeupService()
 
 std::string repowerd::DevAlarmWakeupService::schedule_wakeup_at(
     std::chrono::system_clock::time_point tp)
+{
+    return schedule_wakeup_at(tp, std::chrono::milliseconds{0});
+}
+
+std::string repowerd::DevAlarmWakeupService::schedule_wakeup_at(
+    std::chrono::system_clock::time_point tp,
+    std::chrono::milliseconds tolerance)
 {
     std::lock_guard<std::mutex> lock{wakeup_mutex};
 
-    auto const cookie = std::to_string(next_cookie++);
-    wakeups.insert({tp, cookie});
+    auto const deadline_before = wakeups.next_deadline();
+    auto const cookie = wakeups.push(tp, tolerance);
 
-    reset_hardware_alarm();
-    return cookie;
+    // Only reprogram the hardware alarm if the next resume time changed
+    if (wakeups.next_deadline() != deadline_before)
+        reset_hardware_alarm();
+
+    return std::to_string(cookie);
 }
 
 void repowerd::DevAlarmWakeupService::cancel_wakeup(std::string const& cookie)
 {
     std::lock_guard<std::mutex> lock{wakeup_mutex};
 
-    for (auto iter = wakeups.begin(); iter != wakeups.end(); ++iter)
+    auto const deadline_before = wakeups.next_deadline();
+
+    if (wakeups.cancel(parse_wakeup_cookie(cookie)) &&
+        wakeups.next_deadline() != deadline_before)
     {
-        if (iter->second == cookie)
-        {
-            wakeups.erase(iter);
-            break;
-        }
+        reset_hardware_alarm();
     }
-
-    reset_hardware_alarm();
 }
 
 repowerd::HandlerRegistration repowerd::DevAlarmWakeupService::register_wakeup_handler(
@@ -157,13 +167,14 @@ void repowerd::DevAlarmWakeupService::reset_hardware_alarm()
 
     if (running)
     {
-        if (wakeups.empty())
+        auto const next_deadline = wakeups.next_deadline();
+        if (next_deadline == system_clock::time_point::max())
         {
             next_wakeup = to_timespec(system_clock::now() + std::chrono::hours(24 * 30));
         }
         else
         {
-            next_wakeup = to_timespec(wakeups.begin()->first);
+            next_wakeup = to_timespec(next_deadline);
         }
     }
     else
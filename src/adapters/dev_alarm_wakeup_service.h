@@ -19,10 +19,11 @@
 #pragma once
 
 #include "wakeup_service.h"
+#include "wakeup_queue.h"
 #include "fd.h"
 
-#include <map>
 #include <thread>
+#include <vector>
 #include <mutex>
 
 namespace repowerd
@@ -36,6 +37,9 @@ public:
     ~DevAlarmWakeupService();
 
     std::string schedule_wakeup_at(std::chrono::system_clock::time_point tp) override;
+    std::string schedule_wakeup_at(
+        std::chrono::system_clock::time_point tp,
+        std::chrono::milliseconds tolerance) override;
     void cancel_wakeup(std::string const& cookie) override;
 
     HandlerRegistration register_wakeup_handler(
@@ -50,9 +54,9 @@ private:
 
     std::mutex wakeup_mutex;
     bool running;
-    uint64_t next_cookie;
     WakeupHandler wakeup_handler;
-    std::multimap<std::chrono::system_clock::time_point,std::string> wakeups;
+    WakeupQueue wakeups;
+    std::vector<WakeupQueue::Cookie> batch;
 };
 
 }
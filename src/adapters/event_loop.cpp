@@ -17,15 +17,206 @@
  */
 
 #include "event_loop.h"
+#include "fd.h"
+
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/eventfd.h>
+
+namespace
+{
+
+int create_eventfd()
+{
+    auto const fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0)
+        throw std::system_error{errno, std::system_category(), "Failed to create eventfd"};
+    return fd;
+}
+
+}
+
+// A lock-free, intrusive, multi-producer/single-consumer queue of work.
+// Producers write to the eventfd only when they add work to an empty
+// queue, and the consumer takes all queued work at once and runs it in
+// FIFO order.
+struct repowerd::EventLoopWorkQueue
+{
+    struct Work
+    {
+        Work(std::function<void()> const& callback)
+            : next{nullptr}, callback{callback}
+        {
+        }
+        virtual ~Work() = default;
+
+        virtual void run()
+        {
+            try
+            {
+                callback();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        Work* next;
+        std::function<void()> const callback;
+    };
+
+    struct TrackedWork : Work
+    {
+        using Work::Work;
+
+        void run() override
+        {
+            try
+            {
+                callback();
+                done.set_value();
+            }
+            catch (...)
+            {
+                done.set_exception(std::current_exception());
+            }
+        }
+
+        std::promise<void> done;
+    };
+
+    EventLoopWorkQueue()
+        : wakeup_fd{create_eventfd()},
+          head{nullptr},
+          stopped{false}
+    {
+    }
+
+    ~EventLoopWorkQueue()
+    {
+        delete_all(head.exchange(nullptr));
+    }
+
+    void push(Work* work)
+    {
+        auto old_head = head.load(std::memory_order_relaxed);
+
+        do
+        {
+            work->next = old_head;
+        }
+        while (!head.compare_exchange_weak(
+                   old_head, work,
+                   std::memory_order_release, std::memory_order_relaxed));
+
+        if (!old_head)
+        {
+            uint64_t const one{1};
+            while (write(wakeup_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+        }
+    }
+
+    void run_pending()
+    {
+        uint64_t count;
+        while (read(wakeup_fd, &count, sizeof(count)) < 0 && errno == EINTR) {}
+
+        // Work is pushed at the head, so reverse it to run it in FIFO order
+        Work* pending{nullptr};
+        auto work = head.exchange(nullptr, std::memory_order_acquire);
+        while (work)
+        {
+            auto const next = work->next;
+            work->next = pending;
+            pending = work;
+            work = next;
+        }
+
+        while (pending)
+        {
+            auto const next = pending->next;
+            if (!stopped)
+                pending->run();
+            delete pending;
+            pending = next;
+        }
+    }
+
+    static void delete_all(Work* work)
+    {
+        while (work)
+        {
+            auto const next = work->next;
+            delete work;
+            work = next;
+        }
+    }
+
+    Fd const wakeup_fd;
+    std::atomic<Work*> head;
+    // Set when a sharing loop is stopped, possibly by work in the batch
+    // being run. Only accessed from the thread running the main context.
+    bool stopped;
+};
+
+struct repowerd::EventLoopAttachedSources
+{
+    void add(GSource* gsource)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        sources.insert(gsource);
+    }
+
+    void remove(GSource* gsource)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        sources.erase(gsource);
+    }
+
+    // Must be called from the thread running the main context, so that
+    // no source can be dispatched while it is being destroyed
+    void destroy_all()
+    {
+        std::vector<GSource*> sources_to_destroy;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for (auto const gsource : sources)
+                sources_to_destroy.push_back(g_source_ref(gsource));
+        }
+
+        for (auto const gsource : sources_to_destroy)
+        {
+            g_source_destroy(gsource);
+            g_source_unref(gsource);
+        }
+    }
+
+    std::mutex mutex;
+    std::unordered_set<GSource*> sources;
+};
 
 namespace
 {
 
 struct GSourceContext
 {
-    GSourceContext(std::function<void()> const& callback)
-        : callback{callback}
+    GSourceContext(
+        std::function<void()> const& callback,
+        GSource* gsource,
+        std::shared_ptr<repowerd::EventLoopAttachedSources> const& attached_sources)
+        : callback{callback},
+          gsource{gsource},
+          attached_sources{attached_sources}
     {
+        if (attached_sources)
+            attached_sources->add(gsource);
     }
 
     static gboolean static_call(GSourceContext* ctx)
@@ -42,25 +233,150 @@ struct GSourceContext
         return G_SOURCE_REMOVE;
     }
 
-    static void static_destroy(GSourceContext* ctx) { delete ctx; }
+    static void static_destroy(GSourceContext* ctx)
+    {
+        if (ctx->attached_sources)
+            ctx->attached_sources->remove(ctx->gsource);
+        delete ctx;
+    }
+
     std::function<void()> const callback;
+    GSource* const gsource;
+    std::shared_ptr<repowerd::EventLoopAttachedSources> const attached_sources;
     std::promise<void> done;
 };
 
+// Source callback context without completion tracking. The source is
+// removed after the first call, or kept for further calls if
+// source_result is G_SOURCE_CONTINUE.
+template <gboolean source_result>
+struct DetachedGSourceContext
+{
+    DetachedGSourceContext(
+        std::function<void()> const& callback,
+        GSource* gsource,
+        std::shared_ptr<repowerd::EventLoopAttachedSources> const& attached_sources)
+        : callback{callback},
+          gsource{gsource},
+          attached_sources{attached_sources}
+    {
+        if (attached_sources)
+            attached_sources->add(gsource);
+    }
+
+    static gboolean static_call(DetachedGSourceContext* ctx)
+    {
+        try
+        {
+            ctx->callback();
+        }
+        catch (...)
+        {
+        }
+        return source_result;
+    }
+
+    static void static_destroy(DetachedGSourceContext* ctx)
+    {
+        if (ctx->attached_sources)
+            ctx->attached_sources->remove(ctx->gsource);
+        delete ctx;
+    }
+
+    std::function<void()> const callback;
+    GSource* const gsource;
+    std::shared_ptr<repowerd::EventLoopAttachedSources> const attached_sources;
+};
+
+// The source shares ownership of the work queue, so that the queue
+// outlives an EventLoop destroyed by work that the queue is running
+struct WorkSource
+{
+    GSource gsource;
+    std::shared_ptr<repowerd::EventLoopWorkQueue> work_queue;
+
+    static gboolean static_dispatch(GSource* gsource, GSourceFunc, gpointer)
+    {
+        auto const work_queue = reinterpret_cast<WorkSource*>(gsource)->work_queue;
+        work_queue->run_pending();
+        return G_SOURCE_CONTINUE;
+    }
+
+    static void static_finalize(GSource* gsource)
+    {
+        reinterpret_cast<WorkSource*>(gsource)->work_queue.~shared_ptr();
+    }
+};
+
+GSourceFuncs work_source_funcs{
+    nullptr,
+    nullptr,
+    &WorkSource::static_dispatch,
+    &WorkSource::static_finalize,
+    nullptr,
+    nullptr};
+
+gboolean fd_watch_dispatch(GSource*, GSourceFunc callback, gpointer user_data)
+{
+    return callback(user_data);
+}
+
+GSourceFuncs fd_watch_source_funcs{
+    nullptr,
+    nullptr,
+    &fd_watch_dispatch,
+    nullptr,
+    nullptr,
+    nullptr};
+
+GSource* create_work_source(
+    std::shared_ptr<repowerd::EventLoopWorkQueue> const& work_queue,
+    GMainContext* main_context)
+{
+    auto const gsource = g_source_new(&work_source_funcs, sizeof(WorkSource));
+    new (&reinterpret_cast<WorkSource*>(gsource)->work_queue)
+        std::shared_ptr<repowerd::EventLoopWorkQueue>{work_queue};
+    // Keep enqueued callbacks at the priority of the idle sources they
+    // used to be run from
+    g_source_set_priority(gsource, G_PRIORITY_DEFAULT_IDLE);
+    g_source_add_unix_fd(gsource, work_queue->wakeup_fd, G_IO_IN);
+    g_source_attach(gsource, main_context);
+    return gsource;
+}
+
 }
 
 repowerd::EventLoop::EventLoop()
-    : main_context{g_main_context_new()},
-      main_loop{g_main_loop_new(main_context, FALSE)}
+    : EventLoop{std::shared_ptr<EventLoop>{}}
 {
-    loop_thread = std::thread{
-        [this]
-        {
-            g_main_context_push_thread_default(main_context);
-            g_main_loop_run(main_loop);
-        }};
+}
+
+repowerd::EventLoop::EventLoop(std::shared_ptr<EventLoop> const& shared_loop)
+    : shared_loop{shared_loop},
+      attached_sources{shared_loop ? std::make_shared<EventLoopAttachedSources>() : nullptr},
+      work_queue{std::make_shared<EventLoopWorkQueue>()}
+{
+    if (shared_loop)
+    {
+        main_context = g_main_context_ref(shared_loop->main_context);
+        main_loop = nullptr;
+        work_source = create_work_source(work_queue, main_context);
+    }
+    else
+    {
+        main_context = g_main_context_new();
+        main_loop = g_main_loop_new(main_context, FALSE);
+        work_source = create_work_source(work_queue, main_context);
+
+        loop_thread = std::thread{
+            [this]
+            {
+                g_main_context_push_thread_default(main_context);
+                g_main_loop_run(main_loop);
+            }};
 
-    enqueue([]{}).wait();
+        enqueue([]{}).wait();
+    }
 }
 
 repowerd::EventLoop::~EventLoop()
@@ -70,10 +386,37 @@ repowerd::EventLoop::~EventLoop()
 
 void repowerd::EventLoop::stop()
 {
+    if (shared_loop && main_context)
+    {
+        auto const sources = attached_sources;
+        auto const queue = work_queue;
+        auto const gsource = work_source;
+        auto const destroy_sources =
+            [sources, queue, gsource]
+            {
+                sources->destroy_all();
+                queue->stopped = true;
+                g_source_destroy(gsource);
+            };
+
+        // Waiting for the shared loop thread would deadlock if we are
+        // stopped from one of our own callbacks, which run on that thread
+        if (g_main_context_is_owner(main_context))
+            destroy_sources();
+        else
+            shared_loop->enqueue(destroy_sources).wait();
+    }
+
     if (main_loop)
         g_main_loop_quit(main_loop);
     if (loop_thread.joinable())
         loop_thread.join();
+    if (work_source)
+    {
+        g_source_destroy(work_source);
+        g_source_unref(work_source);
+        work_source = nullptr;
+    }
     if (main_loop)
     {
         g_main_loop_unref(main_loop);
@@ -88,18 +431,10 @@ void repowerd::EventLoop::stop()
 
 std::future<void> repowerd::EventLoop::enqueue(std::function<void()> const& callback)
 {
-    auto const gsource = g_idle_source_new();
-    auto const ctx = new GSourceContext{callback};
-    g_source_set_callback(
-            gsource,
-            reinterpret_cast<GSourceFunc>(&GSourceContext::static_call),
-            ctx,
-            reinterpret_cast<GDestroyNotify>(&GSourceContext::static_destroy));
+    auto const work = new EventLoopWorkQueue::TrackedWork{callback};
+    auto future = work->done.get_future();
 
-    auto future = ctx->done.get_future();
-
-    g_source_attach(gsource, main_context);
-    g_source_unref(gsource);
+    work_queue->push(work);
 
     return future;
 }
@@ -107,21 +442,46 @@ std::future<void> repowerd::EventLoop::enqueue(std::function<void()> const& call
 std::future<void> repowerd::EventLoop::schedule_in(
     std::chrono::milliseconds timeout,
     std::function<void()> const& callback)
+{
+    return attach(g_timeout_source_new(timeout.count()), callback);
+}
+
+void repowerd::EventLoop::post(std::function<void()> const& callback)
+{
+    work_queue->push(new EventLoopWorkQueue::Work{callback});
+}
+
+void repowerd::EventLoop::post_in(
+    std::chrono::milliseconds timeout,
+    std::function<void()> const& callback)
 {
     auto const gsource = g_timeout_source_new(timeout.count());
-    auto const ctx = new GSourceContext{callback};
+    using Context = DetachedGSourceContext<G_SOURCE_REMOVE>;
+    auto const ctx = new Context{callback, gsource, attached_sources};
     g_source_set_callback(
             gsource,
-            reinterpret_cast<GSourceFunc>(&GSourceContext::static_call),
+            reinterpret_cast<GSourceFunc>(&Context::static_call),
             ctx,
-            reinterpret_cast<GDestroyNotify>(&GSourceContext::static_destroy));
-
-    auto future = ctx->done.get_future();
+            reinterpret_cast<GDestroyNotify>(&Context::static_destroy));
 
     g_source_attach(gsource, main_context);
     g_source_unref(gsource);
+}
 
-    return future;
+void repowerd::EventLoop::watch_fd(int fd, std::function<void()> const& callback)
+{
+    auto const gsource = g_source_new(&fd_watch_source_funcs, sizeof(GSource));
+    using Context = DetachedGSourceContext<G_SOURCE_CONTINUE>;
+    auto const ctx = new Context{callback, gsource, attached_sources};
+    g_source_set_callback(
+            gsource,
+            reinterpret_cast<GSourceFunc>(&Context::static_call),
+            ctx,
+            reinterpret_cast<GDestroyNotify>(&Context::static_destroy));
+
+    g_source_add_unix_fd(gsource, fd, G_IO_IN);
+    g_source_attach(gsource, main_context);
+    g_source_unref(gsource);
 }
 
 void repowerd::EventLoop::schedule_with_cancellation_in(
@@ -130,7 +490,7 @@ void repowerd::EventLoop::schedule_with_cancellation_in(
     std::function<void(EventLoopCancellation const&)> const& cancellation_ready)
 {
     auto const gsource = g_timeout_source_new(timeout.count());
-    auto const ctx = new GSourceContext{callback};
+    auto const ctx = new GSourceContext{callback, gsource, attached_sources};
     g_source_set_callback(
             gsource,
             reinterpret_cast<GSourceFunc>(&GSourceContext::static_call),
@@ -144,7 +504,7 @@ void repowerd::EventLoop::schedule_with_cancellation_in(
             g_source_unref(gsource);
         };
 
-    enqueue(
+    post(
         [cancellation, cancellation_ready]
         {
             cancellation_ready(cancellation);
@@ -152,3 +512,22 @@ void repowerd::EventLoop::schedule_with_cancellation_in(
 
     g_source_attach(gsource, main_context);
 }
+
+std::future<void> repowerd::EventLoop::attach(
+    GSource* gsource,
+    std::function<void()> const& callback)
+{
+    auto const ctx = new GSourceContext{callback, gsource, attached_sources};
+    g_source_set_callback(
+            gsource,
+            reinterpret_cast<GSourceFunc>(&GSourceContext::static_call),
+            ctx,
+            reinterpret_cast<GDestroyNotify>(&GSourceContext::static_destroy));
+
+    auto future = ctx->done.get_future();
+
+    g_source_attach(gsource, main_context);
+    g_source_unref(gsource);
+
+    return future;
+}
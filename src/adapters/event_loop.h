@@ -21,6 +21,7 @@
 #include <thread>
 #include <functional>
 #include <future>
+#include <memory>
 
 #include <glib.h>
 
@@ -28,11 +29,18 @@ namespace repowerd
 {
 
 using EventLoopCancellation = std::function<void()>;
+struct EventLoopAttachedSources;
+struct EventLoopWorkQueue;
 
 class EventLoop
 {
 public:
     EventLoop();
+    // Runs callbacks on the thread and main context of shared_loop instead
+    // of creating a new thread. Stopping this loop removes only the sources
+    // it has attached, leaving shared_loop running. A null shared_loop is
+    // equivalent to the default constructor.
+    explicit EventLoop(std::shared_ptr<EventLoop> const& shared_loop);
     ~EventLoop();
 
     void stop();
@@ -41,6 +49,16 @@ public:
     std::future<void> schedule_in(
         std::chrono::milliseconds, std::function<void()> const& callback);
 
+    // Like enqueue() and schedule_in(), but without tracking completion, for
+    // callers that don't wait for the callback. Exceptions thrown by the
+    // callback are ignored.
+    void post(std::function<void()> const& callback);
+    void post_in(
+        std::chrono::milliseconds, std::function<void()> const& callback);
+
+    // Calls callback whenever fd becomes readable, until the loop is stopped
+    void watch_fd(int fd, std::function<void()> const& callback);
+
     void schedule_with_cancellation_in(
         std::chrono::milliseconds,
         std::function<void()> const& callback,
@@ -50,6 +68,16 @@ protected:
     std::thread loop_thread;
     GMainContext* main_context;
     GMainLoop* main_loop;
+
+private:
+    std::future<void> attach(GSource* gsource, std::function<void()> const& callback);
+
+    std::shared_ptr<EventLoop> const shared_loop;
+    std::shared_ptr<EventLoopAttachedSources> const attached_sources;
+    // Enqueued callbacks are queued here and run in batches by a single
+    // eventfd-backed source, instead of allocating a GSource per callback
+    std::shared_ptr<EventLoopWorkQueue> const work_queue;
+    GSource* work_source;
 };
 
 }
@@ -19,23 +19,52 @@
 #include "event_loop_timer.h"
 #include "event_loop_handler_registration.h"
 
+#include "src/core/log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/timerfd.h>
+
 namespace
 {
+char const* const log_tag = "EventLoopTimer";
 auto const null_handler = [](auto){};
+
+int create_timerfd()
+{
+    auto const fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0)
+        throw std::system_error{errno, std::system_category(), "Failed to create timerfd"};
+    return fd;
+}
+
 }
 
-repowerd::EventLoopTimer::EventLoopTimer()
-    : alarm_handler{null_handler},
-      next_alarm_id{1}
+repowerd::EventLoopTimer::EventLoopTimer(std::shared_ptr<Log> const& log)
+    : EventLoopTimer{log, nullptr}
 {
 }
 
+repowerd::EventLoopTimer::EventLoopTimer(
+    std::shared_ptr<Log> const& log,
+    std::shared_ptr<EventLoop> const& shared_loop)
+    : log{log},
+      timer_fd{create_timerfd()},
+      event_loop{shared_loop},
+      alarm_handler{null_handler},
+      armed_deadline{std::chrono::steady_clock::time_point::max()},
+      next_alarm_id{1},
+      stats{0, 0, 0}
+{
+    event_loop.watch_fd(timer_fd, [this] { handle_timer_fd(); });
+}
+
 repowerd::EventLoopTimer::~EventLoopTimer()
 {
     event_loop.stop();
-
-    for (auto const& alarm : alarms)
-        alarm.second();
 }
 
 repowerd::HandlerRegistration repowerd::EventLoopTimer::register_alarm_handler(
@@ -50,32 +79,62 @@ repowerd::HandlerRegistration repowerd::EventLoopTimer::register_alarm_handler(
 repowerd::AlarmId repowerd::EventLoopTimer::schedule_alarm_in(
     std::chrono::milliseconds t)
 {
-    repowerd::AlarmId alarm_id;
+    return schedule_alarm_in(t, std::chrono::milliseconds{0});
+}
 
-    {
-        std::lock_guard<std::mutex> lock{alarms_mutex};
-        alarm_id = next_alarm_id++;
-    }
+repowerd::AlarmId repowerd::EventLoopTimer::schedule_alarm_in(
+    std::chrono::milliseconds t, std::chrono::milliseconds tolerance)
+{
+    auto const window_start = now() + t;
+    auto const window_end = window_start + tolerance;
 
-    event_loop.schedule_with_cancellation_in(
-        t,
-        [this, alarm_id]
-        {
-            alarm_handler(alarm_id);
-            cancel_alarm_unqueued(alarm_id);
-        },
-        [this, alarm_id] (EventLoopCancellation const& cancellation)
-        {
-            std::lock_guard<std::mutex> lock{alarms_mutex};
-            alarms[alarm_id] = cancellation;
-        });
+    std::lock_guard<std::mutex> lock{alarms_mutex};
+
+    auto const alarm_id = next_alarm_id++;
+    alarm_window_starts.push(alarm_id, window_start);
+    alarm_window_ends.push(alarm_id, window_end);
+
+    // Arm for the earliest alarm rather than this one, in case an earlier
+    // arming failed and left armed_deadline unset
+    auto const next_deadline = alarm_window_ends.next_deadline();
+    if (next_deadline < armed_deadline)
+        arm_timer_fd(next_deadline);
 
     return alarm_id;
 }
 
 void repowerd::EventLoopTimer::cancel_alarm(AlarmId id)
 {
-    event_loop.enqueue([this,id] { cancel_alarm_unqueued(id); }).get();
+    // The timerfd is left armed, and is rearmed for the next live alarm
+    // if it fires for a cancelled one
+    std::lock_guard<std::mutex> lock{alarms_mutex};
+    alarm_window_starts.cancel(id);
+    alarm_window_ends.cancel(id);
+
+    // Retry arming for the remaining alarms if an earlier arming failed
+    auto const next_deadline = alarm_window_ends.next_deadline();
+    if (armed_deadline == std::chrono::steady_clock::time_point::max() &&
+        next_deadline != std::chrono::steady_clock::time_point::max())
+    {
+        arm_timer_fd(next_deadline);
+    }
+
+    auto const fired = fired_alarms.find(id);
+    if (fired != fired_alarms.end())
+        fired->second = true;
+}
+
+bool repowerd::EventLoopTimer::consume_fired_alarm(AlarmId id)
+{
+    std::lock_guard<std::mutex> lock{alarms_mutex};
+
+    auto const fired = fired_alarms.find(id);
+    if (fired == fired_alarms.end())
+        return false;
+
+    auto const cancelled = fired->second;
+    fired_alarms.erase(fired);
+    return !cancelled;
 }
 
 std::chrono::steady_clock::time_point repowerd::EventLoopTimer::now()
@@ -83,14 +142,70 @@ std::chrono::steady_clock::time_point repowerd::EventLoopTimer::now()
     return std::chrono::steady_clock::now();
 }
 
-void repowerd::EventLoopTimer::cancel_alarm_unqueued(AlarmId id)
+repowerd::EventLoopTimer::WakeupStats repowerd::EventLoopTimer::wakeup_stats()
 {
     std::lock_guard<std::mutex> lock{alarms_mutex};
+    return stats;
+}
+
+void repowerd::EventLoopTimer::handle_timer_fd()
+{
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {}
+
+    due_alarms.clear();
+
+    {
+        std::lock_guard<std::mutex> lock{alarms_mutex};
 
-    auto const iter = alarms.find(id);
-    if (iter != alarms.end())
+        // Fire every alarm whose window has started, so that alarms with
+        // overlapping windows share this wakeup
+        alarm_window_starts.pop_due(now(), due_alarms);
+        for (auto const id : due_alarms)
+        {
+            alarm_window_ends.cancel(id);
+            fired_alarms[id] = false;
+        }
+
+        if (!due_alarms.empty())
+        {
+            ++stats.wakeups;
+            stats.alarms_fired += due_alarms.size();
+            stats.wakeups_saved += due_alarms.size() - 1;
+        }
+
+        armed_deadline = std::chrono::steady_clock::time_point::max();
+        auto const next_deadline = alarm_window_ends.next_deadline();
+        if (next_deadline != std::chrono::steady_clock::time_point::max())
+            arm_timer_fd(next_deadline);
+    }
+
+    for (auto const id : due_alarms)
+        alarm_handler(id);
+}
+
+void repowerd::EventLoopTimer::arm_timer_fd(
+    std::chrono::steady_clock::time_point deadline)
+{
+    using namespace std::chrono;
+
+    // A zero it_value disarms the timerfd, so use at least 1ns
+    auto const deadline_ns = std::max(
+        duration_cast<nanoseconds>(deadline.time_since_epoch()).count(),
+        static_cast<nanoseconds::rep>(1));
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = deadline_ns / 1000000000;
+    spec.it_value.tv_nsec = deadline_ns % 1000000000;
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
     {
-        iter->second();
-        alarms.erase(iter);
+        // Leave armed_deadline unset, so that the next schedule or cancel
+        // retries arming instead of assuming the timerfd will fire
+        log->log(log_tag, "Failed to set timerfd: %s", strerror(errno));
+        armed_deadline = time_point<steady_clock>::max();
+        return;
     }
+
+    armed_deadline = deadline;
 }
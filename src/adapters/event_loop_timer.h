@@ -19,34 +19,73 @@
 #pragma once
 
 #include "src/core/timer.h"
+#include "alarm_heap.h"
 #include "event_loop.h"
+#include "fd.h"
 
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace repowerd
 {
+class Log;
 
 class EventLoopTimer : public Timer
 {
 public:
-    EventLoopTimer();
+    explicit EventLoopTimer(std::shared_ptr<Log> const& log);
+    // Handles the timerfd, and calls the alarm handler, on the thread of
+    // shared_loop instead of creating a new thread
+    EventLoopTimer(
+        std::shared_ptr<Log> const& log,
+        std::shared_ptr<EventLoop> const& shared_loop);
     ~EventLoopTimer();
 
     HandlerRegistration register_alarm_handler(AlarmHandler const& handler) override;
     AlarmId schedule_alarm_in(std::chrono::milliseconds t) override;
+    AlarmId schedule_alarm_in(
+        std::chrono::milliseconds t, std::chrono::milliseconds tolerance) override;
     void cancel_alarm(AlarmId id) override;
+    bool consume_fired_alarm(AlarmId id) override;
     std::chrono::steady_clock::time_point now() override;
 
+    struct WakeupStats
+    {
+        uint64_t wakeups;
+        uint64_t alarms_fired;
+        // Alarms that fired in a wakeup shared with an earlier alarm,
+        // instead of needing a wakeup of their own
+        uint64_t wakeups_saved;
+    };
+    WakeupStats wakeup_stats();
+
 private:
-    void cancel_alarm_unqueued(AlarmId id);
+    void handle_timer_fd();
+    void arm_timer_fd(std::chrono::steady_clock::time_point deadline);
 
+    std::shared_ptr<Log> const log;
+    Fd const timer_fd;
     EventLoop event_loop;
     AlarmHandler alarm_handler;
 
     std::mutex alarms_mutex;
-    std::unordered_map<AlarmId,EventLoopCancellation> alarms;
+    // Alarm windows ordered by start and by end. The timerfd is armed for
+    // the earliest window end, and each wakeup fires all alarms whose
+    // windows have started by then.
+    AlarmHeap alarm_window_starts;
+    AlarmHeap alarm_window_ends;
+    // Fired alarms not consumed yet, and whether they have been cancelled
+    std::unordered_map<AlarmId,bool> fired_alarms;
+    // time_point::max() if the timerfd is not armed for any alarm
+    std::chrono::steady_clock::time_point armed_deadline;
     AlarmId next_alarm_id;
+    WakeupStats stats;
+
+    // Only accessed from the event loop thread
+    std::vector<AlarmId> due_alarms;
 };
 
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "file_daemon_event_trace.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+// How long recorded events are buffered before being written, so that
+// events arriving in bursts are written together
+auto const write_delay = std::chrono::milliseconds{100};
+size_t const initial_buffer_capacity{256};
+
+bool write_all(int fd, void const* data, size_t size)
+{
+    auto ptr = static_cast<char const*>(data);
+
+    while (size > 0)
+    {
+        auto const written = write(fd, ptr, size);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        ptr += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+}
+
+repowerd::FileDaemonEventTrace::FileDaemonEventTrace(std::string const& path)
+    : trace_fd{open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)},
+      write_scheduled{false}
+{
+    if (trace_fd < 0)
+    {
+        throw std::system_error{
+            errno, std::system_category(), "Failed to open event trace " + path};
+    }
+
+    auto const header = daemon_event_trace_header();
+    if (!write_all(trace_fd, &header, sizeof(header)))
+    {
+        throw std::system_error{
+            errno, std::system_category(), "Failed to write event trace header"};
+    }
+
+    buffered_records.reserve(initial_buffer_capacity);
+    records_to_write.reserve(initial_buffer_capacity);
+}
+
+repowerd::FileDaemonEventTrace::~FileDaemonEventTrace()
+{
+    event_loop.stop();
+    write_buffered_records();
+}
+
+void repowerd::FileDaemonEventTrace::record(DaemonEvent const& event)
+{
+    auto const record = daemon_event_trace_record_for(event);
+    bool schedule_write{false};
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        buffered_records.push_back(record);
+        if (!write_scheduled)
+            schedule_write = write_scheduled = true;
+    }
+
+    if (schedule_write)
+        event_loop.post_in(write_delay, [this] { write_buffered_records(); });
+}
+
+void repowerd::FileDaemonEventTrace::flush()
+{
+    event_loop.enqueue([this] { write_buffered_records(); }).wait();
+}
+
+void repowerd::FileDaemonEventTrace::write_buffered_records()
+{
+    {
+        // Swap the buffers, so that recording isn't blocked by the write,
+        // and neither buffer needs to grow once large enough
+        std::lock_guard<std::mutex> lock{mutex};
+        records_to_write.swap(buffered_records);
+        write_scheduled = false;
+    }
+
+    if (!records_to_write.empty())
+    {
+        write_all(trace_fd, records_to_write.data(),
+                  records_to_write.size() * sizeof(records_to_write[0]));
+        records_to_write.clear();
+    }
+}
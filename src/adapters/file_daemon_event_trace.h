@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "src/core/daemon_event_trace.h"
+
+#include "event_loop.h"
+#include "fd.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace repowerd
+{
+
+// Appends traced events to a binary trace file, see DaemonEventTraceHeader.
+// Recording only buffers the event, and buffered events are written in
+// batches from a separate thread. Write failures are ignored, so that
+// tracing never disturbs the Daemon.
+class FileDaemonEventTrace : public DaemonEventTrace
+{
+public:
+    FileDaemonEventTrace(std::string const& path);
+    ~FileDaemonEventTrace();
+
+    void record(DaemonEvent const& event) override;
+
+    // Writes all buffered events to the trace file
+    void flush();
+
+private:
+    void write_buffered_records();
+
+    Fd const trace_fd;
+    EventLoop event_loop;
+
+    std::mutex mutex;
+    std::vector<DaemonEventTraceRecord> buffered_records;
+    bool write_scheduled;
+
+    // Only accessed from the event loop thread, or after it has stopped
+    std::vector<DaemonEventTraceRecord> records_to_write;
+};
+
+}
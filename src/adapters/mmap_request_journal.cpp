@@ -0,0 +1,404 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "mmap_request_journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+enum class RecordType : uint16_t
+{
+    none,
+    wakeup_request,
+    wakeup_clear,
+    sys_state_request,
+    sys_state_clear
+};
+
+char const journal_magic[8] = {'R','P','W','D','J','R','N','L'};
+uint32_t const journal_version = 1;
+
+}
+
+// All fields are in host byte order. The first record sized slot of the
+// file holds a RequestJournalHeader.
+struct repowerd::RequestJournalRecord
+{
+    // Checksum of the rest of the record
+    uint32_t checksum;
+    RecordType type;
+    uint16_t reserved;
+    int32_t sys_state_id;
+    uint32_t wakeup_tolerance_ms;
+    uint64_t wakeup_cookie;
+    // Nanoseconds since the system_clock epoch
+    int64_t wakeup_time_ns;
+    char sys_state_sender[32];
+};
+
+static_assert(sizeof(repowerd::RequestJournalRecord) == 64,
+              "RequestJournalRecord should not change size");
+
+namespace
+{
+
+struct RequestJournalHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+uint32_t checksum_for(repowerd::RequestJournalRecord const& record)
+{
+    // FNV-1a, which is enough to detect records torn by a crash
+    auto const bytes = reinterpret_cast<unsigned char const*>(&record);
+    uint32_t hash = 2166136261u;
+
+    for (auto i = sizeof(record.checksum); i < sizeof(record); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+}
+
+struct repowerd::MmapRequestJournal::Mapping
+{
+    // Maps an existing journal file, or leaves addr == nullptr if there is
+    // no usable journal file at path
+    Mapping(std::string const& path)
+        : fd{open(path.c_str(), O_RDWR | O_CLOEXEC)},
+          addr{nullptr},
+          size{0}
+    {
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 ||
+            static_cast<size_t>(st.st_size) < 2 * sizeof(RequestJournalRecord))
+        {
+            return;
+        }
+
+        map(st.st_size);
+    }
+
+    // Creates a new, empty journal file with room for max_records records
+    Mapping(std::string const& path, size_t max_records)
+        : fd{open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)},
+          addr{nullptr},
+          size{0}
+    {
+        if (fd < 0)
+        {
+            throw std::system_error{
+                errno, std::system_category(), "Failed to create request journal " + path};
+        }
+
+        auto const new_size = (max_records + 1) * sizeof(RequestJournalRecord);
+
+        if (ftruncate(fd, new_size) < 0)
+        {
+            throw std::system_error{
+                errno, std::system_category(), "Failed to resize request journal " + path};
+        }
+
+        map(new_size);
+
+        if (!addr)
+        {
+            throw std::system_error{
+                errno, std::system_category(), "Failed to map request journal " + path};
+        }
+
+        RequestJournalHeader header{};
+        memcpy(header.magic, journal_magic, sizeof(header.magic));
+        header.version = journal_version;
+        header.record_size = sizeof(RequestJournalRecord);
+        memcpy(addr, &header, sizeof(header));
+    }
+
+    ~Mapping()
+    {
+        if (addr)
+            munmap(addr, size);
+    }
+
+    void map(size_t map_size)
+    {
+        auto const ptr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED)
+        {
+            addr = ptr;
+            size = map_size;
+        }
+    }
+
+    bool has_valid_header() const
+    {
+        if (!addr)
+            return false;
+
+        RequestJournalHeader header;
+        memcpy(&header, addr, sizeof(header));
+
+        return memcmp(header.magic, journal_magic, sizeof(header.magic)) == 0 &&
+               header.version == journal_version &&
+               header.record_size == sizeof(RequestJournalRecord);
+    }
+
+    RequestJournalRecord* records() const
+    {
+        return static_cast<RequestJournalRecord*>(addr) + 1;
+    }
+
+    size_t capacity() const
+    {
+        return size / sizeof(RequestJournalRecord) - 1;
+    }
+
+    Fd const fd;
+    void* addr;
+    size_t size;
+};
+
+repowerd::MmapRequestJournal::MmapRequestJournal(
+    std::string const& path, size_t max_records)
+    : path{path},
+      max_records{max_records},
+      mapping{std::make_unique<Mapping>(path)},
+      next_record{0}
+{
+    if (mapping->has_valid_header())
+        replay();
+
+    // Start with a journal holding just the outstanding requests
+    compact();
+}
+
+repowerd::MmapRequestJournal::~MmapRequestJournal() = default;
+
+void repowerd::MmapRequestJournal::record_wakeup_request(
+    uint64_t cookie,
+    std::chrono::system_clock::time_point time,
+    std::chrono::milliseconds tolerance)
+{
+    using namespace std::chrono;
+
+    RequestJournalRecord record{};
+    record.type = RecordType::wakeup_request;
+    record.wakeup_cookie = cookie;
+    record.wakeup_time_ns = duration_cast<nanoseconds>(time.time_since_epoch()).count();
+    record.wakeup_tolerance_ms = std::min<uint64_t>(
+        std::max<int64_t>(tolerance.count(), 0), UINT32_MAX);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    append(record);
+}
+
+void repowerd::MmapRequestJournal::record_wakeup_clear(uint64_t cookie)
+{
+    RequestJournalRecord record{};
+    record.type = RecordType::wakeup_clear;
+    record.wakeup_cookie = cookie;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (wakeups.find(cookie) != wakeups.end())
+        append(record);
+}
+
+void repowerd::MmapRequestJournal::record_sys_state_request(
+    std::string const& sender, int32_t id)
+{
+    RequestJournalRecord record{};
+
+    // D-Bus unique names are short, so this is not expected to happen, but
+    // don't journal truncated names
+    if (sender.size() >= sizeof(record.sys_state_sender))
+        return;
+
+    record.type = RecordType::sys_state_request;
+    record.sys_state_id = id;
+    memcpy(record.sys_state_sender, sender.c_str(), sender.size());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    append(record);
+}
+
+void repowerd::MmapRequestJournal::record_sys_state_clear(
+    std::string const& sender, int32_t id)
+{
+    RequestJournalRecord record{};
+
+    if (sender.size() >= sizeof(record.sys_state_sender))
+        return;
+
+    record.type = RecordType::sys_state_clear;
+    record.sys_state_id = id;
+    memcpy(record.sys_state_sender, sender.c_str(), sender.size());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (sys_states.find({sender, id}) != sys_states.end())
+        append(record);
+}
+
+repowerd::JournaledRequests repowerd::MmapRequestJournal::outstanding_requests()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    JournaledRequests requests;
+
+    for (auto const& wakeup : wakeups)
+        requests.wakeups.push_back(wakeup.second);
+
+    for (auto const& sys_state : sys_states)
+        requests.sys_states.push_back({sys_state.first, sys_state.second});
+
+    return requests;
+}
+
+size_t repowerd::MmapRequestJournal::records_in_use()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return next_record;
+}
+
+void repowerd::MmapRequestJournal::append(RequestJournalRecord& record)
+{
+    if (next_record == mapping->capacity())
+    {
+        // Journaling failures shouldn't fail client requests, so if
+        // compaction fails keep using the full journal, and drop records
+        // until a later compaction succeeds
+        try { compact(); } catch (...) {}
+    }
+
+    record.checksum = checksum_for(record);
+
+    if (next_record < mapping->capacity())
+        mapping->records()[next_record++] = record;
+
+    apply(record);
+}
+
+void repowerd::MmapRequestJournal::apply(RequestJournalRecord const& record)
+{
+    using namespace std::chrono;
+
+    switch (record.type)
+    {
+    case RecordType::wakeup_request:
+        wakeups[record.wakeup_cookie] = {
+            record.wakeup_cookie,
+            system_clock::time_point{
+                duration_cast<system_clock::duration>(nanoseconds{record.wakeup_time_ns})},
+            milliseconds{record.wakeup_tolerance_ms}};
+        break;
+
+    case RecordType::wakeup_clear:
+        wakeups.erase(record.wakeup_cookie);
+        break;
+
+    case RecordType::sys_state_request:
+        sys_states.insert({record.sys_state_sender, record.sys_state_id});
+        break;
+
+    case RecordType::sys_state_clear:
+        sys_states.erase({record.sys_state_sender, record.sys_state_id});
+        break;
+
+    case RecordType::none:
+        break;
+    }
+}
+
+void repowerd::MmapRequestJournal::replay()
+{
+    auto const records = mapping->records();
+    auto const capacity = mapping->capacity();
+
+    for (next_record = 0; next_record < capacity; ++next_record)
+    {
+        auto const& record = records[next_record];
+
+        if (record.type == RecordType::none ||
+            record.checksum != checksum_for(record) ||
+            record.sys_state_sender[sizeof(record.sys_state_sender) - 1] != '\0')
+        {
+            break;
+        }
+
+        apply(record);
+    }
+}
+
+void repowerd::MmapRequestJournal::compact()
+{
+    auto const new_path = path + ".new";
+    auto new_mapping = std::make_unique<Mapping>(new_path, max_records);
+    auto const records = new_mapping->records();
+    size_t num_records = 0;
+
+    for (auto const& wakeup : wakeups)
+    {
+        if (num_records == max_records) break;
+
+        RequestJournalRecord record{};
+        record.type = RecordType::wakeup_request;
+        record.wakeup_cookie = wakeup.first;
+        record.wakeup_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            wakeup.second.time.time_since_epoch()).count();
+        record.wakeup_tolerance_ms = wakeup.second.tolerance.count();
+        record.checksum = checksum_for(record);
+        records[num_records++] = record;
+    }
+
+    for (auto const& sys_state : sys_states)
+    {
+        if (num_records == max_records) break;
+
+        RequestJournalRecord record{};
+        record.type = RecordType::sys_state_request;
+        record.sys_state_id = sys_state.second;
+        memcpy(record.sys_state_sender, sys_state.first.c_str(), sys_state.first.size());
+        record.checksum = checksum_for(record);
+        records[num_records++] = record;
+    }
+
+    if (msync(new_mapping->addr, new_mapping->size, MS_SYNC) < 0 ||
+        rename(new_path.c_str(), path.c_str()) < 0)
+    {
+        throw std::system_error{
+            errno, std::system_category(), "Failed to replace request journal " + path};
+    }
+
+    mapping = std::move(new_mapping);
+    next_record = num_records;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "request_journal.h"
+#include "fd.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace repowerd
+{
+
+struct RequestJournalRecord;
+
+// An append-only journal in a memory mapped file of fixed size. Recording
+// a request only copies a checksummed record into the mapping, and replay
+// stops at the first record with a bad checksum, so records torn by a crash
+// are ignored. When the file fills up, the outstanding requests are written
+// to a new file, which atomically replaces the old one.
+class MmapRequestJournal : public RequestJournal
+{
+public:
+    MmapRequestJournal(std::string const& path, size_t max_records);
+    ~MmapRequestJournal();
+
+    void record_wakeup_request(
+        uint64_t cookie,
+        std::chrono::system_clock::time_point time,
+        std::chrono::milliseconds tolerance) override;
+    void record_wakeup_clear(uint64_t cookie) override;
+    void record_sys_state_request(std::string const& sender, int32_t id) override;
+    void record_sys_state_clear(std::string const& sender, int32_t id) override;
+
+    JournaledRequests outstanding_requests() override;
+
+    size_t records_in_use();
+
+private:
+    struct Mapping;
+
+    void append(RequestJournalRecord& record);
+    void apply(RequestJournalRecord const& record);
+    void replay();
+    void compact();
+
+    std::string const path;
+    size_t const max_records;
+
+    std::mutex mutex;
+    std::unique_ptr<Mapping> mapping;
+    size_t next_record;
+    std::map<uint64_t,JournaledWakeup> wakeups;
+    std::set<std::pair<std::string,int32_t>> sys_states;
+};
+
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "request_journal.h"
+
+namespace repowerd
+{
+
+class NullRequestJournal : public RequestJournal
+{
+public:
+    void record_wakeup_request(
+        uint64_t cookie,
+        std::chrono::system_clock::time_point time,
+        std::chrono::milliseconds tolerance) override;
+    void record_wakeup_clear(uint64_t cookie) override;
+    void record_sys_state_request(std::string const& sender, int32_t id) override;
+    void record_sys_state_clear(std::string const& sender, int32_t id) override;
+
+    JournaledRequests outstanding_requests() override;
+};
+
+}
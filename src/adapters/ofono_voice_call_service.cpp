@@ -115,9 +115,18 @@ bool is_call_state_active(repowerd::OfonoCallState call_state)
 
 repowerd::OfonoVoiceCallService::OfonoVoiceCallService(
     std::shared_ptr<Log> const& log,
-    std::string const& dbus_bus_address)
+    DBusConnectionHandle const& dbus_connection)
+    : OfonoVoiceCallService{log, dbus_connection, nullptr}
+{
+}
+
+repowerd::OfonoVoiceCallService::OfonoVoiceCallService(
+    std::shared_ptr<Log> const& log,
+    DBusConnectionHandle const& dbus_connection,
+    std::shared_ptr<EventLoop> const& shared_event_loop)
     : log{log},
-      dbus_connection{dbus_bus_address},
+      dbus_connection{dbus_connection},
+      dbus_event_loop{shared_event_loop},
       active_call_handler{null_handler},
       no_active_call_handler{null_handler}
 {
@@ -205,12 +214,12 @@ repowerd::HandlerRegistration repowerd::OfonoVoiceCallService::register_no_activ
 
 void repowerd::OfonoVoiceCallService::set_low_power_mode()
 {
-    dbus_event_loop.enqueue([this] { set_fast_dormancy(true); });
+    dbus_event_loop.post([this] { set_fast_dormancy(true); });
 }
 
 void repowerd::OfonoVoiceCallService::set_normal_power_mode()
 {
-    dbus_event_loop.enqueue([this] { set_fast_dormancy(false); });
+    dbus_event_loop.post([this] { set_fast_dormancy(false); });
 }
 
 std::unordered_set<std::string> repowerd::OfonoVoiceCallService::tracked_modems()
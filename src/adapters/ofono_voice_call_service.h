@@ -48,7 +48,11 @@ class OfonoVoiceCallService : public VoiceCallService, public ModemPowerControl
 public:
     OfonoVoiceCallService(
         std::shared_ptr<Log> const& log,
-        std::string const& dbus_bus_address);
+        DBusConnectionHandle const& dbus_connection);
+    OfonoVoiceCallService(
+        std::shared_ptr<Log> const& log,
+        DBusConnectionHandle const& dbus_connection,
+        std::shared_ptr<EventLoop> const& shared_event_loop);
 
     void start_processing() override;
 
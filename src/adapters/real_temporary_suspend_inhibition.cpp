@@ -35,7 +35,7 @@ void repowerd::RealTemporarySuspendInhibition::inhibit_suspend_for(
 
     suspend_control->disallow_suspend(suspend_id);
 
-    event_loop.schedule_in(
+    event_loop.post_in(
         timeout,
         [this, suspend_id]
         {
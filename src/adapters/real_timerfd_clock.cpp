@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "real_timerfd_clock.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#include <sys/timerfd.h>
+
+namespace
+{
+
+bool is_realtime_clock(clockid_t clock_id)
+{
+    return clock_id == CLOCK_REALTIME || clock_id == CLOCK_REALTIME_ALARM;
+}
+
+timespec to_timespec(std::chrono::nanoseconds ns)
+{
+    auto const sec = std::chrono::duration_cast<std::chrono::seconds>(ns);
+
+    timespec ts;
+    ts.tv_sec = sec.count();
+    ts.tv_nsec = (ns - sec).count();
+
+    return ts;
+}
+
+std::chrono::nanoseconds clock_now(clockid_t clock_id)
+{
+    timespec ts;
+    clock_gettime(clock_id, &ts);
+    return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+}
+
+repowerd::RealTimerfdClock::RealTimerfdClock(clockid_t clock_id)
+    : clock_id{clock_id}
+{
+}
+
+repowerd::Fd repowerd::RealTimerfdClock::create_timerfd()
+{
+    auto const fd = timerfd_create(clock_id, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0)
+        throw std::system_error{errno, std::system_category(), "Failed to create timerfd"};
+    return Fd{fd};
+}
+
+int repowerd::RealTimerfdClock::arm_timerfd(
+    int fd,
+    std::chrono::system_clock::time_point tp,
+    std::chrono::system_clock::time_point now)
+{
+    using namespace std::chrono;
+
+    // A zero it_value disarms the timerfd
+    itimerspec spec{};
+
+    if (tp != system_clock::time_point::max())
+    {
+        // Wakeups are given in wall clock time, so for CLOCK_BOOTTIME{,_ALARM}
+        // convert them to the timerfd clock based on the current offset
+        auto const deadline = is_realtime_clock(clock_id) ?
+            duration_cast<nanoseconds>(tp.time_since_epoch()) :
+            clock_now(clock_id) + duration_cast<nanoseconds>(tp - now);
+
+        spec.it_value = to_timespec(std::max(deadline, nanoseconds{1}));
+    }
+
+    return timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+std::chrono::system_clock::time_point repowerd::RealTimerfdClock::now()
+{
+    return std::chrono::system_clock::now();
+}
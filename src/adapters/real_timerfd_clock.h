@@ -0,0 +1,47 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "timerfd_clock.h"
+
+#include <time.h>
+
+namespace repowerd
+{
+
+class RealTimerfdClock : public TimerfdClock
+{
+public:
+    // clock_id should be CLOCK_REALTIME_ALARM or CLOCK_BOOTTIME_ALARM to wake
+    // up the system from suspend, which requires CAP_WAKE_ALARM. Their
+    // CLOCK_REALTIME and CLOCK_BOOTTIME counterparts don't wake up the system,
+    // but need no privileges, which makes them useful for testing.
+    explicit RealTimerfdClock(clockid_t clock_id);
+
+    Fd create_timerfd() override;
+    int arm_timerfd(
+        int fd,
+        std::chrono::system_clock::time_point tp,
+        std::chrono::system_clock::time_point now) override;
+    std::chrono::system_clock::time_point now() override;
+
+private:
+    clockid_t const clock_id;
+};
+
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace repowerd
+{
+
+struct JournaledWakeup
+{
+    uint64_t cookie;
+    std::chrono::system_clock::time_point time;
+    std::chrono::milliseconds tolerance;
+};
+
+struct JournaledSysState
+{
+    std::string sender;
+    int32_t id;
+};
+
+struct JournaledRequests
+{
+    std::vector<JournaledWakeup> wakeups;
+    std::vector<JournaledSysState> sys_states;
+};
+
+// Records client requests that need to outlive the daemon process, so that
+// they can be restored when the daemon restarts
+class RequestJournal
+{
+public:
+    virtual ~RequestJournal() = default;
+
+    virtual void record_wakeup_request(
+        uint64_t cookie,
+        std::chrono::system_clock::time_point time,
+        std::chrono::milliseconds tolerance) = 0;
+    virtual void record_wakeup_clear(uint64_t cookie) = 0;
+    virtual void record_sys_state_request(std::string const& sender, int32_t id) = 0;
+    virtual void record_sys_state_clear(std::string const& sender, int32_t id) = 0;
+
+    // The recorded requests that have not been cleared yet
+    virtual JournaledRequests outstanding_requests() = 0;
+
+protected:
+    RequestJournal() = default;
+    RequestJournal(RequestJournal const&) = delete;
+    RequestJournal& operator=(RequestJournal const&) = delete;
+};
+
+}
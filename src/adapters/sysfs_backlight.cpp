@@ -23,11 +23,16 @@
 #include "src/core/log.h"
 
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
-#include <fstream>
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
+#include <system_error>
 #include <vector>
 
+#include <fcntl.h>
+
 namespace
 {
 char const* const log_tag = "SysfsBacklight";
@@ -103,29 +108,68 @@ int determine_max_brightness(
 repowerd::SysfsBacklight::SysfsBacklight(
     std::shared_ptr<Log> const& log,
     std::shared_ptr<Filesystem> const& filesystem)
+    : SysfsBacklight{log, filesystem, determine_sysfs_backlight_dir(*filesystem)}
+{
+}
+
+repowerd::SysfsBacklight::SysfsBacklight(
+    std::shared_ptr<Log> const& log,
+    std::shared_ptr<Filesystem> const& filesystem,
+    Path const& sysfs_backlight_dir)
     : filesystem{filesystem},
-      sysfs_backlight_dir{determine_sysfs_backlight_dir(*filesystem)},
+      sysfs_backlight_dir{sysfs_backlight_dir},
       sysfs_brightness_file{sysfs_backlight_dir/"brightness"},
       max_brightness{determine_max_brightness(*filesystem, sysfs_backlight_dir)},
+      brightness_fd{filesystem->open(
+          std::string{sysfs_brightness_file}.c_str(), O_RDWR | O_CLOEXEC)},
       last_set_brightness{-1.0}
 {
+    if (brightness_fd == -1)
+    {
+        throw std::system_error{
+            errno, std::system_category(),
+            "Failed to open " + std::string{sysfs_brightness_file}};
+    }
+
     log->log(log_tag, "Using backlight %s",
              std::string{sysfs_backlight_dir}.c_str());
 }
 
+std::vector<repowerd::Path> repowerd::SysfsBacklight::keyboard_backlight_dirs(
+    Filesystem& filesystem)
+{
+    repowerd::Path const sys_leds_root{"/sys/class/leds"};
+
+    std::vector<std::string> keyboard_backlights;
+
+    for (auto const& dir : filesystem.subdirs(sys_leds_root))
+    {
+        if (dir.find("kbd_backlight") != std::string::npos &&
+            filesystem.is_regular_file(repowerd::Path{dir}/"brightness"))
+        {
+            keyboard_backlights.push_back(dir);
+        }
+    }
+
+    std::sort(keyboard_backlights.begin(), keyboard_backlights.end());
+
+    return {keyboard_backlights.begin(), keyboard_backlights.end()};
+}
+
 void repowerd::SysfsBacklight::set_brightness(double value)
 {
-    auto ostream = filesystem->ostream(sysfs_brightness_file);
-    *ostream << absolute_brightness_for(value);
-    ostream->flush();
+    char buf[16];
+    auto const len = snprintf(buf, sizeof(buf), "%d", absolute_brightness_for(value));
+
+    filesystem->pwrite(brightness_fd, buf, len, 0);
     last_set_brightness = value;
 }
 
 double repowerd::SysfsBacklight::get_brightness()
 {
-    auto istream = filesystem->istream(sysfs_brightness_file);
-    int abs_brightness = 0;
-    *istream >> abs_brightness;
+    char buf[16] = {0};
+    filesystem->pread(brightness_fd, buf, sizeof(buf) - 1, 0);
+    int const abs_brightness = atoi(buf);
 
     if (absolute_brightness_for(last_set_brightness) == abs_brightness)
         return last_set_brightness;
@@ -133,6 +177,11 @@ double repowerd::SysfsBacklight::get_brightness()
         return static_cast<double>(abs_brightness) / max_brightness;
 }
 
+int repowerd::SysfsBacklight::max_absolute_brightness()
+{
+    return max_brightness;
+}
+
 int repowerd::SysfsBacklight::absolute_brightness_for(double rel_brightness)
 {
     return static_cast<int>(round(rel_brightness * max_brightness));
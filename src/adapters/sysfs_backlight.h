@@ -20,10 +20,12 @@
 
 #include "backlight.h"
 
+#include "fd.h"
 #include "path.h"
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace repowerd
 {
@@ -33,12 +35,22 @@ class Filesystem;
 class SysfsBacklight : public Backlight
 {
 public:
+    // Uses the highest priority display backlight
     SysfsBacklight(
         std::shared_ptr<Log> const& log,
         std::shared_ptr<Filesystem> const& filesystem);
+    // Uses the backlight or LED device in sysfs_backlight_dir
+    SysfsBacklight(
+        std::shared_ptr<Log> const& log,
+        std::shared_ptr<Filesystem> const& filesystem,
+        Path const& sysfs_backlight_dir);
+
+    // Finds keyboard backlight LED devices (/sys/class/leds/*kbd_backlight*)
+    static std::vector<Path> keyboard_backlight_dirs(Filesystem& filesystem);
 
     void set_brightness(double) override;
     double get_brightness() override;
+    int max_absolute_brightness() override;
 
 private:
     int absolute_brightness_for(double relative_brightness);
@@ -47,6 +59,8 @@ private:
     Path const sysfs_backlight_dir;
     Path const sysfs_brightness_file;
     int const max_brightness;
+    // Kept open, since brightness transitions write to it many times
+    Fd const brightness_fd;
     double last_set_brightness;
 };
 
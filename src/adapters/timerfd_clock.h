@@ -0,0 +1,52 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "fd.h"
+
+#include <chrono>
+
+namespace repowerd
+{
+
+// The timerfd and the clocks used by TimerfdWakeupService, so that tests
+// can control the passage of time
+class TimerfdClock
+{
+public:
+    virtual ~TimerfdClock() = default;
+
+    // Returns a non-blocking fd, which becomes readable when it expires
+    virtual Fd create_timerfd() = 0;
+    // Arms the timerfd to expire at the wall clock time tp, with now being
+    // the current wall clock time, or disarms it if tp is time_point::max().
+    // Returns -1 and sets errno on failure, like timerfd_settime().
+    virtual int arm_timerfd(
+        int fd,
+        std::chrono::system_clock::time_point tp,
+        std::chrono::system_clock::time_point now) = 0;
+
+    virtual std::chrono::system_clock::time_point now() = 0;
+
+protected:
+    TimerfdClock() = default;
+    TimerfdClock(TimerfdClock const&) = delete;
+    TimerfdClock& operator=(TimerfdClock const&) = delete;
+};
+
+}
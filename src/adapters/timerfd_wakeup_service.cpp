@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "timerfd_wakeup_service.h"
+#include "event_loop_handler_registration.h"
+#include "timerfd_clock.h"
+
+#include "src/core/log.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace
+{
+char const* const log_tag = "TimerfdWakeupService";
+auto const null_handler = [](auto){};
+// How long to wait before retrying to arm the timerfd after a failure
+auto const rearm_retry_delay = std::chrono::seconds{1};
+}
+
+repowerd::TimerfdWakeupService::TimerfdWakeupService(
+    std::shared_ptr<Log> const& log,
+    std::shared_ptr<TimerfdClock> const& clock)
+    : log{log},
+      clock{clock},
+      timer_fd{clock->create_timerfd()},
+      wakeup_handler{null_handler},
+      rearm_retry_pending{false}
+{
+    event_loop.watch_fd(timer_fd, [this] { handle_timer_fd(); });
+}
+
+repowerd::TimerfdWakeupService::~TimerfdWakeupService()
+{
+    event_loop.stop();
+}
+
+std::string repowerd::TimerfdWakeupService::schedule_wakeup_at(
+    std::chrono::system_clock::time_point tp)
+{
+    return schedule_wakeup_at(tp, std::chrono::milliseconds{0});
+}
+
+std::string repowerd::TimerfdWakeupService::schedule_wakeup_at(
+    std::chrono::system_clock::time_point tp,
+    std::chrono::milliseconds tolerance)
+{
+    std::lock_guard<std::mutex> lock{wakeup_mutex};
+
+    auto const deadline_before = wakeups.next_deadline();
+    auto const cookie = wakeups.push(tp, tolerance);
+
+    if (wakeups.next_deadline() != deadline_before)
+        reset_timer_fd(clock->now());
+
+    return std::to_string(cookie);
+}
+
+void repowerd::TimerfdWakeupService::cancel_wakeup(std::string const& cookie)
+{
+    std::lock_guard<std::mutex> lock{wakeup_mutex};
+
+    auto const deadline_before = wakeups.next_deadline();
+
+    if (wakeups.cancel(parse_wakeup_cookie(cookie)) &&
+        wakeups.next_deadline() != deadline_before)
+    {
+        reset_timer_fd(clock->now());
+    }
+}
+
+repowerd::HandlerRegistration repowerd::TimerfdWakeupService::register_wakeup_handler(
+    WakeupHandler const& handler)
+{
+    return EventLoopHandlerRegistration{
+        event_loop,
+        [this, &handler] { wakeup_handler = handler; },
+        [this] { wakeup_handler = null_handler; }};
+}
+
+void repowerd::TimerfdWakeupService::handle_timer_fd()
+{
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {}
+
+    due_cookies.clear();
+
+    {
+        std::lock_guard<std::mutex> lock{wakeup_mutex};
+
+        // Use the same now for both, so that the timerfd isn't armed for a
+        // wakeup that was considered not due, or vice versa
+        auto const now = clock->now();
+        wakeups.pop_due(now, due_cookies);
+        reset_timer_fd(now);
+    }
+
+    if (due_cookies.empty())
+        return;
+
+    std::vector<std::string> cookies;
+    for (auto const cookie : due_cookies)
+        cookies.push_back(std::to_string(cookie));
+
+    wakeup_handler(cookies);
+}
+
+void repowerd::TimerfdWakeupService::reset_timer_fd(
+    std::chrono::system_clock::time_point now)
+{
+    if (clock->arm_timerfd(timer_fd, wakeups.next_deadline(), now) < 0)
+    {
+        // The timerfd keeps its previous arming, which may already have
+        // expired, so retry later instead of never waking up again
+        log->log(log_tag, "Failed to set timerfd: %s, retrying in %lds",
+                 strerror(errno), static_cast<long>(rearm_retry_delay.count()));
+
+        if (!rearm_retry_pending)
+        {
+            rearm_retry_pending = true;
+            event_loop.post_in(
+                rearm_retry_delay,
+                [this]
+                {
+                    std::lock_guard<std::mutex> lock{wakeup_mutex};
+                    rearm_retry_pending = false;
+                    reset_timer_fd(clock->now());
+                });
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "wakeup_service.h"
+#include "wakeup_queue.h"
+#include "event_loop.h"
+#include "fd.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace repowerd
+{
+class Log;
+class TimerfdClock;
+
+class TimerfdWakeupService : public WakeupService
+{
+public:
+    TimerfdWakeupService(
+        std::shared_ptr<Log> const& log,
+        std::shared_ptr<TimerfdClock> const& clock);
+    ~TimerfdWakeupService();
+
+    std::string schedule_wakeup_at(std::chrono::system_clock::time_point tp) override;
+    std::string schedule_wakeup_at(
+        std::chrono::system_clock::time_point tp,
+        std::chrono::milliseconds tolerance) override;
+    void cancel_wakeup(std::string const& cookie) override;
+
+    HandlerRegistration register_wakeup_handler(
+        WakeupHandler const& handler) override;
+
+private:
+    void handle_timer_fd();
+    void reset_timer_fd(std::chrono::system_clock::time_point now);
+
+    std::shared_ptr<Log> const log;
+    std::shared_ptr<TimerfdClock> const clock;
+    Fd const timer_fd;
+    EventLoop event_loop;
+    WakeupHandler wakeup_handler;
+
+    std::mutex wakeup_mutex;
+    WakeupQueue wakeups;
+    bool rearm_retry_pending;
+
+    // Only accessed from the event loop thread
+    std::vector<WakeupQueue::Cookie> due_cookies;
+};
+
+}
@@ -78,7 +78,7 @@ void repowerd::UbuntuLightSensor::static_sensor_reading_callback(
     auto const uls = static_cast<UbuntuLightSensor*>(context);
     float light_value{0.0f};
     uas_light_event_get_light(event, &light_value);
-    uls->event_loop.enqueue([uls, light_value] { uls->handle_light_event(light_value); });
+    uls->event_loop.post([uls, light_value] { uls->handle_light_event(light_value); });
 }
 
 void repowerd::UbuntuLightSensor::handle_light_event(double light)
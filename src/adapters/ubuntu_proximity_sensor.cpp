@@ -80,7 +80,7 @@ repowerd::ProximityState repowerd::UbuntuProximitySensor::proximity_state()
 
     auto const valid_state = wait_for_valid_state();
 
-    event_loop.enqueue(
+    event_loop.post(
         [this]
         {
             disable_proximity_events_unqueued(EnablementMode::without_handler);
@@ -129,7 +129,7 @@ void repowerd::UbuntuProximitySensor::static_sensor_reading_callback(
     auto const state = (distance == U_PROXIMITY_NEAR) ?
                        ProximityState::near : ProximityState::far;
 
-    ups->event_loop.enqueue([ups, state] { ups->handle_proximity_event(state); });
+    ups->event_loop.post([ups, state] { ups->handle_proximity_event(state); });
 }
 
 void repowerd::UbuntuProximitySensor::handle_proximity_event(ProximityState new_state)
@@ -214,7 +214,7 @@ void repowerd::UbuntuProximitySensor::schedule_synthetic_initial_event()
     // Some proximity sensors occasionally don't send an initial event when
     // enabled. Work around this by sending a synthetic initial event if no
     // events have been emitted "soon" after enabling the sensor.
-    event_loop.schedule_in(synthetic_event_delay,
+    event_loop.post_in(synthetic_event_delay,
         [this, expected_seqno = synthetic_event_seqno]
         {
             if (synthetic_event_seqno == expected_seqno)
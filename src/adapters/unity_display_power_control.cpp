@@ -30,9 +30,9 @@ char const* const log_tag = "UnityDisplayPowerControl";
 
 repowerd::UnityDisplayPowerControl::UnityDisplayPowerControl(
     std::shared_ptr<Log> const& log,
-    std::string const& dbus_bus_address)
+    DBusConnectionHandle const& dbus_connection)
     : log{log},
-      dbus_connection{dbus_bus_address}
+      dbus_connection{dbus_connection}
 {
 }
 
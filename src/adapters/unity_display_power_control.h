@@ -34,7 +34,7 @@ class UnityDisplayPowerControl : public DisplayPowerControl
 public:
     UnityDisplayPowerControl(
         std::shared_ptr<Log> const& log,
-        std::string const& dbus_bus_address);
+        DBusConnectionHandle const& dbus_connection);
 
     void turn_on() override;
     void turn_off() override;
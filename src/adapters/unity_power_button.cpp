@@ -28,8 +28,16 @@ char const* const dbus_power_button_interface = "com.canonical.Unity.PowerButton
 }
 
 repowerd::UnityPowerButton::UnityPowerButton(
-    std::string const& dbus_bus_address)
-    : dbus_connection{dbus_bus_address},
+    DBusConnectionHandle const& dbus_connection)
+    : UnityPowerButton{dbus_connection, nullptr}
+{
+}
+
+repowerd::UnityPowerButton::UnityPowerButton(
+    DBusConnectionHandle const& dbus_connection,
+    std::shared_ptr<EventLoop> const& shared_event_loop)
+    : dbus_connection{dbus_connection},
+      dbus_event_loop{shared_event_loop},
       power_button_handler{null_handler}
 {
 }
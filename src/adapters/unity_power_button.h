@@ -30,7 +30,10 @@ namespace repowerd
 class UnityPowerButton : public PowerButton, public PowerButtonEventSink
 {
 public:
-    UnityPowerButton(std::string const& dbus_bus_address);
+    UnityPowerButton(DBusConnectionHandle const& dbus_connection);
+    UnityPowerButton(
+        DBusConnectionHandle const& dbus_connection,
+        std::shared_ptr<EventLoop> const& shared_event_loop);
 
     void start_processing() override;
 
@@ -20,13 +20,18 @@
 #include "unity_screen_power_state_change_reason.h"
 #include "brightness_notification.h"
 #include "event_loop_handler_registration.h"
+#include "null_request_journal.h"
+#include "request_journal.h"
+#include "scoped_g_error.h"
 #include "temporary_suspend_inhibition.h"
 #include "wakeup_service.h"
 
+#include "src/core/daemon_statistics.h"
 #include "src/core/infinite_timeout.h"
 #include "src/core/log.h"
 #include "src/core/suspend_control.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace
@@ -130,6 +135,15 @@ char const* const unity_powerd_service_introspection = R"(
       <arg type='t' name='time' direction='in' />
       <arg type='s' name='cookie' direction='out' />
     </method>
+    <method name='requestWakeupWithTolerance'>
+      <!-- Like requestWakeup, but the wakeup may happen at any point up to
+           tolerance seconds after time, which allows wakeups with
+           overlapping windows to be served by a single resume -->
+      <arg type='s' name='name' direction='in' />
+      <arg type='t' name='time' direction='in' />
+      <arg type='u' name='tolerance' direction='in' />
+      <arg type='s' name='cookie' direction='out' />
+    </method>
     <method name='clearWakeup'>
       <arg type='s' name='cookie' direction='in' />
     </method>
@@ -138,6 +152,18 @@ char const* const unity_powerd_service_introspection = R"(
            autobrightness is supported, in that order -->
       <arg type='(iiiib)' name='params' direction="out" />
     </method>
+    <method name='getEventStatistics'>
+      <!-- Returns, for each event type, its name, the number of dispatched
+           and coalesced events, and the 50th percentile, 99th percentile
+           and maximum of the queueing and handling latencies in
+           microseconds, in that order -->
+      <arg type='a(stttttttt)' name='statistics' direction="out" />
+    </method>
+    <method name='getHandlerStallCount'>
+      <!-- Returns the number of event handlers that ran for longer than
+           the handler stall budget -->
+      <arg type='t' name='count' direction="out" />
+    </method>
     <signal name='Wakeup'>
     </signal>
   </interface>
@@ -148,17 +174,46 @@ char const* const unity_powerd_service_introspection = R"(
 repowerd::UnityScreenService::UnityScreenService(
     std::shared_ptr<WakeupService> const& wakeup_service,
     std::shared_ptr<BrightnessNotification> const& brightness_notification,
+    std::shared_ptr<DaemonStatistics> const& daemon_statistics,
     std::shared_ptr<Log> const& log,
     std::shared_ptr<SuspendControl> const& suspend_control,
     std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
     DeviceConfig const& device_config,
-    std::string const& dbus_bus_address)
+    DBusConnectionHandle const& dbus_connection)
+    : UnityScreenService{
+          wakeup_service,
+          brightness_notification,
+          daemon_statistics,
+          log,
+          suspend_control,
+          temporary_suspend_inhibition,
+          device_config,
+          dbus_connection,
+          nullptr,
+          std::make_shared<NullRequestJournal>()}
+{
+}
+
+repowerd::UnityScreenService::UnityScreenService(
+    std::shared_ptr<WakeupService> const& wakeup_service,
+    std::shared_ptr<BrightnessNotification> const& brightness_notification,
+    std::shared_ptr<DaemonStatistics> const& daemon_statistics,
+    std::shared_ptr<Log> const& log,
+    std::shared_ptr<SuspendControl> const& suspend_control,
+    std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
+    DeviceConfig const& device_config,
+    DBusConnectionHandle const& dbus_connection,
+    std::shared_ptr<EventLoop> const& shared_event_loop,
+    std::shared_ptr<RequestJournal> const& request_journal)
     : wakeup_service{wakeup_service},
       brightness_notification{brightness_notification},
+      daemon_statistics{daemon_statistics},
       suspend_control{suspend_control},
       temporary_suspend_inhibition{temporary_suspend_inhibition},
       log{log},
-      dbus_connection{dbus_bus_address},
+      request_journal{request_journal},
+      dbus_connection{dbus_connection},
+      dbus_event_loop{shared_event_loop},
       disable_inactivity_timeout_handler{null_handler},
       enable_inactivity_timeout_handler{null_handler},
       set_inactivity_timeout_handler{null_arg_handler},
@@ -170,6 +225,7 @@ repowerd::UnityScreenService::UnityScreenService(
       started{false},
       next_keep_display_on_id{1},
       next_request_sys_state_id{1},
+      next_wakeup_cookie{1},
       brightness_params(BrightnessParams::from_device_config(device_config))
 {
 }
@@ -234,20 +290,31 @@ void repowerd::UnityScreenService::start_processing()
         });
 
     wakeup_handler_registration = wakeup_service->register_wakeup_handler(
-        [this] (std::string const& cookie)
+        [this] (std::vector<std::string> const& cookies)
         {
+            // Wakeups served by the same resume share a single inhibition
+            // and Wakeup signal
             temporary_suspend_inhibition->inhibit_suspend_for(
-                std::chrono::seconds{3}, "Wakeup_" + cookie);
-
-            dbus_event_loop.enqueue([this] { dbus_emit_Wakeup(); });
+                std::chrono::seconds{3}, "Wakeup_" + cookies.front());
+
+            dbus_event_loop.post(
+                [this,cookies]
+                {
+                    dbus_remove_fired_wakeups(cookies);
+                    dbus_emit_Wakeup();
+                });
         });
 
     brightness_handler_registration = brightness_notification->register_brightness_handler(
         [this] (double brightness)
         {
-            dbus_event_loop.enqueue([this,brightness] { dbus_emit_brightness(brightness); });
+            dbus_event_loop.post([this,brightness] { dbus_emit_brightness(brightness); });
         });
 
+    // Restore requests before clients can reach us, so that their
+    // requests are not mixed with the restored ones
+    dbus_event_loop.enqueue([this] { dbus_restore_journaled_requests(); }).wait();
+
     dbus_connection.request_name(dbus_screen_service_name);
     dbus_connection.request_name(dbus_powerd_service_name);
 
@@ -457,6 +524,18 @@ void repowerd::UnityScreenService::dbus_method_call(
         g_dbus_method_invocation_return_value(
             invocation, g_variant_new("(s)", cookie.c_str()));
     }
+    else if (method_name == "requestWakeupWithTolerance")
+    {
+        char const* name{""};
+        uint64_t time{0};
+        uint32_t tolerance{0};
+        g_variant_get(parameters, "(&stu)", &name, &time, &tolerance);
+
+        auto const cookie = dbus_requestWakeupWithTolerance(sender, name, time, tolerance);
+
+        g_dbus_method_invocation_return_value(
+            invocation, g_variant_new("(s)", cookie.c_str()));
+    }
     else if (method_name == "clearWakeup")
     {
         char const* cookie{""};
@@ -479,6 +558,19 @@ void repowerd::UnityScreenService::dbus_method_call(
                 params.default_value,
                 params.autobrightness_supported));
     }
+    else if (method_name == "getEventStatistics")
+    {
+        auto const statistics = dbus_getEventStatistics();
+
+        g_dbus_method_invocation_return_value(invocation, statistics);
+    }
+    else if (method_name == "getHandlerStallCount")
+    {
+        auto const count = dbus_getHandlerStallCount();
+
+        g_dbus_method_invocation_return_value(
+            invocation, g_variant_new("(t)", static_cast<guint64>(count)));
+    }
     else
     {
         dbus_unknown_method(sender, method_name);
@@ -576,6 +668,10 @@ void repowerd::UnityScreenService::dbus_NameOwnerChanged(
             enable_inactivity_timeout_handler();
         }
 
+        auto const range = request_sys_state_ids.equal_range(name);
+        for (auto iter = range.first; iter != range.second; ++iter)
+            request_journal->record_sys_state_clear(name, iter->second);
+
         if (request_sys_state_ids.erase(name) > 0 &&
             request_sys_state_ids.empty())
         {
@@ -683,6 +779,7 @@ std::string repowerd::UnityScreenService::dbus_requestSysState(
 
     auto const id = next_request_sys_state_id++;
     request_sys_state_ids.emplace(sender, id);
+    request_journal->record_sys_state_request(sender, id);
 
     suspend_control->disallow_suspend(suspend_id);
 
@@ -712,6 +809,7 @@ void repowerd::UnityScreenService::dbus_clearSysState(
         if (iter->second == id)
         {
             request_sys_state_ids.erase(iter);
+            request_journal->record_sys_state_clear(sender, id);
             id_removed = true;
             break;
         }
@@ -731,8 +829,9 @@ std::string repowerd::UnityScreenService::dbus_requestWakeup(
     log->log(log_tag, "dbus_requestWakeup(%s,%s,%ju)",
              sender.c_str(), name.c_str(), static_cast<uintmax_t>(time));
 
-    auto const cookie =
-        wakeup_service->schedule_wakeup_at(std::chrono::system_clock::from_time_t(time));
+    auto const tp = std::chrono::system_clock::from_time_t(time);
+    auto const cookie = dbus_add_wakeup(
+        wakeup_service->schedule_wakeup_at(tp), tp, std::chrono::milliseconds{0});
 
     log->log(log_tag, "dbus_requestWakeup(%s,%s,%ju) => %s",
              sender.c_str(), name.c_str(), static_cast<uintmax_t>(time), cookie.c_str());
@@ -740,12 +839,43 @@ std::string repowerd::UnityScreenService::dbus_requestWakeup(
     return cookie;
 }
 
+std::string repowerd::UnityScreenService::dbus_requestWakeupWithTolerance(
+    std::string const& sender,
+    std::string const& name,
+    uint64_t time,
+    uint32_t tolerance)
+{
+    log->log(log_tag, "dbus_requestWakeupWithTolerance(%s,%s,%ju,%u)",
+             sender.c_str(), name.c_str(), static_cast<uintmax_t>(time), tolerance);
+
+    auto const tp = std::chrono::system_clock::from_time_t(time);
+    std::chrono::milliseconds const tolerance_ms{std::chrono::seconds{tolerance}};
+    auto const cookie = dbus_add_wakeup(
+        wakeup_service->schedule_wakeup_at(tp, tolerance_ms), tp, tolerance_ms);
+
+    log->log(log_tag, "dbus_requestWakeupWithTolerance(%s,%s,%ju,%u) => %s",
+             sender.c_str(), name.c_str(), static_cast<uintmax_t>(time), tolerance,
+             cookie.c_str());
+
+    return cookie;
+}
+
 void repowerd::UnityScreenService::dbus_clearWakeup(
     std::string const& sender, std::string const& cookie)
 {
     log->log(log_tag, "dbus_clearWakeup(%s,%s)", sender.c_str(), cookie.c_str());
 
-    wakeup_service->cancel_wakeup(cookie);
+    uint64_t client_cookie = 0;
+    try { client_cookie = std::stoull(cookie); } catch(...) {}
+
+    auto const iter = wakeup_service_cookies.find(client_cookie);
+    if (iter == wakeup_service_cookies.end())
+        return;
+
+    wakeup_service->cancel_wakeup(iter->second);
+    wakeup_client_cookies.erase(iter->second);
+    wakeup_service_cookies.erase(iter);
+    request_journal->record_wakeup_clear(client_cookie);
 }
 
 repowerd::BrightnessParams repowerd::UnityScreenService::dbus_getBrightnessParams()
@@ -760,6 +890,47 @@ repowerd::BrightnessParams repowerd::UnityScreenService::dbus_getBrightnessParam
     return brightness_params;
 }
 
+GVariant* repowerd::UnityScreenService::dbus_getEventStatistics()
+{
+    log->log(log_tag, "dbus_getEventStatistics()");
+
+    auto const us =
+        [] (std::chrono::microseconds d) { return static_cast<guint64>(d.count()); };
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(stttttttt)"));
+
+    for (size_t i = 0; i < num_daemon_event_types; ++i)
+    {
+        auto const type = static_cast<DaemonEventType>(i);
+        auto const& queue_latency = daemon_statistics->queue_latency(type);
+        auto const& handler_latency = daemon_statistics->handler_latency(type);
+
+        g_variant_builder_add(
+            &builder, "(stttttttt)",
+            name_for(type),
+            static_cast<guint64>(daemon_statistics->dispatched(type)),
+            static_cast<guint64>(daemon_statistics->coalesced(type)),
+            us(queue_latency.percentile(50)),
+            us(queue_latency.percentile(99)),
+            us(queue_latency.max()),
+            us(handler_latency.percentile(50)),
+            us(handler_latency.percentile(99)),
+            us(handler_latency.max()));
+    }
+
+    return g_variant_new("(a(stttttttt))", &builder);
+}
+
+uint64_t repowerd::UnityScreenService::dbus_getHandlerStallCount()
+{
+    auto const count = daemon_statistics->total_stalls();
+
+    log->log(log_tag, "dbus_getHandlerStallCount() => %ju", static_cast<uintmax_t>(count));
+
+    return count;
+}
+
 void repowerd::UnityScreenService::dbus_emit_Wakeup()
 {
     log->log(log_tag, "dbus_emit_Wakeup()");
@@ -793,6 +964,107 @@ void repowerd::UnityScreenService::dbus_emit_brightness(double brightness)
         nullptr);
 }
 
+std::string repowerd::UnityScreenService::dbus_add_wakeup(
+    std::string const& service_cookie,
+    std::chrono::system_clock::time_point time,
+    std::chrono::milliseconds tolerance)
+{
+    auto const client_cookie = next_wakeup_cookie++;
+
+    wakeup_service_cookies[client_cookie] = service_cookie;
+    wakeup_client_cookies[service_cookie] = client_cookie;
+    request_journal->record_wakeup_request(client_cookie, time, tolerance);
+
+    return std::to_string(client_cookie);
+}
+
+void repowerd::UnityScreenService::dbus_remove_fired_wakeups(
+    std::vector<std::string> const& service_cookies)
+{
+    for (auto const& service_cookie : service_cookies)
+    {
+        auto const iter = wakeup_client_cookies.find(service_cookie);
+        if (iter == wakeup_client_cookies.end())
+            continue;
+
+        request_journal->record_wakeup_clear(iter->second);
+        wakeup_service_cookies.erase(iter->second);
+        wakeup_client_cookies.erase(iter);
+    }
+}
+
+void repowerd::UnityScreenService::dbus_restore_journaled_requests()
+{
+    auto const requests = request_journal->outstanding_requests();
+
+    for (auto const& wakeup : requests.wakeups)
+    {
+        // Wakeups that became due while we were not running are scheduled
+        // in the past, so they fire immediately
+        auto const service_cookie =
+            wakeup_service->schedule_wakeup_at(wakeup.time, wakeup.tolerance);
+
+        wakeup_service_cookies[wakeup.cookie] = service_cookie;
+        wakeup_client_cookies[service_cookie] = wakeup.cookie;
+        next_wakeup_cookie = std::max(next_wakeup_cookie, wakeup.cookie + 1);
+
+        log->log(log_tag, "Restored wakeup %ju", static_cast<uintmax_t>(wakeup.cookie));
+    }
+
+    for (auto const& sys_state : requests.sys_states)
+    {
+        // Requests from clients that disconnected while we were not running
+        // would never be cleared
+        if (!dbus_name_has_owner(sys_state.sender))
+        {
+            request_journal->record_sys_state_clear(sys_state.sender, sys_state.id);
+            continue;
+        }
+
+        request_sys_state_ids.emplace(sys_state.sender, sys_state.id);
+        next_request_sys_state_id = std::max(next_request_sys_state_id, sys_state.id + 1);
+
+        log->log(log_tag, "Restored sys state request (%s,%d)",
+                 sys_state.sender.c_str(), sys_state.id);
+    }
+
+    if (!request_sys_state_ids.empty())
+        suspend_control->disallow_suspend(suspend_id);
+}
+
+bool repowerd::UnityScreenService::dbus_name_has_owner(std::string const& name)
+{
+    int constexpr timeout_default = -1;
+    auto constexpr null_cancellable = nullptr;
+    ScopedGError error;
+
+    auto const result = g_dbus_connection_call_sync(
+        dbus_connection,
+        "org.freedesktop.DBus",
+        "/org/freedesktop/DBus",
+        "org.freedesktop.DBus",
+        "NameHasOwner",
+        g_variant_new("(s)", name.c_str()),
+        G_VARIANT_TYPE("(b)"),
+        G_DBUS_CALL_FLAGS_NONE,
+        timeout_default,
+        null_cancellable,
+        error);
+
+    if (!result)
+    {
+        log->log(log_tag, "dbus_name_has_owner(%s) failed: %s",
+                 name.c_str(), error.message_str().c_str());
+        return false;
+    }
+
+    gboolean has_owner{FALSE};
+    g_variant_get(result, "(b)", &has_owner);
+    g_variant_unref(result);
+
+    return has_owner;
+}
+
 void repowerd::UnityScreenService::dbus_unknown_method(
     std::string const& sender, std::string const& name)
 {
@@ -26,18 +26,22 @@
 #include "dbus_connection_handle.h"
 #include "dbus_event_loop.h"
 
+#include <chrono>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <gio/gio.h>
 
 namespace repowerd
 {
 class BrightnessNotification;
+class DaemonStatistics;
 class DeviceConfig;
 class Log;
+class RequestJournal;
 class SuspendControl;
 class TemporarySuspendInhibition;
 class WakeupService;
@@ -50,11 +54,23 @@ public:
     UnityScreenService(
         std::shared_ptr<WakeupService> const& wakeup_service,
         std::shared_ptr<BrightnessNotification> const& brightness_notification,
+        std::shared_ptr<DaemonStatistics> const& daemon_statistics,
         std::shared_ptr<Log> const& log,
         std::shared_ptr<SuspendControl> const& suspend_control,
         std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
         DeviceConfig const& device_config,
-        std::string const& dbus_bus_address);
+        DBusConnectionHandle const& dbus_connection);
+    UnityScreenService(
+        std::shared_ptr<WakeupService> const& wakeup_service,
+        std::shared_ptr<BrightnessNotification> const& brightness_notification,
+        std::shared_ptr<DaemonStatistics> const& daemon_statistics,
+        std::shared_ptr<Log> const& log,
+        std::shared_ptr<SuspendControl> const& suspend_control,
+        std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
+        DeviceConfig const& device_config,
+        DBusConnectionHandle const& dbus_connection,
+        std::shared_ptr<EventLoop> const& shared_event_loop,
+        std::shared_ptr<RequestJournal> const& request_journal);
 
     void start_processing() override;
 
@@ -123,18 +139,35 @@ private:
         std::string const& sender,
         std::string const& name,
         uint64_t time);
+    std::string dbus_requestWakeupWithTolerance(
+        std::string const& sender,
+        std::string const& name,
+        uint64_t time,
+        uint32_t tolerance);
     void dbus_clearWakeup(std::string const& sender, std::string const& cookie);
     BrightnessParams dbus_getBrightnessParams();
+    GVariant* dbus_getEventStatistics();
+    uint64_t dbus_getHandlerStallCount();
     void dbus_emit_Wakeup();
     void dbus_emit_brightness(double brightness);
 
     void dbus_unknown_method(std::string const& sender, std::string const& name);
 
+    std::string dbus_add_wakeup(
+        std::string const& service_cookie,
+        std::chrono::system_clock::time_point time,
+        std::chrono::milliseconds tolerance);
+    void dbus_remove_fired_wakeups(std::vector<std::string> const& service_cookies);
+    void dbus_restore_journaled_requests();
+    bool dbus_name_has_owner(std::string const& name);
+
     std::shared_ptr<WakeupService> const wakeup_service;
     std::shared_ptr<BrightnessNotification> const brightness_notification;
+    std::shared_ptr<DaemonStatistics> const daemon_statistics;
     std::shared_ptr<SuspendControl> const suspend_control;
     std::shared_ptr<TemporarySuspendInhibition> const temporary_suspend_inhibition;
     std::shared_ptr<Log> const log;
+    std::shared_ptr<RequestJournal> const request_journal;
     DBusConnectionHandle dbus_connection;
     DBusEventLoop dbus_event_loop;
 
@@ -155,6 +188,12 @@ private:
 
     std::unordered_multimap<std::string,int32_t> request_sys_state_ids;
     int32_t next_request_sys_state_id;
+
+    // The wakeup cookies we hand out to clients are our own, so that they
+    // stay valid when journaled wakeups are rescheduled after a restart
+    std::unordered_map<uint64_t,std::string> wakeup_service_cookies;
+    std::unordered_map<std::string,uint64_t> wakeup_client_cookies;
+    uint64_t next_wakeup_cookie;
     BrightnessParams brightness_params;
 
     // These need to be at the end, so that handlers are unregistered first on
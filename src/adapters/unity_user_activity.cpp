@@ -37,8 +37,16 @@ repowerd::UserActivityType user_activity_type_from_dbus_value(int32_t value)
 }
 
 repowerd::UnityUserActivity::UnityUserActivity(
-    std::string const& dbus_bus_address)
-    : dbus_connection{dbus_bus_address},
+    DBusConnectionHandle const& dbus_connection)
+    : UnityUserActivity{dbus_connection, nullptr}
+{
+}
+
+repowerd::UnityUserActivity::UnityUserActivity(
+    DBusConnectionHandle const& dbus_connection,
+    std::shared_ptr<EventLoop> const& shared_event_loop)
+    : dbus_connection{dbus_connection},
+      dbus_event_loop{shared_event_loop},
       user_activity_handler{null_handler}
 {
 }
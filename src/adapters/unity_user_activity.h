@@ -29,7 +29,10 @@ namespace repowerd
 class UnityUserActivity : public UserActivity
 {
 public:
-    UnityUserActivity(std::string const& dbus_bus_address);
+    UnityUserActivity(DBusConnectionHandle const& dbus_connection);
+    UnityUserActivity(
+        DBusConnectionHandle const& dbus_connection,
+        std::shared_ptr<EventLoop> const& shared_event_loop);
 
     void start_processing() override;
     HandlerRegistration register_user_activity_handler(
@@ -67,11 +67,27 @@ repowerd::UPowerPowerSource::UPowerPowerSource(
     std::shared_ptr<Log> const& log,
     std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
     DeviceConfig const& device_config,
-    std::string const& dbus_bus_address)
+    DBusConnectionHandle const& dbus_connection)
+    : UPowerPowerSource{
+          log,
+          temporary_suspend_inhibition,
+          device_config,
+          dbus_connection,
+          nullptr}
+{
+}
+
+repowerd::UPowerPowerSource::UPowerPowerSource(
+    std::shared_ptr<Log> const& log,
+    std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
+    DeviceConfig const& device_config,
+    DBusConnectionHandle const& dbus_connection,
+    std::shared_ptr<EventLoop> const& shared_event_loop)
     : log{log},
       temporary_suspend_inhibition{temporary_suspend_inhibition},
       critical_temperature{get_critical_temperature(device_config)},
-      dbus_connection{dbus_bus_address},
+      dbus_connection{dbus_connection},
+      dbus_event_loop{shared_event_loop},
       power_source_change_handler{null_handler},
       power_source_critical_handler{null_handler}
 {
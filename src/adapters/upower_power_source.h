@@ -39,7 +39,13 @@ public:
         std::shared_ptr<Log> const& log,
         std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
         DeviceConfig const& device_config,
-        std::string const& dbus_bus_address);
+        DBusConnectionHandle const& dbus_connection);
+    UPowerPowerSource(
+        std::shared_ptr<Log> const& log,
+        std::shared_ptr<TemporarySuspendInhibition> const& temporary_suspend_inhibition,
+        DeviceConfig const& device_config,
+        DBusConnectionHandle const& dbus_connection,
+        std::shared_ptr<EventLoop> const& shared_event_loop);
 
     void start_processing() override;
 
@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "wakeup_queue.h"
+
+#include <cstdlib>
+
+repowerd::WakeupQueue::WakeupQueue()
+    : next_cookie{1}
+{
+}
+
+repowerd::WakeupQueue::Cookie repowerd::WakeupQueue::push(TimePoint deadline)
+{
+    return push(deadline, std::chrono::milliseconds{0});
+}
+
+repowerd::WakeupQueue::Cookie repowerd::WakeupQueue::push(
+    TimePoint window_start, std::chrono::milliseconds tolerance)
+{
+    auto const cookie = next_cookie++;
+
+    window_starts.push(cookie, window_start);
+    window_ends.push(cookie, window_start + tolerance);
+
+    return cookie;
+}
+
+bool repowerd::WakeupQueue::cancel(Cookie cookie)
+{
+    window_ends.cancel(cookie);
+    return window_starts.cancel(cookie);
+}
+
+void repowerd::WakeupQueue::pop_due(TimePoint now, std::vector<Cookie>& due)
+{
+    auto const first_due = due.size();
+
+    window_starts.pop_due(now, due);
+
+    for (auto i = first_due; i < due.size(); ++i)
+        window_ends.cancel(due[i]);
+}
+
+void repowerd::WakeupQueue::pop_next_batch(std::vector<Cookie>& batch)
+{
+    auto const deadline = next_deadline();
+    if (deadline != TimePoint::max())
+        pop_due(deadline, batch);
+}
+
+repowerd::WakeupQueue::TimePoint repowerd::WakeupQueue::next_deadline()
+{
+    return window_ends.next_deadline();
+}
+
+size_t repowerd::WakeupQueue::size() const
+{
+    return window_starts.size();
+}
+
+repowerd::WakeupQueue::Cookie repowerd::parse_wakeup_cookie(std::string const& str)
+{
+    char* end{nullptr};
+    auto const cookie = strtoull(str.c_str(), &end, 10);
+    return (str.empty() || *end != '\0') ? 0 : cookie;
+}
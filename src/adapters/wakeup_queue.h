@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#pragma once
+
+#include "alarm_heap.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace repowerd
+{
+
+// Pending wakeup windows indexed by window start and by window end, in two
+// lazily cancelled heaps keyed by cookie, like EventLoopTimer alarms.
+//
+// Resuming at the earliest window end, and serving all wakeups whose
+// windows have started by then, satisfies as many windows as possible with
+// each resume.
+class WakeupQueue
+{
+public:
+    using TimePoint = std::chrono::system_clock::time_point;
+    using Cookie = uint64_t;
+
+    WakeupQueue();
+
+    // Returns a new cookie for the wakeup, never 0
+    Cookie push(TimePoint deadline);
+    Cookie push(TimePoint window_start, std::chrono::milliseconds tolerance);
+    // Returns false if there is no pending wakeup with this cookie
+    bool cancel(Cookie cookie);
+
+    // Appends the cookies of the wakeups whose windows start at or before
+    // now to due, in window start order, and removes them from the queue
+    void pop_due(TimePoint now, std::vector<Cookie>& due);
+    // Like pop_due(), at the time of the next resume
+    void pop_next_batch(std::vector<Cookie>& batch);
+
+    // The time of the next resume, i.e., the earliest window end, or
+    // TimePoint::max() if empty
+    TimePoint next_deadline();
+
+    size_t size() const;
+
+private:
+    BasicAlarmHeap<Cookie,TimePoint> window_starts;
+    BasicAlarmHeap<Cookie,TimePoint> window_ends;
+    Cookie next_cookie;
+};
+
+// Returns 0, which is never a valid cookie, for malformed cookie strings
+WakeupQueue::Cookie parse_wakeup_cookie(std::string const& str);
+
+}
@@ -23,11 +23,13 @@
 #include <chrono>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace repowerd
 {
 
-using WakeupHandler = std::function<void(std::string const&)>;
+// Called once with the cookies of all the wakeups served by a single resume
+using WakeupHandler = std::function<void(std::vector<std::string> const& cookies)>;
 
 class WakeupService
 {
@@ -35,6 +37,12 @@ public:
     virtual ~WakeupService() = default;
 
     virtual std::string schedule_wakeup_at(std::chrono::system_clock::time_point tp) = 0;
+    // The wakeup may happen at any point in [tp, tp + tolerance], which
+    // allows the service to serve wakeups with overlapping windows with a
+    // single resume
+    virtual std::string schedule_wakeup_at(
+        std::chrono::system_clock::time_point tp,
+        std::chrono::milliseconds tolerance) = 0;
     virtual void cancel_wakeup(std::string const& cookie) = 0;
     virtual HandlerRegistration register_wakeup_handler(WakeupHandler const& handler) = 0;
 
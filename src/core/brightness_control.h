@@ -20,9 +20,29 @@
 
 #include "handler_registration.h"
 
+#include <cstdint>
+#include <functional>
+
 namespace repowerd
 {
 
+// Identifies an off transition, so that its completion can be told apart
+// from the completion of earlier off transitions
+using BrightnessTransitionId = uint32_t;
+BrightnessTransitionId constexpr no_brightness_transition_id{0};
+
+using BrightnessTransitionCompleteHandler =
+    std::function<void(BrightnessTransitionId id, double brightness)>;
+
+// Requests return immediately, and the resulting brightness transitions are
+// carried out asynchronously. When a request has been carried out, including
+// a request that didn't need to change the brightness, the transition
+// complete handler is called with the brightness reached. If that request
+// was an off request, the handler also gets the id set_off_brightness()
+// returned for it, otherwise no_brightness_transition_id. Controls without
+// real transitions may call the handler from within the request itself, so
+// the handler must not call back into the requester (the daemon only
+// enqueues an event for the state machine).
 class BrightnessControl
 {
 public:
@@ -33,7 +53,10 @@ public:
     virtual void set_dim_brightness() = 0;
     virtual void set_normal_brightness() = 0;
     virtual void set_normal_brightness_value(double) = 0;
-    virtual void set_off_brightness() = 0;
+    virtual BrightnessTransitionId set_off_brightness() = 0;
+
+    virtual HandlerRegistration register_brightness_transition_complete_handler(
+        BrightnessTransitionCompleteHandler const& handler) = 0;
 
 protected:
     BrightnessControl() = default;
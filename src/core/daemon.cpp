@@ -20,6 +20,8 @@
 
 #include "brightness_control.h"
 #include "client_requests.h"
+#include "daemon_event_trace.h"
+#include "daemon_statistics.h"
 #include "display_power_control.h"
 #include "notification_service.h"
 #include "power_button.h"
@@ -32,9 +34,19 @@
 
 #include <future>
 
+namespace
+{
+// Bounds the starvation of lower priority lanes: a lane with pending
+// events is passed over at most this many times before it gets to
+// dispatch an event, regardless of the load in higher lanes
+unsigned int const max_times_passed_over{8};
+}
+
 repowerd::Daemon::Daemon(DaemonConfig& config)
     : brightness_control{config.the_brightness_control()},
       client_requests{config.the_client_requests()},
+      daemon_event_trace{config.the_daemon_event_trace()},
+      daemon_statistics{config.the_daemon_statistics()},
       notification_service{config.the_notification_service()},
       power_button{config.the_power_button()},
       power_source{config.the_power_source()},
@@ -43,29 +55,46 @@ repowerd::Daemon::Daemon(DaemonConfig& config)
       timer{config.the_timer()},
       user_activity{config.the_user_activity()},
       voice_call_service{config.the_voice_call_service()},
-      running{false}
+      running{true},
+      handler_watchdog{
+          config.the_daemon_statistics(),
+          config.the_log(),
+          config.handler_stall_budget()}
 {
     if (config.turn_on_display_at_startup())
-        enqueue_action([this] { state_machine->handle_turn_on_display(); });
+        enqueue_event(DaemonEventType::turn_on_display);
 }
 
 void repowerd::Daemon::run()
 {
     auto const registrations = register_event_handlers();
     start_event_processing();
-
-    running = true;
+    handler_watchdog.start();
 
     while (running)
     {
-        auto const ev = dequeue_action();
-        ev();
+        refill_pending_events();
+
+        auto const lane = next_lane_to_dispatch();
+
+        if (lane < num_daemon_event_lanes)
+        {
+            dispatch_next_event(lane);
+        }
+        else
+        {
+            complete_waiting_flushes();
+            event_queue.wait_for_events();
+        }
     }
+
+    handler_watchdog.stop();
 }
 
 void repowerd::Daemon::stop()
 {
-    enqueue_priority_action([this] { running = false; });
+    running = false;
+    event_queue.wake();
 }
 
 void repowerd::Daemon::flush()
@@ -73,7 +102,7 @@ void repowerd::Daemon::flush()
     std::promise<void> flushed_promise;
     auto flushed_future = flushed_promise.get_future();
 
-    enqueue_action([&flushed_promise] { flushed_promise.set_value(); });
+    enqueue_event(DaemonEvent::flush(&flushed_promise));
 
     flushed_future.wait();
 }
@@ -88,16 +117,16 @@ repowerd::Daemon::register_event_handlers()
             [this] (PowerButtonState state)
             {
                 if (state == PowerButtonState::pressed)
-                    enqueue_action([this] { state_machine->handle_power_button_press(); });
+                    enqueue_event(DaemonEventType::power_button_press);
                 else if (state == PowerButtonState::released)
-                    enqueue_action([this] { state_machine->handle_power_button_release(); } );
+                    enqueue_event(DaemonEventType::power_button_release);
             }));
 
     registrations.push_back(
         timer->register_alarm_handler(
             [this] (AlarmId id)
             {
-                enqueue_action([this, id] { state_machine->handle_alarm(id); });
+                enqueue_event(DaemonEvent::alarm(id));
             }));
 
     registrations.push_back(
@@ -105,15 +134,9 @@ repowerd::Daemon::register_event_handlers()
             [this] (UserActivityType type)
             {
                 if (type == UserActivityType::change_power_state)
-                {
-                    enqueue_action(
-                        [this] { state_machine->handle_user_activity_changing_power_state(); });
-                }
+                    enqueue_event(DaemonEventType::user_activity_changing_power_state);
                 else if (type == UserActivityType::extend_power_state)
-                {
-                    enqueue_action(
-                        [this] { state_machine->handle_user_activity_extending_power_state(); });
-                }
+                    enqueue_event(DaemonEventType::user_activity_extending_power_state);
             }));
 
     registrations.push_back(
@@ -121,111 +144,100 @@ repowerd::Daemon::register_event_handlers()
             [this] (ProximityState state)
             {
                 if (state == ProximityState::far)
-                {
-                    enqueue_action(
-                        [this] { state_machine->handle_proximity_far(); });
-                }
+                    enqueue_event(DaemonEventType::proximity_far);
                 else if (state == ProximityState::near)
-                {
-                    enqueue_action(
-                        [this] { state_machine->handle_proximity_near(); });
-                }
+                    enqueue_event(DaemonEventType::proximity_near);
             }));
 
     registrations.push_back(
         client_requests->register_enable_inactivity_timeout_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_enable_inactivity_timeout(); });
+                enqueue_event(DaemonEventType::enable_inactivity_timeout);
             }));
 
     registrations.push_back(
         client_requests->register_disable_inactivity_timeout_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_disable_inactivity_timeout(); });
+                enqueue_event(DaemonEventType::disable_inactivity_timeout);
             }));
 
     registrations.push_back(
         client_requests->register_set_inactivity_timeout_handler(
             [this] (std::chrono::milliseconds timeout)
             {
-                enqueue_action(
-                    [this,timeout] { state_machine->handle_set_inactivity_timeout(timeout); });
+                enqueue_event(DaemonEvent::set_inactivity_timeout(timeout));
             }));
 
     registrations.push_back(
         notification_service->register_notification_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_notification(); });
+                enqueue_event(DaemonEventType::notification);
             }));
 
     registrations.push_back(
         notification_service->register_no_notification_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_no_notification(); });
+                enqueue_event(DaemonEventType::no_notification);
             }));
 
     registrations.push_back(
         voice_call_service->register_active_call_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_active_call(); });
+                enqueue_event(DaemonEventType::active_call);
             }));
 
     registrations.push_back(
         voice_call_service->register_no_active_call_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_no_active_call(); });
+                enqueue_event(DaemonEventType::no_active_call);
             }));
 
     registrations.push_back(
         client_requests->register_set_normal_brightness_value_handler(
             [this] (double value)
             {
-                enqueue_action(
-                    [this,value] { brightness_control->set_normal_brightness_value(value); });
+                enqueue_event(DaemonEvent::set_normal_brightness_value(value));
             }));
 
     registrations.push_back(
         client_requests->register_disable_autobrightness_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { brightness_control->disable_autobrightness(); });
+                enqueue_event(DaemonEventType::disable_autobrightness);
             }));
 
     registrations.push_back(
         client_requests->register_enable_autobrightness_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { brightness_control->enable_autobrightness(); });
+                enqueue_event(DaemonEventType::enable_autobrightness);
             }));
 
     registrations.push_back(
         power_source->register_power_source_change_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_power_source_change(); });
+                enqueue_event(DaemonEventType::power_source_change);
             }));
 
     registrations.push_back(
         power_source->register_power_source_critical_handler(
             [this]
             {
-                enqueue_action(
-                    [this] { state_machine->handle_power_source_critical(); });
+                enqueue_event(DaemonEventType::power_source_critical);
+            }));
+
+    registrations.push_back(
+        brightness_control->register_brightness_transition_complete_handler(
+            [this] (BrightnessTransitionId id, double)
+            {
+                enqueue_event(DaemonEvent::brightness_transition_complete(id));
             }));
 
     return registrations;
@@ -241,28 +253,113 @@ void repowerd::Daemon::start_event_processing()
     voice_call_service->start_processing();
 }
 
-void repowerd::Daemon::enqueue_action(Action const& action)
+void repowerd::Daemon::enqueue_event(DaemonEvent event)
+{
+    event.enqueue_time = std::chrono::steady_clock::now();
+    if (event.type != DaemonEventType::flush)
+        daemon_event_trace->record(event);
+    event_queue.push(event);
+}
+
+void repowerd::Daemon::refill_pending_events()
+{
+    // Refill from the lowest to the highest priority lane, so that when we
+    // see a flush in a lower lane, we are guaranteed to also see all events
+    // enqueued before it in higher lanes
+    for (size_t i = num_daemon_event_lanes; i-- > 0;)
+    {
+        auto& pending = pending_events[i];
+
+        take_flushes_at_head(i);
+        if (!pending.empty())
+            continue;
+
+        pending.next = 0;
+        pending.end = event_queue.try_pop_all(
+            static_cast<DaemonEventLane>(i), pending.events.data(), pending.events.size());
+        take_flushes_at_head(i);
+    }
+}
+
+void repowerd::Daemon::take_flushes_at_head(size_t lane)
 {
-    std::lock_guard<std::mutex> lock{action_queue_mutex};
+    // A flush at the head of its lane has no earlier events left in that
+    // lane, so take it out and complete it once the other lanes have been
+    // drained too. This way a flush never holds back the events behind it,
+    // which it would if it waited in its lane, even for starvation relief.
+    auto& pending = pending_events[lane];
+
+    while (!pending.empty() &&
+           pending.events[pending.next].type == DaemonEventType::flush)
+    {
+        waiting_flushes.push_back(pending.events[pending.next++].flushed);
+    }
+}
 
-    action_queue.push_back(action);
-    action_queue_cv.notify_one();
+void repowerd::Daemon::complete_waiting_flushes()
+{
+    for (auto const flushed : waiting_flushes)
+        flushed->set_value();
+    waiting_flushes.clear();
 }
 
-void repowerd::Daemon::enqueue_priority_action(Action const& action)
+size_t repowerd::Daemon::next_lane_to_dispatch()
 {
-    std::lock_guard<std::mutex> lock{action_queue_mutex};
+    size_t highest{0};
+    while (highest < num_daemon_event_lanes && pending_events[highest].empty())
+        ++highest;
+
+    if (highest == num_daemon_event_lanes)
+        return highest;
 
-    action_queue.push_front(action);
-    action_queue_cv.notify_one();
+    for (size_t i = num_daemon_event_lanes - 1; i > highest; --i)
+    {
+        auto const& pending = pending_events[i];
+        if (!pending.empty() &&
+            pending.times_passed_over >= max_times_passed_over)
+        {
+            return i;
+        }
+    }
+
+    return highest;
 }
 
-repowerd::Daemon::Action repowerd::Daemon::dequeue_action()
+void repowerd::Daemon::dispatch_next_event(size_t lane)
 {
-    std::unique_lock<std::mutex> lock{action_queue_mutex};
+    auto& pending = pending_events[lane];
+    auto const& event = pending.events[pending.next++];
+
+    if (!pending.empty() &&
+        pending.events[pending.next].type == event.type &&
+        coalescing_policy_for(event.type) == DaemonEventCoalescing::consecutive)
+    {
+        daemon_statistics->record_coalesced(event.type);
+        return;
+    }
+
+    if (event.type == DaemonEventType::alarm &&
+        !timer->consume_fired_alarm(event.alarm_id))
+    {
+        return;
+    }
+
+    pending.times_passed_over = 0;
+    for (size_t i = lane + 1; i < num_daemon_event_lanes; ++i)
+    {
+        if (!pending_events[i].empty())
+            ++pending_events[i].times_passed_over;
+    }
+
+    auto const dispatch_time = std::chrono::steady_clock::now();
+    daemon_statistics->record_dispatched(event.type);
+    daemon_statistics->record_queue_latency(
+        event.type, dispatch_time - event.enqueue_time);
+
+    handler_watchdog.handler_started(event.type);
+    dispatch_daemon_event(event, *state_machine, *brightness_control);
+    handler_watchdog.handler_finished();
 
-    action_queue_cv.wait(lock, [this] { return !action_queue.empty(); });
-    auto ev = action_queue.front();
-    action_queue.pop_front();
-    return ev;
+    daemon_statistics->record_handler_latency(
+        event.type, std::chrono::steady_clock::now() - dispatch_time);
 }
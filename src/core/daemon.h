@@ -19,14 +19,14 @@
 #pragma once
 
 #include "daemon_config.h"
+#include "daemon_event_queue.h"
 #include "handler_registration.h"
+#include "handler_watchdog.h"
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
-#include <deque>
-#include <mutex>
-#include <condition_variable>
-#include <functional>
 
 namespace repowerd
 {
@@ -41,16 +41,19 @@ public:
     void flush();
 
 private:
-    using Action = std::function<void()>;
-
     std::vector<HandlerRegistration> register_event_handlers();
     void start_event_processing();
-    void enqueue_action(Action const& event);
-    void enqueue_priority_action(Action const& event);
-    Action dequeue_action();
+    void enqueue_event(DaemonEvent event);
+    void refill_pending_events();
+    void take_flushes_at_head(size_t lane);
+    void complete_waiting_flushes();
+    size_t next_lane_to_dispatch();
+    void dispatch_next_event(size_t lane);
 
     std::shared_ptr<BrightnessControl> const brightness_control;
     std::shared_ptr<ClientRequests> const client_requests;
+    std::shared_ptr<DaemonEventTrace> const daemon_event_trace;
+    std::shared_ptr<DaemonStatistics> const daemon_statistics;
     std::shared_ptr<NotificationService> const notification_service;
     std::shared_ptr<PowerButton> const power_button;
     std::shared_ptr<PowerSource> const power_source;
@@ -60,11 +63,26 @@ private:
     std::shared_ptr<UserActivity> const user_activity;
     std::shared_ptr<VoiceCallService> const voice_call_service;
 
-    bool running;
+    std::atomic<bool> running;
+
+    // Events drained from a lane of the event queue, waiting to be dispatched
+    struct PendingEvents
+    {
+        bool empty() const { return next == end; }
+
+        std::array<DaemonEvent,DaemonEventQueue::capacity> events;
+        size_t next = 0;
+        size_t end = 0;
+        // Number of events dispatched from higher lanes while this lane
+        // had pending events
+        unsigned int times_passed_over = 0;
+    };
 
-    std::mutex action_queue_mutex;
-    std::condition_variable action_queue_cv;
-    std::deque<Action> action_queue;
+    HandlerWatchdog handler_watchdog;
+    DaemonEventQueue event_queue;
+    std::array<PendingEvents,num_daemon_event_lanes> pending_events;
+    // Flushes taken out of their lane, waiting for all lanes to be drained
+    std::vector<std::promise<void>*> waiting_flushes;
 };
 
 }
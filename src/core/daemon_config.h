@@ -26,6 +26,8 @@ namespace repowerd
 
 class BrightnessControl;
 class ClientRequests;
+class DaemonEventTrace;
+class DaemonStatistics;
 class DisplayPowerControl;
 class DisplayPowerEventSink;
 class Log;
@@ -50,6 +52,8 @@ public:
 
     virtual std::shared_ptr<BrightnessControl> the_brightness_control() = 0;
     virtual std::shared_ptr<ClientRequests> the_client_requests() = 0;
+    virtual std::shared_ptr<DaemonEventTrace> the_daemon_event_trace() = 0;
+    virtual std::shared_ptr<DaemonStatistics> the_daemon_statistics() = 0;
     virtual std::shared_ptr<DisplayPowerControl> the_display_power_control() = 0;
     virtual std::shared_ptr<DisplayPowerEventSink> the_display_power_event_sink() = 0;
     virtual std::shared_ptr<Log> the_log() = 0;
@@ -67,6 +71,7 @@ public:
     virtual std::shared_ptr<UserActivity> the_user_activity() = 0;
     virtual std::shared_ptr<VoiceCallService> the_voice_call_service() = 0;
 
+    virtual std::chrono::milliseconds handler_stall_budget() = 0;
     virtual std::chrono::milliseconds notification_expiration_timeout() = 0;
     virtual std::chrono::milliseconds power_button_long_press_timeout() = 0;
     virtual std::chrono::milliseconds user_inactivity_normal_display_dim_duration() = 0;
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_event.h"
+#include "brightness_control.h"
+#include "state_machine.h"
+
+#include <array>
+
+namespace
+{
+
+using repowerd::DaemonEventCoalescing;
+using repowerd::DaemonEventLane;
+using repowerd::DaemonEventType;
+
+struct DaemonEventTypeInfo
+{
+    DaemonEventType type;
+    char const* name;
+    DaemonEventCoalescing coalescing;
+    DaemonEventLane lane;
+};
+
+// Only events whose handlers are idempotent when repeated back-to-back,
+// or whose last payload supersedes earlier ones, are coalesced.
+//
+// All state machine events except power_source_critical share the
+// interactive lane, since reordering them relative to each other can
+// change the outcome (e.g. user activity after a power button press
+// would turn the display back on). Flushes go into the lowest lane, and
+// are taken out of it as soon as they reach its head (see Daemon::run()).
+constexpr std::array<DaemonEventTypeInfo,repowerd::num_daemon_event_types> event_type_info{{
+    {DaemonEventType::alarm, "alarm",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::active_call, "active_call",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::no_active_call, "no_active_call",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::enable_inactivity_timeout, "enable_inactivity_timeout",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::disable_inactivity_timeout, "disable_inactivity_timeout",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::set_inactivity_timeout, "set_inactivity_timeout",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::no_notification, "no_notification",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::notification, "notification",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::power_button_press, "power_button_press",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::power_button_release, "power_button_release",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::power_source_change, "power_source_change",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::power_source_critical, "power_source_critical",
+        DaemonEventCoalescing::none, DaemonEventLane::critical},
+    {DaemonEventType::proximity_far, "proximity_far",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::proximity_near, "proximity_near",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::turn_on_display, "turn_on_display",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::user_activity_changing_power_state, "user_activity_changing_power_state",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::user_activity_extending_power_state, "user_activity_extending_power_state",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::interactive},
+    {DaemonEventType::set_normal_brightness_value, "set_normal_brightness_value",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::background},
+    {DaemonEventType::disable_autobrightness, "disable_autobrightness",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::background},
+    {DaemonEventType::enable_autobrightness, "enable_autobrightness",
+        DaemonEventCoalescing::consecutive, DaemonEventLane::background},
+    {DaemonEventType::brightness_transition_complete, "brightness_transition_complete",
+        DaemonEventCoalescing::none, DaemonEventLane::interactive},
+    {DaemonEventType::flush, "flush",
+        DaemonEventCoalescing::none, DaemonEventLane::background},
+}};
+
+constexpr bool is_ordered_by_type(size_t i = 0)
+{
+    return i == event_type_info.size() ||
+           (static_cast<size_t>(event_type_info[i].type) == i && is_ordered_by_type(i + 1));
+}
+
+static_assert(is_ordered_by_type(), "event_type_info must be ordered by DaemonEventType");
+
+DaemonEventTypeInfo const& info_for(DaemonEventType type)
+{
+    return event_type_info[static_cast<size_t>(type)];
+}
+
+}
+
+repowerd::DaemonEventCoalescing repowerd::coalescing_policy_for(DaemonEventType type)
+{
+    return info_for(type).coalescing;
+}
+
+repowerd::DaemonEventLane repowerd::lane_for(DaemonEventType type)
+{
+    return info_for(type).lane;
+}
+
+char const* repowerd::name_for(DaemonEventType type)
+{
+    return info_for(type).name;
+}
+
+void repowerd::dispatch_daemon_event(
+    DaemonEvent const& event,
+    StateMachine& state_machine,
+    BrightnessControl& brightness_control)
+{
+    switch (event.type)
+    {
+    case DaemonEventType::alarm:
+        state_machine.handle_alarm(event.alarm_id);
+        break;
+    case DaemonEventType::active_call:
+        state_machine.handle_active_call();
+        break;
+    case DaemonEventType::no_active_call:
+        state_machine.handle_no_active_call();
+        break;
+    case DaemonEventType::enable_inactivity_timeout:
+        state_machine.handle_enable_inactivity_timeout();
+        break;
+    case DaemonEventType::disable_inactivity_timeout:
+        state_machine.handle_disable_inactivity_timeout();
+        break;
+    case DaemonEventType::set_inactivity_timeout:
+        state_machine.handle_set_inactivity_timeout(
+            std::chrono::milliseconds{event.timeout_ms});
+        break;
+    case DaemonEventType::no_notification:
+        state_machine.handle_no_notification();
+        break;
+    case DaemonEventType::notification:
+        state_machine.handle_notification();
+        break;
+    case DaemonEventType::power_button_press:
+        state_machine.handle_power_button_press();
+        break;
+    case DaemonEventType::power_button_release:
+        state_machine.handle_power_button_release();
+        break;
+    case DaemonEventType::power_source_change:
+        state_machine.handle_power_source_change();
+        break;
+    case DaemonEventType::power_source_critical:
+        state_machine.handle_power_source_critical();
+        break;
+    case DaemonEventType::proximity_far:
+        state_machine.handle_proximity_far();
+        break;
+    case DaemonEventType::proximity_near:
+        state_machine.handle_proximity_near();
+        break;
+    case DaemonEventType::turn_on_display:
+        state_machine.handle_turn_on_display();
+        break;
+    case DaemonEventType::user_activity_changing_power_state:
+        state_machine.handle_user_activity_changing_power_state();
+        break;
+    case DaemonEventType::user_activity_extending_power_state:
+        state_machine.handle_user_activity_extending_power_state();
+        break;
+    case DaemonEventType::set_normal_brightness_value:
+        brightness_control.set_normal_brightness_value(event.brightness_value);
+        break;
+    case DaemonEventType::disable_autobrightness:
+        brightness_control.disable_autobrightness();
+        break;
+    case DaemonEventType::enable_autobrightness:
+        brightness_control.enable_autobrightness();
+        break;
+    case DaemonEventType::brightness_transition_complete:
+        state_machine.handle_brightness_transition_complete(event.brightness_transition_id);
+        break;
+    case DaemonEventType::flush:
+        // Completed by the Daemon once all lanes have been drained
+        break;
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "alarm_id.h"
+#include "brightness_control.h"
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+
+namespace repowerd
+{
+
+class StateMachine;
+
+enum class DaemonEventType
+{
+    alarm,
+    active_call,
+    no_active_call,
+    enable_inactivity_timeout,
+    disable_inactivity_timeout,
+    set_inactivity_timeout,
+    no_notification,
+    notification,
+    power_button_press,
+    power_button_release,
+    power_source_change,
+    power_source_critical,
+    proximity_far,
+    proximity_near,
+    turn_on_display,
+    user_activity_changing_power_state,
+    user_activity_extending_power_state,
+    set_normal_brightness_value,
+    disable_autobrightness,
+    enable_autobrightness,
+    brightness_transition_complete,
+    flush // must be last
+};
+
+size_t constexpr num_daemon_event_types{static_cast<size_t>(DaemonEventType::flush) + 1};
+
+enum class DaemonEventCoalescing
+{
+    // Every event is dispatched
+    none,
+    // A run of consecutive events of this type is dispatched as a single
+    // event, carrying the payload of the last event in the run
+    consecutive
+};
+
+// Lanes are listed in decreasing priority. Events in a lane are
+// dispatched in FIFO order, but may overtake events in lower lanes.
+enum class DaemonEventLane
+{
+    critical,
+    interactive,
+    background
+};
+
+size_t constexpr num_daemon_event_lanes{static_cast<size_t>(DaemonEventLane::background) + 1};
+
+DaemonEventCoalescing coalescing_policy_for(DaemonEventType type);
+DaemonEventLane lane_for(DaemonEventType type);
+char const* name_for(DaemonEventType type);
+
+struct DaemonEvent
+{
+    DaemonEvent() : DaemonEvent{DaemonEventType::flush} {}
+    DaemonEvent(DaemonEventType type) : type{type}, flushed{nullptr} {}
+
+    static DaemonEvent alarm(AlarmId id)
+    {
+        DaemonEvent event{DaemonEventType::alarm};
+        event.alarm_id = id;
+        return event;
+    }
+
+    static DaemonEvent set_inactivity_timeout(std::chrono::milliseconds timeout)
+    {
+        DaemonEvent event{DaemonEventType::set_inactivity_timeout};
+        event.timeout_ms = timeout.count();
+        return event;
+    }
+
+    static DaemonEvent set_normal_brightness_value(double value)
+    {
+        DaemonEvent event{DaemonEventType::set_normal_brightness_value};
+        event.brightness_value = value;
+        return event;
+    }
+
+    static DaemonEvent brightness_transition_complete(BrightnessTransitionId id)
+    {
+        DaemonEvent event{DaemonEventType::brightness_transition_complete};
+        event.brightness_transition_id = id;
+        return event;
+    }
+
+    static DaemonEvent flush(std::promise<void>* flushed)
+    {
+        DaemonEvent event{DaemonEventType::flush};
+        event.flushed = flushed;
+        return event;
+    }
+
+    DaemonEventType type;
+    // Set by the Daemon when the event is enqueued
+    std::chrono::steady_clock::time_point enqueue_time;
+    // Only the member corresponding to the event type is valid
+    union
+    {
+        int alarm_id;
+        std::chrono::milliseconds::rep timeout_ms;
+        double brightness_value;
+        BrightnessTransitionId brightness_transition_id;
+        std::promise<void>* flushed;
+    };
+};
+
+// Invokes the handler corresponding to the event
+void dispatch_daemon_event(
+    DaemonEvent const& event,
+    StateMachine& state_machine,
+    BrightnessControl& brightness_control);
+
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_event_queue.h"
+
+#include <system_error>
+#include <thread>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static_assert((repowerd::DaemonEventQueue::capacity &
+               (repowerd::DaemonEventQueue::capacity - 1)) == 0,
+              "DaemonEventQueue capacity must be a power of two");
+
+namespace
+{
+
+int const spins_before_sleeping{100};
+int const push_retries_before_spilling{64};
+
+int create_eventfd()
+{
+    auto const fd = eventfd(0, EFD_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error{errno, std::system_category(), "Failed to create eventfd"};
+    return fd;
+}
+
+size_t index_for(repowerd::DaemonEventLane lane)
+{
+    return static_cast<size_t>(lane);
+}
+
+}
+
+size_t constexpr repowerd::DaemonEventQueue::capacity;
+
+repowerd::DaemonEventQueue::DaemonEventQueue()
+    : wakeup_fd{create_eventfd()},
+      consumer_sleeping{false},
+      consumer_thread{std::thread::id{}}
+{
+}
+
+repowerd::DaemonEventQueue::~DaemonEventQueue()
+{
+    close(wakeup_fd);
+}
+
+void repowerd::DaemonEventQueue::push(DaemonEvent const& event)
+{
+    auto& lane = lanes[index_for(lane_for(event.type))];
+
+    // Once events have spilled, later events must follow them through the
+    // spill list to preserve FIFO order
+    auto const try_push_to_ring =
+        [&] { return lane.spill_size.load(std::memory_order_acquire) == 0 &&
+                     lane.ring.try_push(event); };
+
+    if (try_push_to_ring())
+    {
+        signal_consumer();
+        return;
+    }
+
+    // Give the consumer a brief chance to catch up, but never block: the
+    // producer may be the consumer thread itself, or a thread the consumer
+    // is waiting on
+    if (std::this_thread::get_id() != consumer_thread.load(std::memory_order_relaxed))
+    {
+        for (int i = 0; i < push_retries_before_spilling; ++i)
+        {
+            signal_consumer();
+            std::this_thread::yield();
+            if (try_push_to_ring())
+            {
+                signal_consumer();
+                return;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{lane.spill_mutex};
+        lane.spill.push_back(event);
+        lane.spill_size.store(lane.spill.size(), std::memory_order_release);
+    }
+
+    signal_consumer();
+}
+
+void repowerd::DaemonEventQueue::wake()
+{
+    uint64_t const one{1};
+    while (write(wakeup_fd, &one, sizeof one) < 0 && errno == EINTR)
+        continue;
+}
+
+bool repowerd::DaemonEventQueue::try_pop(DaemonEventLane lane, DaemonEvent& event)
+{
+    consumer_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    auto& l = lanes[index_for(lane)];
+    return l.ring.try_pop(event) || try_pop_spill(l, event);
+}
+
+size_t repowerd::DaemonEventQueue::try_pop_all(
+    DaemonEventLane lane, DaemonEvent* events, size_t max_events)
+{
+    consumer_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    auto& l = lanes[index_for(lane)];
+    size_t num_events{0};
+
+    while (num_events < max_events && l.ring.try_pop(events[num_events]))
+        ++num_events;
+
+    while (num_events < max_events && try_pop_spill(l, events[num_events]))
+        ++num_events;
+
+    return num_events;
+}
+
+void repowerd::DaemonEventQueue::wait_for_events()
+{
+    // Events often arrive in bursts, so spin briefly before paying for
+    // a sleep and the producer's wakeup
+    for (int i = 0; i < spins_before_sleeping; ++i)
+    {
+        if (has_events())
+            return;
+        std::this_thread::yield();
+    }
+
+    consumer_sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!has_events())
+    {
+        uint64_t count;
+        // A failed read (e.g. EINTR) is treated as a spurious wakeup
+        auto const unused = read(wakeup_fd, &count, sizeof count);
+        (void) unused;
+    }
+
+    consumer_sleeping.store(false, std::memory_order_relaxed);
+}
+
+bool repowerd::DaemonEventQueue::has_events() const
+{
+    for (auto const& lane : lanes)
+    {
+        if (lane.has_events())
+            return true;
+    }
+
+    return false;
+}
+
+bool repowerd::DaemonEventQueue::try_pop_spill(Lane& lane, DaemonEvent& event)
+{
+    if (lane.spill_size.load(std::memory_order_acquire) == 0)
+        return false;
+
+    // Spilled events come after everything in the ring, so they can only
+    // be consumed once the ring has been drained
+    if (lane.ring.has_events())
+        return false;
+
+    std::lock_guard<std::mutex> lock{lane.spill_mutex};
+    if (lane.spill.empty())
+        return false;
+
+    event = lane.spill.front();
+    lane.spill.pop_front();
+    lane.spill_size.store(lane.spill.size(), std::memory_order_release);
+
+    return true;
+}
+
+repowerd::DaemonEventQueue::Lane::Lane()
+    : spill_size{0}
+{
+}
+
+bool repowerd::DaemonEventQueue::Lane::has_events() const
+{
+    return ring.has_events() || spill_size.load(std::memory_order_acquire) != 0;
+}
+
+void repowerd::DaemonEventQueue::signal_consumer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_sleeping.load(std::memory_order_relaxed) &&
+        consumer_sleeping.exchange(false))
+    {
+        wake();
+    }
+}
+
+repowerd::DaemonEventQueue::Ring::Ring()
+    : enqueue_pos{0},
+      dequeue_pos{0}
+{
+    for (size_t i = 0; i < capacity; ++i)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool repowerd::DaemonEventQueue::Ring::try_push(DaemonEvent const& event)
+{
+    auto pos = enqueue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+
+    while (true)
+    {
+        cell = &cells[pos & (capacity - 1)];
+        auto const seq = cell->sequence.load(std::memory_order_acquire);
+        auto const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->event = event;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool repowerd::DaemonEventQueue::Ring::try_pop(DaemonEvent& event)
+{
+    auto& cell = cells[dequeue_pos & (capacity - 1)];
+
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+        return false;
+
+    event = cell.event;
+    cell.sequence.store(dequeue_pos + capacity, std::memory_order_release);
+    ++dequeue_pos;
+
+    return true;
+}
+
+bool repowerd::DaemonEventQueue::Ring::has_events() const
+{
+    auto const& cell = cells[dequeue_pos & (capacity - 1)];
+    return cell.sequence.load(std::memory_order_acquire) == dequeue_pos + 1;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "daemon_event.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace repowerd
+{
+
+// A set of fixed-capacity, lock-free, multi-producer/single-consumer
+// FIFOs of DaemonEvents, one per DaemonEventLane, which never allocate
+// after construction in the common case. When a lane's ring is full,
+// producers yield briefly and then, rather than block, overflow into a
+// mutex-protected spill list, which the consumer drains after the ring,
+// preserving FIFO order. Pushes from the consumer thread spill immediately. The
+// consumer sleeps on an eventfd only when all lanes are empty, and
+// producers write to the eventfd only when the consumer is sleeping.
+class DaemonEventQueue
+{
+public:
+    // Per lane
+    static size_t constexpr capacity{1024};
+
+    DaemonEventQueue();
+    ~DaemonEventQueue();
+
+    // May be called from any thread
+    void push(DaemonEvent const& event);
+    void wake();
+
+    // May be called only from the consumer thread
+    bool try_pop(DaemonEventLane lane, DaemonEvent& event);
+    size_t try_pop_all(DaemonEventLane lane, DaemonEvent* events, size_t max_events);
+    void wait_for_events();
+
+private:
+    DaemonEventQueue(DaemonEventQueue const&) = delete;
+    DaemonEventQueue& operator=(DaemonEventQueue const&) = delete;
+
+    class Ring
+    {
+    public:
+        Ring();
+
+        bool try_push(DaemonEvent const& event);
+        bool try_pop(DaemonEvent& event);
+        bool has_events() const;
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            DaemonEvent event;
+        };
+
+        std::atomic<size_t> enqueue_pos;
+        // The cells separate the producer and consumer positions, to avoid
+        // false sharing between them
+        std::array<Cell,capacity> cells;
+        size_t dequeue_pos;
+    };
+
+    struct Lane
+    {
+        Lane();
+
+        bool has_events() const;
+
+        Ring ring;
+        std::mutex spill_mutex;
+        std::deque<DaemonEvent> spill;
+        // Mirrors spill.size(), so that the fast paths don't need the mutex
+        std::atomic<size_t> spill_size;
+    };
+
+    bool has_events() const;
+    void signal_consumer();
+    static bool try_pop_spill(Lane& lane, DaemonEvent& event);
+
+    int const wakeup_fd;
+    std::atomic<bool> consumer_sleeping;
+    std::atomic<std::thread::id> consumer_thread;
+    std::array<Lane,num_daemon_event_lanes> lanes;
+};
+
+}
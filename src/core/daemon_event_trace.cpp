@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_event_trace.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+char const trace_magic[8] = {'R','P','W','D','T','R','C','\0'};
+uint32_t const trace_version{2};
+
+template <typename T>
+uint64_t to_payload(T value)
+{
+    static_assert(sizeof(T) <= sizeof(uint64_t), "payload too large");
+    uint64_t payload{0};
+    std::memcpy(&payload, &value, sizeof(value));
+    return payload;
+}
+
+template <typename T>
+T from_payload(uint64_t payload)
+{
+    static_assert(sizeof(T) <= sizeof(uint64_t), "payload too large");
+    T value;
+    std::memcpy(&value, &payload, sizeof(value));
+    return value;
+}
+
+}
+
+repowerd::DaemonEventTraceHeader repowerd::daemon_event_trace_header()
+{
+    DaemonEventTraceHeader header;
+    std::memcpy(header.magic, trace_magic, sizeof(header.magic));
+    header.version = trace_version;
+    header.record_size = sizeof(DaemonEventTraceRecord);
+    return header;
+}
+
+bool repowerd::is_valid_daemon_event_trace_header(DaemonEventTraceHeader const& header)
+{
+    return std::memcmp(header.magic, trace_magic, sizeof(header.magic)) == 0 &&
+           header.version == trace_version &&
+           header.record_size == sizeof(DaemonEventTraceRecord);
+}
+
+repowerd::DaemonEventTraceRecord repowerd::daemon_event_trace_record_for(
+    DaemonEvent const& event)
+{
+    DaemonEventTraceRecord record;
+    record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        event.enqueue_time.time_since_epoch()).count();
+    record.type = static_cast<uint32_t>(event.type);
+    record.reserved = 0;
+    record.payload = 0;
+
+    switch (event.type)
+    {
+    case DaemonEventType::alarm:
+        record.payload = to_payload<int64_t>(event.alarm_id);
+        break;
+    case DaemonEventType::set_inactivity_timeout:
+        record.payload = to_payload<int64_t>(event.timeout_ms);
+        break;
+    case DaemonEventType::set_normal_brightness_value:
+        record.payload = to_payload(event.brightness_value);
+        break;
+    case DaemonEventType::brightness_transition_complete:
+        record.payload = to_payload(event.brightness_transition_id);
+        break;
+    default:
+        break;
+    }
+
+    return record;
+}
+
+repowerd::DaemonEvent repowerd::daemon_event_for(DaemonEventTraceRecord const& record)
+{
+    // Flush events refer to a waiter in the recording process, so they are
+    // never traced
+    if (record.type >= static_cast<uint32_t>(DaemonEventType::flush))
+        throw std::invalid_argument{"Invalid event type " + std::to_string(record.type)};
+
+    auto const type = static_cast<DaemonEventType>(record.type);
+    DaemonEvent event{type};
+
+    switch (type)
+    {
+    case DaemonEventType::alarm:
+        event = DaemonEvent::alarm(static_cast<int>(from_payload<int64_t>(record.payload)));
+        break;
+    case DaemonEventType::set_inactivity_timeout:
+        event = DaemonEvent::set_inactivity_timeout(
+            std::chrono::milliseconds{from_payload<int64_t>(record.payload)});
+        break;
+    case DaemonEventType::set_normal_brightness_value:
+        event = DaemonEvent::set_normal_brightness_value(
+            from_payload<double>(record.payload));
+        break;
+    case DaemonEventType::brightness_transition_complete:
+        event = DaemonEvent::brightness_transition_complete(
+            from_payload<BrightnessTransitionId>(record.payload));
+        break;
+    default:
+        break;
+    }
+
+    event.enqueue_time = std::chrono::steady_clock::time_point{
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds{record.timestamp_ns})};
+
+    return event;
+}
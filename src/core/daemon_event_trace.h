@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "daemon_event.h"
+
+#include <cstdint>
+
+namespace repowerd
+{
+
+// Receives every event entering the Daemon, from the threads enqueuing them
+class DaemonEventTrace
+{
+public:
+    virtual ~DaemonEventTrace() = default;
+
+    virtual void record(DaemonEvent const& event) = 0;
+
+protected:
+    DaemonEventTrace() = default;
+    DaemonEventTrace(DaemonEventTrace const&) = delete;
+    DaemonEventTrace& operator=(DaemonEventTrace const&) = delete;
+};
+
+// A binary event trace consists of a DaemonEventTraceHeader followed by
+// DaemonEventTraceRecords, all in host byte order
+struct DaemonEventTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+struct DaemonEventTraceRecord
+{
+    // CLOCK_MONOTONIC time at which the event was enqueued
+    int64_t timestamp_ns;
+    uint32_t type;
+    uint32_t reserved;
+    // Bit pattern of the event payload, if any
+    uint64_t payload;
+};
+
+DaemonEventTraceHeader daemon_event_trace_header();
+bool is_valid_daemon_event_trace_header(DaemonEventTraceHeader const& header);
+
+DaemonEventTraceRecord daemon_event_trace_record_for(DaemonEvent const& event);
+// Throws std::invalid_argument if the record doesn't describe a traceable event
+DaemonEvent daemon_event_for(DaemonEventTraceRecord const& record);
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_statistics.h"
+
+namespace
+{
+
+size_t index_for(repowerd::DaemonEventType type)
+{
+    return static_cast<size_t>(type);
+}
+
+}
+
+repowerd::DaemonStatistics::DaemonStatistics()
+{
+    for (auto& count : dispatched_counts)
+        count.store(0, std::memory_order_relaxed);
+    for (auto& count : coalesced_counts)
+        count.store(0, std::memory_order_relaxed);
+    for (auto& count : stall_counts)
+        count.store(0, std::memory_order_relaxed);
+}
+
+void repowerd::DaemonStatistics::record_dispatched(DaemonEventType type)
+{
+    dispatched_counts[index_for(type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void repowerd::DaemonStatistics::record_coalesced(DaemonEventType type)
+{
+    coalesced_counts[index_for(type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void repowerd::DaemonStatistics::record_queue_latency(
+    DaemonEventType type, std::chrono::nanoseconds latency)
+{
+    queue_latencies[index_for(type)].record(latency);
+}
+
+void repowerd::DaemonStatistics::record_handler_latency(
+    DaemonEventType type, std::chrono::nanoseconds latency)
+{
+    handler_latencies[index_for(type)].record(latency);
+}
+
+void repowerd::DaemonStatistics::record_stall(DaemonEventType type)
+{
+    stall_counts[index_for(type)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t repowerd::DaemonStatistics::dispatched(DaemonEventType type) const
+{
+    return dispatched_counts[index_for(type)].load(std::memory_order_relaxed);
+}
+
+uint64_t repowerd::DaemonStatistics::coalesced(DaemonEventType type) const
+{
+    return coalesced_counts[index_for(type)].load(std::memory_order_relaxed);
+}
+
+uint64_t repowerd::DaemonStatistics::total_coalesced() const
+{
+    uint64_t total{0};
+    for (auto const& count : coalesced_counts)
+        total += count.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t repowerd::DaemonStatistics::stalls(DaemonEventType type) const
+{
+    return stall_counts[index_for(type)].load(std::memory_order_relaxed);
+}
+
+uint64_t repowerd::DaemonStatistics::total_stalls() const
+{
+    uint64_t total{0};
+    for (auto const& count : stall_counts)
+        total += count.load(std::memory_order_relaxed);
+    return total;
+}
+
+repowerd::LatencyHistogram const& repowerd::DaemonStatistics::queue_latency(
+    DaemonEventType type) const
+{
+    return queue_latencies[index_for(type)];
+}
+
+repowerd::LatencyHistogram const& repowerd::DaemonStatistics::handler_latency(
+    DaemonEventType type) const
+{
+    return handler_latencies[index_for(type)];
+}
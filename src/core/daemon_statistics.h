@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "daemon_event.h"
+#include "latency_histogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace repowerd
+{
+
+// Counters updated by the Daemon thread, and safe to read from any thread
+class DaemonStatistics
+{
+public:
+    DaemonStatistics();
+
+    void record_dispatched(DaemonEventType type);
+    void record_coalesced(DaemonEventType type);
+    // Time from enqueuing an event until it is dispatched
+    void record_queue_latency(DaemonEventType type, std::chrono::nanoseconds latency);
+    // Time spent in the handler of a dispatched event
+    void record_handler_latency(DaemonEventType type, std::chrono::nanoseconds latency);
+    // A handler that ran for longer than the stall budget
+    void record_stall(DaemonEventType type);
+
+    uint64_t dispatched(DaemonEventType type) const;
+    uint64_t coalesced(DaemonEventType type) const;
+    uint64_t total_coalesced() const;
+    uint64_t stalls(DaemonEventType type) const;
+    uint64_t total_stalls() const;
+    LatencyHistogram const& queue_latency(DaemonEventType type) const;
+    LatencyHistogram const& handler_latency(DaemonEventType type) const;
+
+private:
+    DaemonStatistics(DaemonStatistics const&) = delete;
+    DaemonStatistics& operator=(DaemonStatistics const&) = delete;
+
+    std::array<std::atomic<uint64_t>,num_daemon_event_types> dispatched_counts;
+    std::array<std::atomic<uint64_t>,num_daemon_event_types> coalesced_counts;
+    std::array<std::atomic<uint64_t>,num_daemon_event_types> stall_counts;
+    std::array<LatencyHistogram,num_daemon_event_types> queue_latencies;
+    std::array<LatencyHistogram,num_daemon_event_types> handler_latencies;
+};
+
+}
@@ -35,6 +35,13 @@ namespace
 {
 char const* const log_tag = "DefaultStateMachine";
 char const* const suspend_id = "DefaultStateMachine";
+// How late the inactivity, proximity and notification alarms may fire, so
+// that the timer can serve nearby alarms with a single wakeup
+auto const alarm_tolerance = std::chrono::milliseconds{500};
+// How long to wait for the off brightness transition to complete before
+// turning off the display power regardless. Off transitions take 100ms, so
+// this leaves ample margin for a busy brightness event loop.
+auto const display_power_off_timeout = std::chrono::milliseconds{1000};
 }
 
 repowerd::DefaultStateMachine::DefaultStateMachine(DaemonConfig& config)
@@ -51,6 +58,10 @@ repowerd::DefaultStateMachine::DefaultStateMachine(DaemonConfig& config)
       timer{config.the_timer()},
       display_power_mode{DisplayPowerMode::off},
       display_power_mode_at_power_button_press{DisplayPowerMode::unknown},
+      display_power_off_pending{false},
+      display_power_off_pending_reason{DisplayPowerChangeReason::unknown},
+      display_power_off_transition_id{no_brightness_transition_id},
+      display_power_off_alarm_id{AlarmId::invalid},
       power_button_long_press_alarm_id{AlarmId::invalid},
       power_button_long_press_detected{false},
       power_button_long_press_timeout{config.power_button_long_press_timeout()},
@@ -112,6 +123,13 @@ void repowerd::DefaultStateMachine::handle_alarm(AlarmId id)
         allow_inactivity_timeout(InactivityTimeoutAllowance::notification);
         disable_proximity(ProximityEnablement::until_far_event_or_notification_expiration);
     }
+    else if (id == display_power_off_alarm_id)
+    {
+        log->log(log_tag, "handle_alarm(display_power_off)");
+        display_power_off_alarm_id = AlarmId::invalid;
+        if (display_power_off_pending)
+            complete_display_power_off();
+    }
 }
 
 void repowerd::DefaultStateMachine::handle_active_call()
@@ -352,6 +370,21 @@ void repowerd::DefaultStateMachine::handle_user_activity_extending_power_state()
     }
 }
 
+void repowerd::DefaultStateMachine::handle_brightness_transition_complete(
+    BrightnessTransitionId id)
+{
+    log->log(log_tag, "handle_brightness_transition_complete(%u)", id);
+
+    // Completions of earlier off transitions, and of transitions that
+    // retargeted our off transition, don't carry its id
+    if (display_power_off_pending &&
+        id != no_brightness_transition_id &&
+        id == display_power_off_transition_id)
+    {
+        complete_display_power_off();
+    }
+}
+
 void repowerd::DefaultStateMachine::cancel_user_inactivity_alarm()
 {
     if (user_inactivity_display_dim_alarm_id != AlarmId::invalid)
@@ -397,11 +430,13 @@ void repowerd::DefaultStateMachine::schedule_normal_user_inactivity_alarm()
         user_inactivity_display_dim_alarm_id =
             timer->schedule_alarm_in(
                 user_inactivity_normal_display_off_timeout -
-                user_inactivity_normal_display_dim_duration);
+                user_inactivity_normal_display_dim_duration,
+                alarm_tolerance);
     }
 
     user_inactivity_display_off_alarm_id =
-        timer->schedule_alarm_in(user_inactivity_normal_display_off_timeout);
+        timer->schedule_alarm_in(
+            user_inactivity_normal_display_off_timeout, alarm_tolerance);
 }
 
 void repowerd::DefaultStateMachine::schedule_post_notification_user_inactivity_alarm()
@@ -411,7 +446,8 @@ void repowerd::DefaultStateMachine::schedule_post_notification_user_inactivity_a
     {
         cancel_user_inactivity_alarm();
         user_inactivity_display_off_alarm_id =
-            timer->schedule_alarm_in(user_inactivity_post_notification_display_off_timeout);
+            timer->schedule_alarm_in(
+                user_inactivity_post_notification_display_off_timeout, alarm_tolerance);
         user_inactivity_display_off_time_point = tp;
         scheduled_timeout_type = ScheduledTimeoutType::post_notification;
     }
@@ -424,7 +460,8 @@ void repowerd::DefaultStateMachine::schedule_reduced_user_inactivity_alarm()
     {
         cancel_user_inactivity_alarm();
         user_inactivity_display_off_alarm_id =
-            timer->schedule_alarm_in(user_inactivity_reduced_display_off_timeout);
+            timer->schedule_alarm_in(
+                user_inactivity_reduced_display_off_timeout, alarm_tolerance);
         user_inactivity_display_off_time_point = tp;
         scheduled_timeout_type = ScheduledTimeoutType::reduced;
     }
@@ -436,7 +473,8 @@ void repowerd::DefaultStateMachine::schedule_proximity_disable_alarm()
         timer->cancel_alarm(proximity_disable_alarm_id);
 
     proximity_disable_alarm_id =
-        timer->schedule_alarm_in(user_inactivity_reduced_display_off_timeout);
+        timer->schedule_alarm_in(
+            user_inactivity_reduced_display_off_timeout, alarm_tolerance);
 }
 
 void repowerd::DefaultStateMachine::schedule_notification_expiration_alarm()
@@ -449,7 +487,7 @@ void repowerd::DefaultStateMachine::schedule_notification_expiration_alarm()
             notification_expiration_timeout);
 
     notification_expiration_alarm_id =
-        timer->schedule_alarm_in(timeout);
+        timer->schedule_alarm_in(timeout, alarm_tolerance);
 }
 
 void repowerd::DefaultStateMachine::schedule_immediate_user_inactivity_alarm()
@@ -468,8 +506,17 @@ void repowerd::DefaultStateMachine::schedule_immediate_user_inactivity_alarm()
 void repowerd::DefaultStateMachine::turn_off_display(
     DisplayPowerChangeReason reason)
 {
-    brightness_control->set_off_brightness();
-    display_power_control->turn_off();
+    // The rest of the work overlaps with the brightness transition. The
+    // display power is turned off, and suspend is allowed, only when the
+    // transition completes, so that the display doesn't go dark mid-fade
+    // and we don't suspend with the backlight on. If the transition doesn't
+    // complete in time, e.g. because it was retargeted, we turn off the
+    // display power anyway.
+    cancel_display_power_off();
+    display_power_off_pending = true;
+    display_power_off_pending_reason = reason;
+    display_power_off_alarm_id = timer->schedule_alarm_in(display_power_off_timeout);
+    display_power_off_transition_id = brightness_control->set_off_brightness();
     if (reason != DisplayPowerChangeReason::proximity)
         modem_power_control->set_low_power_mode();
     display_power_mode = DisplayPowerMode::off;
@@ -477,15 +524,36 @@ void repowerd::DefaultStateMachine::turn_off_display(
     cancel_user_inactivity_alarm();
     display_power_event_sink->notify_display_power_off(reason);
     performance_booster->disable_interactive_mode();
+}
+
+void repowerd::DefaultStateMachine::complete_display_power_off()
+{
+    auto const reason = display_power_off_pending_reason;
+
+    cancel_display_power_off();
+    display_power_control->turn_off();
     if (reason != DisplayPowerChangeReason::proximity)
         suspend_control->allow_suspend(suspend_id);
 }
 
+void repowerd::DefaultStateMachine::cancel_display_power_off()
+{
+    if (display_power_off_alarm_id != AlarmId::invalid)
+    {
+        timer->cancel_alarm(display_power_off_alarm_id);
+        display_power_off_alarm_id = AlarmId::invalid;
+    }
+
+    display_power_off_pending = false;
+    display_power_off_transition_id = no_brightness_transition_id;
+}
+
 void repowerd::DefaultStateMachine::turn_on_display_without_timeout(
     DisplayPowerChangeReason reason)
 {
     suspend_control->disallow_suspend(suspend_id);
     performance_booster->enable_interactive_mode();
+    cancel_display_power_off();
     display_power_control->turn_on();
     display_power_mode = DisplayPowerMode::on;
     display_power_mode_reason = reason;
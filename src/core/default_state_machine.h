@@ -58,6 +58,8 @@ public:
     void handle_user_activity_changing_power_state() override;
     void handle_user_activity_extending_power_state() override;
 
+    void handle_brightness_transition_complete(BrightnessTransitionId id) override;
+
 private:
     enum class DisplayPowerMode {unknown, on, off};
     struct InactivityTimeoutAllowanceEnum {
@@ -83,6 +85,8 @@ private:
     void schedule_notification_expiration_alarm();
     void schedule_immediate_user_inactivity_alarm();
     void turn_off_display(DisplayPowerChangeReason reason);
+    void complete_display_power_off();
+    void cancel_display_power_off();
     void turn_on_display_without_timeout(DisplayPowerChangeReason reason);
     void turn_on_display_with_normal_timeout(DisplayPowerChangeReason reason);
     void turn_on_display_with_reduced_timeout(DisplayPowerChangeReason reason);
@@ -114,6 +118,10 @@ private:
     DisplayPowerMode display_power_mode;
     DisplayPowerMode display_power_mode_at_power_button_press;
     DisplayPowerChangeReason display_power_mode_reason;
+    bool display_power_off_pending;
+    DisplayPowerChangeReason display_power_off_pending_reason;
+    BrightnessTransitionId display_power_off_transition_id;
+    AlarmId display_power_off_alarm_id;
     AlarmId power_button_long_press_alarm_id;
     bool power_button_long_press_detected;
     std::chrono::milliseconds power_button_long_press_timeout;
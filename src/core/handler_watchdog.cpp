@@ -0,0 +1,240 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "handler_watchdog.h"
+#include "daemon_statistics.h"
+#include "infinite_timeout.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <csignal>
+#include <execinfo.h>
+
+namespace
+{
+
+char const* const log_tag = "HandlerWatchdog";
+
+int const max_backtrace_frames{64};
+void* backtrace_frames[max_backtrace_frames];
+std::atomic<int> num_backtrace_frames{-1};
+std::mutex backtrace_mutex;
+
+// SIGRTMIN already excludes the real-time signals reserved by glibc
+int backtrace_signal()
+{
+    return SIGRTMIN + 1;
+}
+
+void capture_backtrace(int)
+{
+    num_backtrace_frames.store(
+        backtrace(backtrace_frames, max_backtrace_frames),
+        std::memory_order_release);
+}
+
+void install_backtrace_signal_handler()
+{
+    static std::once_flag installed;
+
+    std::call_once(installed,
+        []
+        {
+            // backtrace() may allocate when first called, which is not
+            // safe to do in a signal handler
+            void* frame;
+            backtrace(&frame, 1);
+
+            struct sigaction action;
+            std::memset(&action, 0, sizeof(action));
+            action.sa_handler = capture_backtrace;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+
+            sigaction(backtrace_signal(), &action, nullptr);
+        });
+}
+
+uint64_t pack_running_handler(
+    std::chrono::steady_clock::time_point start, repowerd::DaemonEventType type)
+{
+    auto const start_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        start.time_since_epoch()).count();
+    return (static_cast<uint64_t>(start_us) << 8) | static_cast<uint64_t>(type);
+}
+
+std::chrono::steady_clock::time_point start_of(uint64_t running_handler)
+{
+    return std::chrono::steady_clock::time_point{
+        std::chrono::microseconds{running_handler >> 8}};
+}
+
+repowerd::DaemonEventType type_of(uint64_t running_handler)
+{
+    return static_cast<repowerd::DaemonEventType>(running_handler & 0xff);
+}
+
+long long to_ms(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+}
+
+repowerd::HandlerWatchdog::HandlerWatchdog(
+    std::shared_ptr<DaemonStatistics> const& daemon_statistics,
+    std::shared_ptr<Log> const& log,
+    std::chrono::milliseconds stall_budget)
+    : daemon_statistics{daemon_statistics},
+      log{log},
+      stall_budget{stall_budget},
+      running_handler{0},
+      watching{false},
+      monitored_thread{},
+      stalled_handler{0}
+{
+    static_assert(num_daemon_event_types <= 0x100, "DaemonEventType must fit in 8 bits");
+}
+
+repowerd::HandlerWatchdog::~HandlerWatchdog()
+{
+    stop();
+}
+
+void repowerd::HandlerWatchdog::start()
+{
+    if (stall_budget == infinite_timeout || stall_budget <= std::chrono::milliseconds{0})
+        return;
+
+    install_backtrace_signal_handler();
+
+    std::lock_guard<std::mutex> lock{watch_mutex};
+
+    if (watching) return;
+
+    monitored_thread = pthread_self();
+    watching = true;
+    watch_thread = std::thread{[this] { watch(); }};
+}
+
+void repowerd::HandlerWatchdog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{watch_mutex};
+        watching = false;
+    }
+
+    watch_cv.notify_all();
+
+    if (watch_thread.joinable())
+        watch_thread.join();
+}
+
+void repowerd::HandlerWatchdog::handler_started(DaemonEventType type)
+{
+    running_handler.store(
+        pack_running_handler(std::chrono::steady_clock::now(), type),
+        std::memory_order_relaxed);
+}
+
+void repowerd::HandlerWatchdog::handler_finished()
+{
+    running_handler.store(0, std::memory_order_relaxed);
+}
+
+void repowerd::HandlerWatchdog::watch()
+{
+    auto const check_period = std::max(std::chrono::milliseconds{1}, stall_budget / 4);
+
+    std::unique_lock<std::mutex> lock{watch_mutex};
+
+    while (!watch_cv.wait_for(lock, check_period, [this] { return !watching; }))
+    {
+        lock.unlock();
+        check_for_stall(std::chrono::steady_clock::now());
+        lock.lock();
+    }
+}
+
+void repowerd::HandlerWatchdog::check_for_stall(std::chrono::steady_clock::time_point now)
+{
+    auto const handler = running_handler.load(std::memory_order_relaxed);
+
+    if (stalled_handler != 0 && handler != stalled_handler)
+    {
+        log->log(log_tag, "Handler for %s recovered after about %lld ms",
+                 name_for(type_of(stalled_handler)),
+                 to_ms(now - start_of(stalled_handler)));
+        stalled_handler = 0;
+    }
+
+    if (handler == 0 || handler == stalled_handler)
+        return;
+
+    auto const running_time = now - start_of(handler);
+    if (running_time < stall_budget)
+        return;
+
+    stalled_handler = handler;
+    daemon_statistics->record_stall(type_of(handler));
+
+    log->log(log_tag, "Handler for %s stalled, running for %lld ms (budget %lld ms)",
+             name_for(type_of(handler)), to_ms(running_time),
+             static_cast<long long>(stall_budget.count()));
+
+    log_backtrace_of_monitored_thread();
+}
+
+void repowerd::HandlerWatchdog::log_backtrace_of_monitored_thread()
+{
+    std::lock_guard<std::mutex> lock{backtrace_mutex};
+
+    num_backtrace_frames.store(-1, std::memory_order_relaxed);
+
+    if (pthread_kill(monitored_thread, backtrace_signal()) != 0)
+    {
+        log->log(log_tag, "Failed to capture backtrace of stalled handler");
+        return;
+    }
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds{100};
+    int num_frames{-1};
+
+    while ((num_frames = num_backtrace_frames.load(std::memory_order_acquire)) < 0 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (num_frames < 0)
+    {
+        log->log(log_tag, "Timed out capturing backtrace of stalled handler");
+        return;
+    }
+
+    auto const symbols = backtrace_symbols(backtrace_frames, num_frames);
+
+    log->log(log_tag, "Backtrace of stalled handler:");
+    for (int i = 0; i < num_frames; ++i)
+        log->log(log_tag, "  #%d %s", i, symbols ? symbols[i] : "??");
+
+    free(symbols);
+}
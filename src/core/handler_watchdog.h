@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "daemon_event.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <pthread.h>
+
+namespace repowerd
+{
+
+class DaemonStatistics;
+class Log;
+
+// Watches the handlers dispatched by the monitored thread from a separate
+// thread. A handler running for longer than the stall budget is counted as
+// a stall in DaemonStatistics, and logged along with a backtrace of the
+// monitored thread.
+class HandlerWatchdog
+{
+public:
+    HandlerWatchdog(
+        std::shared_ptr<DaemonStatistics> const& daemon_statistics,
+        std::shared_ptr<Log> const& log,
+        std::chrono::milliseconds stall_budget);
+    ~HandlerWatchdog();
+
+    // Called from the thread to monitor
+    void start();
+    void stop();
+    void handler_started(DaemonEventType type);
+    void handler_finished();
+
+private:
+    HandlerWatchdog(HandlerWatchdog const&) = delete;
+    HandlerWatchdog& operator=(HandlerWatchdog const&) = delete;
+
+    void watch();
+    void check_for_stall(std::chrono::steady_clock::time_point now);
+    void log_backtrace_of_monitored_thread();
+
+    std::shared_ptr<DaemonStatistics> const daemon_statistics;
+    std::shared_ptr<Log> const log;
+    std::chrono::milliseconds const stall_budget;
+
+    // The start time of the running handler in microseconds and its event
+    // type, packed so that they are always read consistently, or 0 if idle
+    std::atomic<uint64_t> running_handler;
+
+    std::mutex watch_mutex;
+    std::condition_variable watch_cv;
+    bool watching;
+    pthread_t monitored_thread;
+    std::thread watch_thread;
+
+    // Only accessed by the watch thread
+    uint64_t stalled_handler;
+};
+
+}
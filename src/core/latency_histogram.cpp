@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+size_t constexpr sub_bucket_bits{3};
+static_assert(repowerd::LatencyHistogram::sub_buckets == (1u << sub_bucket_bits),
+              "sub_buckets must match sub_bucket_bits");
+
+unsigned int most_significant_bit(uint64_t value)
+{
+    return 63 - __builtin_clzll(value);
+}
+
+}
+
+repowerd::LatencyHistogram::LatencyHistogram()
+    : total_count{0},
+      max_us{0}
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+void repowerd::LatencyHistogram::record(std::chrono::nanoseconds duration)
+{
+    auto const value_us = static_cast<uint64_t>(
+        std::max<std::chrono::microseconds::rep>(
+            std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0));
+
+    buckets[bucket_for(value_us)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+
+    // There is only a single writer, so a plain load/store is enough
+    if (value_us > max_us.load(std::memory_order_relaxed))
+        max_us.store(value_us, std::memory_order_relaxed);
+}
+
+uint64_t repowerd::LatencyHistogram::count() const
+{
+    return total_count.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds repowerd::LatencyHistogram::max() const
+{
+    return std::chrono::microseconds{max_us.load(std::memory_order_relaxed)};
+}
+
+std::chrono::microseconds repowerd::LatencyHistogram::percentile(double percentage) const
+{
+    // Work on a snapshot, so that concurrent updates can't make the
+    // bucket counts inconsistent with the total
+    std::array<uint64_t,num_buckets> snapshot;
+    uint64_t total{0};
+    for (size_t i = 0; i < num_buckets; ++i)
+    {
+        snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+
+    if (total == 0)
+        return std::chrono::microseconds{0};
+
+    auto const clamped_percentage = std::min(std::max(percentage, 0.0), 100.0);
+    auto const target = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(total * clamped_percentage / 100.0)));
+
+    auto const max_value = max_us.load(std::memory_order_relaxed);
+    uint64_t accumulated{0};
+
+    for (size_t i = 0; i < num_buckets - 1; ++i)
+    {
+        accumulated += snapshot[i];
+        if (accumulated >= target)
+        {
+            auto const upper_bound = bucket_lower_bound(i + 1) - 1;
+            return std::chrono::microseconds{std::min(upper_bound, max_value)};
+        }
+    }
+
+    return std::chrono::microseconds{max_value};
+}
+
+size_t repowerd::LatencyHistogram::bucket_for(uint64_t value_us)
+{
+    if (value_us < 2 * sub_buckets)
+        return value_us;
+
+    auto const shift = most_significant_bit(value_us) - sub_bucket_bits;
+    auto const bucket =
+        (shift + 1) * sub_buckets + ((value_us >> shift) - sub_buckets);
+
+    return std::min<size_t>(bucket, num_buckets - 1);
+}
+
+uint64_t repowerd::LatencyHistogram::bucket_lower_bound(size_t bucket)
+{
+    if (bucket < 2 * sub_buckets)
+        return bucket;
+
+    auto const shift = bucket / sub_buckets - 1;
+    return static_cast<uint64_t>(bucket % sub_buckets + sub_buckets) << shift;
+}
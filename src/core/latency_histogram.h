@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace repowerd
+{
+
+// Log-linear histogram of durations with microsecond resolution. Each power
+// of two range is split into sub_buckets linear buckets, which keeps the
+// relative error of reported values below 1/sub_buckets. Values are recorded
+// by a single thread without locking, and can be read from any thread.
+class LatencyHistogram
+{
+public:
+    static size_t constexpr sub_buckets{8};
+    static size_t constexpr num_buckets{192};
+
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds duration);
+
+    uint64_t count() const;
+    std::chrono::microseconds max() const;
+    // Returns an upper bound for the duration below which the
+    // specified percentage (0-100) of recorded durations falls
+    std::chrono::microseconds percentile(double percentage) const;
+
+    static size_t bucket_for(uint64_t value_us);
+    static uint64_t bucket_lower_bound(size_t bucket);
+
+private:
+    LatencyHistogram(LatencyHistogram const&) = delete;
+    LatencyHistogram& operator=(LatencyHistogram const&) = delete;
+
+    std::array<std::atomic<uint64_t>,num_buckets> buckets;
+    std::atomic<uint64_t> total_count;
+    std::atomic<uint64_t> max_us;
+};
+
+}
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "alarm_id.h"
+#include "brightness_control.h"
 
 #include <chrono>
 
@@ -56,6 +57,7 @@ public:
     virtual void handle_user_activity_changing_power_state() = 0;
     virtual void handle_user_activity_extending_power_state() = 0;
 
+    virtual void handle_brightness_transition_complete(BrightnessTransitionId id) = 0;
 
 protected:
     StateMachine() = default;
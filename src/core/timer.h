@@ -36,7 +36,17 @@ public:
 
     virtual HandlerRegistration register_alarm_handler(AlarmHandler const& handler) = 0;
     virtual AlarmId schedule_alarm_in(std::chrono::milliseconds t) = 0;
+    // The alarm may fire at any point in [t, t + tolerance], which allows the
+    // timer to serve alarms with overlapping windows with a single wakeup
+    virtual AlarmId schedule_alarm_in(
+        std::chrono::milliseconds t, std::chrono::milliseconds tolerance) = 0;
+    // Cancellation is lazy and never waits for the timer: it only marks the
+    // alarm as cancelled. An alarm that has already fired may still reach
+    // the alarm handler after being cancelled, so each alarm delivered to
+    // the handler must be passed to consume_fired_alarm() before acting on
+    // it, which returns false for such stale firings.
     virtual void cancel_alarm(AlarmId id) = 0;
+    virtual bool consume_fired_alarm(AlarmId id) = 0;
     virtual std::chrono::steady_clock::time_point now() = 0;
 
 protected:
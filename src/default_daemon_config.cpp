@@ -17,25 +17,37 @@
  */
 
 #include "default_daemon_config.h"
+#include "core/daemon_event_trace.h"
+#include "core/daemon_statistics.h"
 #include "core/default_state_machine.h"
+#include "core/infinite_timeout.h"
 
 #include "adapters/android_autobrightness_algorithm.h"
 #include "adapters/android_backlight.h"
 #include "adapters/android_device_config.h"
 #include "adapters/android_device_quirks.h"
 #include "adapters/backlight_brightness_control.h"
+#include "adapters/backlight_group.h"
+#include "adapters/brightness_curve.h"
+#include "adapters/brightness_params.h"
 #include "adapters/console_log.h"
+#include "adapters/dbus_connection_handle.h"
 #include "adapters/dev_alarm_wakeup_service.h"
+#include "adapters/event_loop.h"
 #include "adapters/event_loop_timer.h"
+#include "adapters/file_daemon_event_trace.h"
 #include "adapters/libsuspend_suspend_control.h"
+#include "adapters/mmap_request_journal.h"
 #include "adapters/null_log.h"
+#include "adapters/null_request_journal.h"
 #include "adapters/ofono_voice_call_service.h"
-#include "adapters/real_chrono.h"
 #include "adapters/real_filesystem.h"
 #include "adapters/real_temporary_suspend_inhibition.h"
+#include "adapters/real_timerfd_clock.h"
 #include "adapters/sysfs_backlight.h"
 #include "adapters/syslog_log.h"
 #include "adapters/system_shutdown_control.h"
+#include "adapters/timerfd_wakeup_service.h"
 #include "adapters/ubuntu_light_sensor.h"
 #include "adapters/ubuntu_performance_booster.h"
 #include "adapters/ubuntu_proximity_sensor.h"
@@ -56,14 +68,59 @@ struct NullHandlerRegistration : repowerd::HandlerRegistration
     NullHandlerRegistration() : HandlerRegistration{[]{}} {}
 };
 
+// Completes requests immediately, since the state machine waits for the
+// off transition to complete before turning off the display power. The
+// completion is reported from within the request, which the daemon turns
+// into an event that the state machine handles after the request returns.
 struct NullBrightnessControl : repowerd::BrightnessControl
 {
+    NullBrightnessControl(repowerd::BrightnessParams const& params)
+        : dim_brightness{static_cast<double>(params.dim_value) / params.max_value},
+          normal_brightness{static_cast<double>(params.default_value) / params.max_value}
+    {
+    }
+
     void disable_autobrightness() override {}
     void enable_autobrightness() override {}
-    void set_dim_brightness() override {}
-    void set_normal_brightness() override {}
-    void set_normal_brightness_value(double)  override {}
-    void set_off_brightness() override {}
+    void set_dim_brightness() override
+    {
+        transition_complete_handler(repowerd::no_brightness_transition_id, dim_brightness);
+    }
+    void set_normal_brightness() override
+    {
+        transition_complete_handler(repowerd::no_brightness_transition_id, normal_brightness);
+    }
+    void set_normal_brightness_value(double v)  override
+    {
+        normal_brightness = v;
+        transition_complete_handler(repowerd::no_brightness_transition_id, normal_brightness);
+    }
+    repowerd::BrightnessTransitionId set_off_brightness() override
+    {
+        auto id = next_off_transition_id++;
+        if (id == repowerd::no_brightness_transition_id)
+            id = next_off_transition_id++;
+        transition_complete_handler(id, 0.0);
+        return id;
+    }
+
+    repowerd::HandlerRegistration register_brightness_transition_complete_handler(
+        repowerd::BrightnessTransitionCompleteHandler const& handler) override
+    {
+        transition_complete_handler = handler;
+        return repowerd::HandlerRegistration{
+            [this] { transition_complete_handler = [](auto...){}; }};
+    }
+
+    double const dim_brightness;
+    double normal_brightness;
+    repowerd::BrightnessTransitionCompleteHandler transition_complete_handler{[](auto...){}};
+    repowerd::BrightnessTransitionId next_off_transition_id{1};
+};
+
+struct NullDaemonEventTrace : repowerd::DaemonEventTrace
+{
+    void record(repowerd::DaemonEvent const&) override {}
 };
 
 struct NullBrightnessNotification : repowerd::BrightnessNotification
@@ -121,6 +178,12 @@ struct NullWakeupService : repowerd::WakeupService
         return {};
     }
 
+    std::string schedule_wakeup_at(
+        std::chrono::system_clock::time_point, std::chrono::milliseconds) override
+    {
+        return {};
+    }
+
     void cancel_wakeup(std::string const&) override {}
 
     repowerd::HandlerRegistration register_wakeup_handler(
@@ -144,7 +207,8 @@ repowerd::DefaultDaemonConfig::the_brightness_control()
     {
         the_log()->log(log_tag, "Failed to create BrightnessControl: %s", e.what());
         the_log()->log(log_tag, "Falling back to NullBrightnessControl");
-        brightness_control = std::make_shared<NullBrightnessControl>();
+        brightness_control = std::make_shared<NullBrightnessControl>(
+            BrightnessParams::from_device_config(*the_device_config()));
     }
 
     return brightness_control;
@@ -156,6 +220,43 @@ repowerd::DefaultDaemonConfig::the_client_requests()
     return the_unity_screen_service();
 }
 
+std::shared_ptr<repowerd::DaemonEventTrace>
+repowerd::DefaultDaemonConfig::the_daemon_event_trace()
+{
+    if (!daemon_event_trace)
+    {
+        auto const trace_env_cstr = getenv("REPOWERD_EVENT_TRACE");
+        std::string const trace_env{trace_env_cstr ? trace_env_cstr : ""};
+
+        if (trace_env.empty())
+        {
+            daemon_event_trace = std::make_shared<NullDaemonEventTrace>();
+        }
+        else
+        try
+        {
+            daemon_event_trace = std::make_shared<FileDaemonEventTrace>(trace_env);
+            the_log()->log(log_tag, "Recording event trace to %s", trace_env.c_str());
+        }
+        catch (std::exception const& e)
+        {
+            the_log()->log(log_tag, "Failed to create FileDaemonEventTrace: %s", e.what());
+            the_log()->log(log_tag, "Falling back to NullDaemonEventTrace");
+            daemon_event_trace = std::make_shared<NullDaemonEventTrace>();
+        }
+    }
+
+    return daemon_event_trace;
+}
+
+std::shared_ptr<repowerd::DaemonStatistics>
+repowerd::DefaultDaemonConfig::the_daemon_statistics()
+{
+    if (!daemon_statistics)
+        daemon_statistics = std::make_shared<DaemonStatistics>();
+    return daemon_statistics;
+}
+
 std::shared_ptr<repowerd::DisplayPowerControl>
 repowerd::DefaultDaemonConfig::the_display_power_control()
 {
@@ -163,7 +264,7 @@ repowerd::DefaultDaemonConfig::the_display_power_control()
     {
         display_power_control = std::make_shared<UnityDisplayPowerControl>(
             the_log(),
-            the_dbus_bus_address());
+            *the_dbus_connection());
     }
     return display_power_control;
 }
@@ -224,7 +325,11 @@ repowerd::DefaultDaemonConfig::the_power_source()
     if (!power_source)
     {
         power_source = std::make_shared<UPowerPowerSource>(
-            the_log(), the_temporary_suspend_inhibition(), *the_device_config(), the_dbus_bus_address());
+            the_log(),
+            the_temporary_suspend_inhibition(),
+            *the_device_config(),
+            *the_dbus_connection(),
+            the_shared_dbus_event_loop());
     }
 
     return power_source;
@@ -282,7 +387,7 @@ std::shared_ptr<repowerd::Timer>
 repowerd::DefaultDaemonConfig::the_timer()
 {
     if (!timer)
-        timer = std::make_shared<EventLoopTimer>();
+        timer = std::make_shared<EventLoopTimer>(the_log());
     return timer;
 }
 
@@ -290,7 +395,8 @@ std::shared_ptr<repowerd::UserActivity>
 repowerd::DefaultDaemonConfig::the_user_activity()
 {
     if (!user_activity)
-        user_activity = std::make_shared<UnityUserActivity>(the_dbus_bus_address());
+        user_activity = std::make_shared<UnityUserActivity>(
+            *the_dbus_connection(), the_shared_dbus_event_loop());
     return user_activity;
 }
 
@@ -300,6 +406,28 @@ repowerd::DefaultDaemonConfig::the_voice_call_service()
     return the_ofono_voice_call_service();
 }
 
+std::chrono::milliseconds
+repowerd::DefaultDaemonConfig::handler_stall_budget()
+{
+    auto const budget_env_cstr = getenv("REPOWERD_HANDLER_STALL_BUDGET_MS");
+    std::string const budget_env{budget_env_cstr ? budget_env_cstr : ""};
+
+    if (budget_env.empty())
+        return 1s;
+
+    try
+    {
+        auto const budget_ms = std::stoi(budget_env);
+        return budget_ms > 0 ? std::chrono::milliseconds{budget_ms} : infinite_timeout;
+    }
+    catch (std::exception const&)
+    {
+        the_log()->log(log_tag, "Ignoring invalid REPOWERD_HANDLER_STALL_BUDGET_MS=%s",
+                       budget_env.c_str());
+        return 1s;
+    }
+}
+
 std::chrono::milliseconds
 repowerd::DefaultDaemonConfig::notification_expiration_timeout()
 {
@@ -369,6 +497,33 @@ repowerd::DefaultDaemonConfig::the_backlight()
             the_log()->log(log_tag, "Failed to create SyfsBacklight: %s", e.what());
             throw std::runtime_error("Failed to create backlight");
         }
+
+        // Keyboard backlights follow the display backlight
+        std::vector<BacklightGroupMember> secondaries;
+
+        for (auto const& dir : SysfsBacklight::keyboard_backlight_dirs(*the_filesystem()))
+        {
+            try
+            {
+                secondaries.push_back(
+                    BacklightGroupMember::from_device_config(
+                        std::make_shared<SysfsBacklight>(the_log(), the_filesystem(), dir),
+                        *the_device_config(),
+                        "keyboardBacklight"));
+            }
+            catch (std::exception const& e)
+            {
+                the_log()->log(log_tag, "Failed to create keyboard SysfsBacklight: %s", e.what());
+            }
+        }
+
+        if (!secondaries.empty())
+        {
+            backlight = std::make_shared<BacklightGroup>(
+                backlight,
+                BrightnessCurve::from_device_config(*the_device_config()),
+                secondaries);
+        }
     }
 
     return backlight;
@@ -384,14 +539,20 @@ repowerd::DefaultDaemonConfig::the_backlight_brightness_control()
 
         auto const ab_log = ab_log_env.empty() ? std::make_shared<NullLog>() : the_log();
 
+        // Transitions get their own timer, since the daemon is the sole alarm
+        // handler of the_timer(). The timer shares the thread of the control,
+        // so that transition ticks run as soon as the timer fires.
+        auto const transition_event_loop = std::make_shared<EventLoop>();
+
         backlight_brightness_control = std::make_shared<BacklightBrightnessControl>(
             the_backlight(),
             the_light_sensor(),
             std::make_shared<AndroidAutobrightnessAlgorithm>(*the_device_config(), ab_log), 
-            the_chrono(),
+            std::make_shared<EventLoopTimer>(the_log(), transition_event_loop),
             the_log(),
             *the_device_config(),
-            *the_device_quirks());
+            *the_device_quirks(),
+            transition_event_loop);
     }
 
     return backlight_brightness_control;
@@ -415,15 +576,6 @@ repowerd::DefaultDaemonConfig::the_brightness_notification()
     return brightness_notification;
 }
 
-std::shared_ptr<repowerd::Chrono>
-repowerd::DefaultDaemonConfig::the_chrono()
-{
-    if (!chrono)
-        chrono = std::make_shared<RealChrono>();
-
-    return chrono;
-}
-
 std::string repowerd::DefaultDaemonConfig::the_dbus_bus_address()
 {
     auto const address = std::unique_ptr<gchar, decltype(&g_free)>{
@@ -433,6 +585,15 @@ std::string repowerd::DefaultDaemonConfig::the_dbus_bus_address()
     return address ? address.get() : std::string{};
 }
 
+std::shared_ptr<repowerd::DBusConnectionHandle>
+repowerd::DefaultDaemonConfig::the_dbus_connection()
+{
+    if (!dbus_connection)
+        dbus_connection = std::make_shared<DBusConnectionHandle>(the_dbus_bus_address());
+
+    return dbus_connection;
+}
+
 std::shared_ptr<repowerd::DeviceConfig>
 repowerd::DefaultDaemonConfig::the_device_config()
 {
@@ -491,11 +652,55 @@ repowerd::DefaultDaemonConfig::the_ofono_voice_call_service()
     {
         ofono_voice_call_service = std::make_shared<OfonoVoiceCallService>(
             the_log(),
-            the_dbus_bus_address());
+            *the_dbus_connection(),
+            the_shared_dbus_event_loop());
     }
     return ofono_voice_call_service;
 }
 
+std::shared_ptr<repowerd::EventLoop>
+repowerd::DefaultDaemonConfig::the_shared_dbus_event_loop()
+{
+    if (!shared_dbus_event_loop)
+    {
+        auto const shared_env_cstr = getenv("REPOWERD_SHARED_DBUS_EVENT_LOOP");
+        std::string const shared_env{shared_env_cstr ? shared_env_cstr : ""};
+
+        if (shared_env == "1")
+        {
+            the_log()->log(log_tag, "Using a shared event loop for DBus adapters");
+            shared_dbus_event_loop = std::make_shared<EventLoop>();
+        }
+    }
+
+    return shared_dbus_event_loop;
+}
+
+std::shared_ptr<repowerd::RequestJournal>
+repowerd::DefaultDaemonConfig::the_request_journal()
+{
+    if (!request_journal)
+    try
+    {
+        auto const journal_env_cstr = getenv("REPOWERD_REQUEST_JOURNAL");
+        // /run is cleared on reboot, when all client requests are gone anyway
+        std::string const journal_path{
+            journal_env_cstr ? journal_env_cstr : "/run/repowerd-requests.journal"};
+        size_t const max_journal_records{4096};
+
+        request_journal = std::make_shared<MmapRequestJournal>(
+            journal_path, max_journal_records);
+    }
+    catch (std::exception const& e)
+    {
+        the_log()->log(log_tag, "Failed to create MmapRequestJournal: %s", e.what());
+        the_log()->log(log_tag, "Falling back to NullRequestJournal");
+        request_journal = std::make_shared<NullRequestJournal>();
+    }
+
+    return request_journal;
+}
+
 std::shared_ptr<repowerd::TemporarySuspendInhibition>
 repowerd::DefaultDaemonConfig::the_temporary_suspend_inhibition()
 {
@@ -532,11 +737,14 @@ repowerd::DefaultDaemonConfig::the_unity_screen_service()
         unity_screen_service = std::make_shared<UnityScreenService>(
             the_wakeup_service(),
             the_brightness_notification(),
+            the_daemon_statistics(),
             the_log(),
             the_suspend_control(),
             the_temporary_suspend_inhibition(),
             *the_device_config(),
-            the_dbus_bus_address());
+            *the_dbus_connection(),
+            the_shared_dbus_event_loop(),
+            the_request_journal());
     }
 
     return unity_screen_service;
@@ -546,7 +754,8 @@ std::shared_ptr<repowerd::UnityPowerButton>
 repowerd::DefaultDaemonConfig::the_unity_power_button()
 {
     if (!unity_power_button)
-        unity_power_button = std::make_shared<UnityPowerButton>(the_dbus_bus_address());
+        unity_power_button = std::make_shared<UnityPowerButton>(
+            *the_dbus_connection(), the_shared_dbus_event_loop());
     return unity_power_button;
 }
 
@@ -561,6 +770,18 @@ repowerd::DefaultDaemonConfig::the_wakeup_service()
     catch (std::exception const& e)
     {
         the_log()->log(log_tag, "Failed to create DevAlarmWakeupService: %s", e.what());
+        the_log()->log(log_tag, "Falling back to TimerfdWakeupService");
+    }
+
+    if (!wakeup_service)
+    try
+    {
+        wakeup_service = std::make_shared<TimerfdWakeupService>(
+            the_log(), std::make_shared<RealTimerfdClock>(CLOCK_REALTIME_ALARM));
+    }
+    catch (std::exception const& e)
+    {
+        the_log()->log(log_tag, "Failed to create TimerfdWakeupService: %s", e.what());
         the_log()->log(log_tag, "Falling back to NullWakeupService");
         wakeup_service = std::make_shared<NullWakeupService>();
     }
@@ -26,12 +26,14 @@ namespace repowerd
 class Backlight;
 class BacklightBrightnessControl;
 class BrightnessNotification;
-class Chrono;
+class DBusConnectionHandle;
 class DeviceConfig;
 class DeviceQuirks;
+class EventLoop;
 class Filesystem;
 class LightSensor;
 class OfonoVoiceCallService;
+class RequestJournal;
 class TemporarySuspendInhibition;
 class UnityScreenService;
 class UnityPowerButton;
@@ -42,6 +44,8 @@ class DefaultDaemonConfig : public DaemonConfig
 public:
     std::shared_ptr<BrightnessControl> the_brightness_control() override;
     std::shared_ptr<ClientRequests> the_client_requests() override;
+    std::shared_ptr<DaemonEventTrace> the_daemon_event_trace() override;
+    std::shared_ptr<DaemonStatistics> the_daemon_statistics() override;
     std::shared_ptr<DisplayPowerControl> the_display_power_control() override;
     std::shared_ptr<DisplayPowerEventSink> the_display_power_event_sink() override;
     std::shared_ptr<Log> the_log() override;
@@ -59,6 +63,7 @@ public:
     std::shared_ptr<UserActivity> the_user_activity() override;
     std::shared_ptr<VoiceCallService> the_voice_call_service() override;
 
+    std::chrono::milliseconds handler_stall_budget() override;
     std::chrono::milliseconds notification_expiration_timeout() override;
     std::chrono::milliseconds power_button_long_press_timeout() override;
     std::chrono::milliseconds user_inactivity_normal_display_dim_duration() override;
@@ -71,13 +76,19 @@ public:
     std::shared_ptr<Backlight> the_backlight();
     std::shared_ptr<BacklightBrightnessControl> the_backlight_brightness_control();
     std::shared_ptr<BrightnessNotification> the_brightness_notification();
-    std::shared_ptr<Chrono> the_chrono();
     std::string the_dbus_bus_address();
+    std::shared_ptr<DBusConnectionHandle> the_dbus_connection();
     std::shared_ptr<DeviceConfig> the_device_config();
     std::shared_ptr<DeviceQuirks> the_device_quirks();
     std::shared_ptr<Filesystem> the_filesystem();
     std::shared_ptr<LightSensor> the_light_sensor();
     std::shared_ptr<OfonoVoiceCallService> the_ofono_voice_call_service();
+    // Journals outstanding client requests to REPOWERD_REQUEST_JOURNAL,
+    // or to a file in /run by default
+    std::shared_ptr<RequestJournal> the_request_journal();
+    // Returns null unless the D-Bus adapters should share a single event
+    // loop thread (REPOWERD_SHARED_DBUS_EVENT_LOOP=1)
+    std::shared_ptr<EventLoop> the_shared_dbus_event_loop();
     std::shared_ptr<TemporarySuspendInhibition> the_temporary_suspend_inhibition();
     std::shared_ptr<UnityScreenService> the_unity_screen_service();
     std::shared_ptr<UnityPowerButton> the_unity_power_button();
@@ -88,7 +99,9 @@ private:
     std::shared_ptr<BacklightBrightnessControl> backlight_brightness_control;
     std::shared_ptr<BrightnessControl> brightness_control;
     std::shared_ptr<BrightnessNotification> brightness_notification;
-    std::shared_ptr<Chrono> chrono;
+    std::shared_ptr<DaemonEventTrace> daemon_event_trace;
+    std::shared_ptr<DaemonStatistics> daemon_statistics;
+    std::shared_ptr<DBusConnectionHandle> dbus_connection;
     std::shared_ptr<DeviceConfig> device_config;
     std::shared_ptr<DeviceQuirks> device_quirks;
     std::shared_ptr<DisplayPowerControl> display_power_control;
@@ -100,6 +113,8 @@ private:
     std::shared_ptr<PerformanceBooster> performance_booster;
     std::shared_ptr<PowerSource> power_source;
     std::shared_ptr<ProximitySensor> proximity_sensor;
+    std::shared_ptr<RequestJournal> request_journal;
+    std::shared_ptr<EventLoop> shared_dbus_event_loop;
     std::shared_ptr<ShutdownControl> shutdown_control;
     std::shared_ptr<StateMachine> state_machine;
     std::shared_ptr<SuspendControl> suspend_control;
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/default_daemon_config.h"
+#include "src/adapters/backlight.h"
+#include "src/adapters/brightness_curve.h"
+#include "src/adapters/brightness_params.h"
+#include "src/adapters/brightness_transition_planner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+
+char const* curve_name(repowerd::BrightnessCurve const& curve)
+{
+    switch (curve.type)
+    {
+    case repowerd::BrightnessCurve::Type::linear: return "linear";
+    case repowerd::BrightnessCurve::Type::cie_lightness: return "cie";
+    case repowerd::BrightnessCurve::Type::gamma: return "gamma";
+    }
+
+    return "unknown";
+}
+
+void print_plan(
+    repowerd::BrightnessTransitionPlanner const& planner,
+    char const* name,
+    double start, double target,
+    repowerd::BrightnessTransitionPlanner::Speed speed)
+{
+    auto const plan = planner.plan(start, target, speed);
+
+    std::printf("%s: %.3f => %.3f, %d writes",
+                name, start, target, static_cast<int>(plan.size()));
+    if (!plan.empty())
+        std::printf(" over %dms", static_cast<int>(plan.back().time.count()));
+    std::printf("\n");
+
+    for (auto const& step : plan)
+    {
+        std::printf("  %4dms %.4f (%d)\n",
+                    static_cast<int>(step.time.count()),
+                    step.brightness,
+                    planner.absolute_brightness_for(step.brightness));
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    setenv("REPOWERD_LOG", "console", 1);
+
+    repowerd::DefaultDaemonConfig config;
+    auto const device_config = config.the_device_config();
+
+    // The maximum absolute brightness can be given explicitly, to plan for
+    // a device other than the one we are running on
+    auto const max_absolute_brightness = argc > 1 ?
+        std::atoi(argv[1]) : config.the_backlight()->max_absolute_brightness();
+
+    auto const curve = repowerd::BrightnessCurve::from_device_config(*device_config);
+    auto const params = repowerd::BrightnessParams::from_device_config(*device_config);
+    auto const dim = static_cast<double>(params.dim_value) / params.max_value;
+    auto const normal = static_cast<double>(params.default_value) / params.max_value;
+
+    repowerd::BrightnessTransitionPlanner const planner{curve, max_absolute_brightness};
+
+    std::printf("curve: %s", curve_name(curve));
+    if (curve.type == repowerd::BrightnessCurve::Type::gamma)
+        std::printf(" (gamma %.2f)", curve.gamma);
+    std::printf(", max absolute brightness: %d\n", max_absolute_brightness);
+
+    using Speed = repowerd::BrightnessTransitionPlanner::Speed;
+
+    print_plan(planner, "off => normal", 0.0, normal, Speed::normal);
+    print_plan(planner, "normal => dim", normal, dim, Speed::normal);
+    print_plan(planner, "dim => normal", dim, normal, Speed::normal);
+    print_plan(planner, "normal => off", normal, 0.0, Speed::normal);
+    print_plan(planner, "normal => full (autobrightness)", normal, 1.0, Speed::slow);
+}
@@ -45,9 +45,12 @@ void print_wakeups(std::vector<int> const& wakeups)
     std::cout << std::endl;
 }
 
-void print_wakeup_event(std::string const& cookie)
+void print_wakeup_event(std::vector<std::string> const& cookies)
 {
-    std::cout << "Wakeup with cookie '" << cookie << "'" << std::endl;
+    std::cout << "Wakeup with cookies";
+    for (auto const& cookie : cookies)
+        std::cout << " '" << cookie << "'";
+    std::cout << std::endl;
 }
 
 void print_usage(std::string const& progname)
@@ -79,10 +82,11 @@ int main(int argc, char** argv)
 
     auto wakeup_count = 0u;
     auto registration = wakeup_service->register_wakeup_handler(
-        [&] (std::string const& cookie)
-        { 
-            print_wakeup_event(cookie);
-            if (++wakeup_count == wakeups.size())
+        [&] (std::vector<std::string> const& cookies)
+        {
+            print_wakeup_event(cookies);
+            wakeup_count += cookies.size();
+            if (wakeup_count == wakeups.size())
                 done.set_value();
         });
 
@@ -182,7 +182,7 @@ void rt::DBusClient::invoke_async(
     static int const timeout_ms = 5000;
     reply->set_pending();
 
-    event_loop.enqueue(
+    event_loop.post(
         [this, reply, interface, method, args]
         {
             repowerd::DBusMessageHandle msg{
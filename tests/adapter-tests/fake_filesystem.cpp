@@ -21,6 +21,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 
@@ -143,6 +144,7 @@ repowerd::Fd repowerd::test::FakeFilesystem::open(
         if (paths.find(fd) == paths.end()) break;
 
     paths[fd] = path;
+    ++open_counts[path];
 
     return {fd, [this](int fd) { paths.erase(fd); return 0; }};
 }
@@ -161,6 +163,34 @@ int repowerd::test::FakeFilesystem::ioctl(
         return ioctl_handlers.at(path)(path.c_str(), request, args);
 }
 
+ssize_t repowerd::test::FakeFilesystem::pread(
+    int fd, void* buf, size_t count, off_t offset) const
+{
+    if (paths.find(fd) == paths.end() || files.find(paths[fd]) == files.end())
+        return -1;
+
+    auto const& contents = files[paths[fd]];
+    if (contents->empty() || static_cast<size_t>(offset) >= contents->back().size())
+        return 0;
+
+    auto const& data = contents->back();
+    auto const num_read = std::min(count, data.size() - offset);
+    data.copy(static_cast<char*>(buf), num_read, offset);
+
+    return num_read;
+}
+
+ssize_t repowerd::test::FakeFilesystem::pwrite(
+    int fd, void const* buf, size_t count, off_t) const
+{
+    if (paths.find(fd) == paths.end() || files.find(paths[fd]) == files.end())
+        return -1;
+
+    files[paths[fd]]->push_back({static_cast<char const*>(buf), count});
+
+    return count;
+}
+
 void repowerd::test::FakeFilesystem::add_file_with_contents(
     std::string const& path, std::string const& contents)
 {
@@ -189,6 +219,12 @@ void repowerd::test::FakeFilesystem::add_file_ioctl(
     ioctl_handlers[path] = handler;
 }
 
+int repowerd::test::FakeFilesystem::times_opened(std::string const& path) const
+{
+    auto const iter = open_counts.find(path);
+    return iter == open_counts.end() ? 0 : iter->second;
+}
+
 void repowerd::test::FakeFilesystem::add_dir(
     std::string const& path)
 {
@@ -45,11 +45,16 @@ public:
 
     Fd open(char const* pathname, int flags) const override;
     int ioctl(int fd, unsigned long request, void* args) const override;
+    // Each pwrite() replaces the contents of the file, and is recorded as a
+    // new entry in its contents, like a write through ostream()
+    ssize_t pread(int fd, void* buf, size_t count, off_t offset) const override;
+    ssize_t pwrite(int fd, void const* buf, size_t count, off_t offset) const override;
 
     void add_file_with_contents(std::string const& path, std::string const& contents);
     std::shared_ptr<std::deque<std::string>> add_file_with_live_contents(
         std::string const& path);
     void add_file_ioctl(std::string const& path, FakeFilesystemIoctlHandler const& handler);
+    int times_opened(std::string const& path) const;
 
 private:
     void add_dir(std::string const& path);
@@ -57,6 +62,7 @@ private:
     mutable std::unordered_map<std::string,std::shared_ptr<std::deque<std::string>>> files;
     std::unordered_set<std::string> directories;
     mutable std::unordered_map<int,std::string> paths;
+    mutable std::unordered_map<std::string,int> open_counts;
     std::unordered_map<std::string,FakeFilesystemIoctlHandler> ioctl_handlers;
 };
 
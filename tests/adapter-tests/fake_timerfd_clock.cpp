@@ -0,0 +1,101 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "fake_timerfd_clock.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/eventfd.h>
+
+namespace rt = repowerd::test;
+
+rt::FakeTimerfdClock::FakeTimerfdClock()
+    : current_time{std::chrono::system_clock::from_time_t(1000000)},
+      armed_tp{std::chrono::system_clock::time_point::max()},
+      timer_fd{-1},
+      fail_on_next_arm_{false}
+{
+}
+
+repowerd::Fd rt::FakeTimerfdClock::create_timerfd()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    timer_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (timer_fd < 0)
+        throw std::system_error{errno, std::system_category(), "Failed to create eventfd"};
+    return Fd{timer_fd};
+}
+
+int rt::FakeTimerfdClock::arm_timerfd(
+    int /*fd*/,
+    std::chrono::system_clock::time_point tp,
+    std::chrono::system_clock::time_point /*now*/)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    if (fail_on_next_arm_)
+    {
+        fail_on_next_arm_ = false;
+        errno = EINVAL;
+        return -1;
+    }
+
+    armed_tp = tp;
+    expire_if_due();
+
+    return 0;
+}
+
+std::chrono::system_clock::time_point rt::FakeTimerfdClock::now()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return current_time;
+}
+
+void rt::FakeTimerfdClock::advance_by(std::chrono::system_clock::duration advance)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    current_time += advance;
+    expire_if_due();
+}
+
+std::chrono::system_clock::time_point rt::FakeTimerfdClock::armed_time()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return armed_tp;
+}
+
+void rt::FakeTimerfdClock::fail_on_next_arm()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    fail_on_next_arm_ = true;
+}
+
+void rt::FakeTimerfdClock::expire_if_due()
+{
+    if (armed_tp == std::chrono::system_clock::time_point::max() ||
+        armed_tp > current_time)
+    {
+        return;
+    }
+
+    armed_tp = std::chrono::system_clock::time_point::max();
+    eventfd_write(timer_fd, 1);
+}
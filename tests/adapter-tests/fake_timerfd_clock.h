@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#pragma once
+
+#include "src/adapters/timerfd_clock.h"
+
+#include <mutex>
+
+namespace repowerd
+{
+namespace test
+{
+
+// Expires the timerfd, which is an eventfd, only when advance_by() reaches
+// the armed time
+class FakeTimerfdClock : public TimerfdClock
+{
+public:
+    FakeTimerfdClock();
+
+    Fd create_timerfd() override;
+    int arm_timerfd(
+        int fd,
+        std::chrono::system_clock::time_point tp,
+        std::chrono::system_clock::time_point now) override;
+    std::chrono::system_clock::time_point now() override;
+
+    void advance_by(std::chrono::system_clock::duration advance);
+    // The time the timerfd is armed for, or time_point::max() if it's
+    // disarmed or has expired
+    std::chrono::system_clock::time_point armed_time();
+    void fail_on_next_arm();
+
+private:
+    // Called with mutex held
+    void expire_if_due();
+
+    std::mutex mutex;
+    std::chrono::system_clock::time_point current_time;
+    std::chrono::system_clock::time_point armed_tp;
+    int timer_fd;
+    bool fail_on_next_arm_;
+};
+
+}
+}
@@ -21,14 +21,22 @@
 namespace rt = repowerd::test;
 
 rt::FakeWakeupService::FakeWakeupService()
-    : wakeup_handler{[](std::string const&){}}
+    : wakeup_handler{[](std::vector<std::string> const&){}}
 {
 }
 
 std::string rt::FakeWakeupService::schedule_wakeup_at(
     std::chrono::system_clock::time_point tp)
+{
+    return schedule_wakeup_at(tp, std::chrono::milliseconds{0});
+}
+
+std::string rt::FakeWakeupService::schedule_wakeup_at(
+    std::chrono::system_clock::time_point tp,
+    std::chrono::milliseconds tolerance)
 {
     wakeups.push_back(tp);
+    tolerances.push_back(tolerance);
     return std::to_string(wakeups.size() - 1);
 }
 
@@ -41,6 +49,7 @@ void rt::FakeWakeupService::cancel_wakeup(std::string const& cookie)
 std::chrono::system_clock::time_point rt::FakeWakeupService::emit_next_wakeup()
 {
     std::chrono::system_clock::time_point next{};
+    std::vector<std::string> cookies;
 
     for (auto i = 0u; i < wakeups.size(); ++i)
     {
@@ -48,13 +57,21 @@ std::chrono::system_clock::time_point rt::FakeWakeupService::emit_next_wakeup()
         {
             next = wakeups[i];
             wakeups[i] = {};
-            wakeup_handler(std::to_string(i));
+            cookies.push_back(std::to_string(i));
         }
     }
 
+    if (!cookies.empty())
+        wakeup_handler(cookies);
+
     return next;
 }
 
+std::chrono::milliseconds rt::FakeWakeupService::tolerance_of(std::string const& cookie)
+{
+    return tolerances.at(std::stoi(cookie));
+}
+
 repowerd::HandlerRegistration rt::FakeWakeupService::register_wakeup_handler(
     repowerd::WakeupHandler const& handler)
 {
@@ -64,6 +81,6 @@ repowerd::HandlerRegistration rt::FakeWakeupService::register_wakeup_handler(
         [this]
         {
             mock.unregister_wakeup_handler();
-            this->wakeup_handler = [](std::string const&){};
+            this->wakeup_handler = [](std::vector<std::string> const&){};
         }};
 }
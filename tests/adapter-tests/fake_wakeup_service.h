@@ -35,11 +35,15 @@ public:
     FakeWakeupService();
 
     std::string schedule_wakeup_at(std::chrono::system_clock::time_point tp) override;
+    std::string schedule_wakeup_at(
+        std::chrono::system_clock::time_point tp,
+        std::chrono::milliseconds tolerance) override;
     void cancel_wakeup(std::string const& cookie) override;
     repowerd::HandlerRegistration register_wakeup_handler(
         repowerd::WakeupHandler const& handler) override;
 
     std::chrono::system_clock::time_point emit_next_wakeup();
+    std::chrono::milliseconds tolerance_of(std::string const& cookie);
 
     struct MockMethods
     {
@@ -51,6 +55,7 @@ public:
 private:
     repowerd::WakeupHandler wakeup_handler;
     std::vector<std::chrono::system_clock::time_point> wakeups;
+    std::vector<std::chrono::milliseconds> tolerances;
 };
 
 }
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/alarm_heap.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct AnAlarmHeap : testing::Test
+{
+    std::vector<repowerd::AlarmId> pop_due(repowerd::AlarmHeap::TimePoint now)
+    {
+        std::vector<repowerd::AlarmId> due;
+        heap.pop_due(now, due);
+        return due;
+    }
+
+    repowerd::AlarmHeap heap;
+    repowerd::AlarmHeap::TimePoint const start{std::chrono::steady_clock::now()};
+};
+
+}
+
+TEST_F(AnAlarmHeap, pops_due_alarms_in_deadline_order)
+{
+    heap.push(1, start + 30ms);
+    heap.push(2, start + 10ms);
+    heap.push(3, start + 40ms);
+    heap.push(4, start + 20ms);
+
+    EXPECT_THAT(pop_due(start + 30ms), ElementsAre(2, 4, 1));
+    EXPECT_THAT(pop_due(start + 40ms), ElementsAre(3));
+    EXPECT_THAT(heap.size(), Eq(0u));
+}
+
+TEST_F(AnAlarmHeap, pops_alarms_with_equal_deadlines_in_scheduling_order)
+{
+    for (int i = 1; i <= 10; ++i)
+        heap.push(i, start);
+
+    EXPECT_THAT(pop_due(start), ElementsAre(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+}
+
+TEST_F(AnAlarmHeap, pops_alarms_with_equal_deadlines_in_scheduling_order_across_id_wraparound)
+{
+    repowerd::AlarmId id{std::numeric_limits<int>::max() - 1};
+
+    std::vector<repowerd::AlarmId> expected_ids;
+    for (int i = 0; i < 4; ++i)
+    {
+        auto const alarm_id = id++;
+        heap.push(alarm_id, start);
+        expected_ids.push_back(alarm_id);
+    }
+
+    EXPECT_THAT(pop_due(start), ContainerEq(expected_ids));
+}
+
+TEST_F(AnAlarmHeap, does_not_pop_cancelled_alarms)
+{
+    heap.push(1, start + 10ms);
+    heap.push(2, start + 20ms);
+    heap.push(3, start + 30ms);
+
+    heap.cancel(1);
+    heap.cancel(3);
+
+    EXPECT_THAT(pop_due(start + 30ms), ElementsAre(2));
+    EXPECT_THAT(heap.size(), Eq(0u));
+}
+
+TEST_F(AnAlarmHeap, reports_next_deadline_of_live_alarms)
+{
+    EXPECT_THAT(heap.next_deadline(), Eq(repowerd::AlarmHeap::TimePoint::max()));
+
+    heap.push(1, start + 10ms);
+    heap.push(2, start + 20ms);
+    EXPECT_THAT(heap.next_deadline(), Eq(start + 10ms));
+
+    heap.cancel(1);
+    EXPECT_THAT(heap.next_deadline(), Eq(start + 20ms));
+
+    heap.cancel(2);
+    EXPECT_THAT(heap.next_deadline(), Eq(repowerd::AlarmHeap::TimePoint::max()));
+}
+
+TEST_F(AnAlarmHeap, keeps_order_under_schedule_and_cancel_churn)
+{
+    std::mt19937 rng{1234};
+    std::uniform_int_distribution<int> offset_ms{0, 10000};
+    std::vector<std::pair<repowerd::AlarmHeap::TimePoint,int>> expected;
+
+    for (int id = 1; id <= 10000; ++id)
+    {
+        auto const deadline = start + std::chrono::milliseconds{offset_ms(rng)};
+        heap.push(id, deadline);
+
+        if (id % 3 == 0)
+            heap.cancel(id);
+        else
+            expected.emplace_back(deadline, id);
+    }
+
+    std::sort(expected.begin(), expected.end());
+    std::vector<repowerd::AlarmId> expected_ids;
+    for (auto const& e : expected)
+        expected_ids.push_back(e.second);
+
+    EXPECT_THAT(heap.size(), Eq(expected_ids.size()));
+    EXPECT_THAT(pop_due(start + 10s), ContainerEq(expected_ids));
+}
+
+TEST_F(AnAlarmHeap, keeps_live_alarms_when_compacting_cancelled_ones)
+{
+    for (int id = 1; id <= 1000; ++id)
+    {
+        heap.push(id, start + std::chrono::milliseconds{1000 - id});
+        if (id % 10 != 0)
+            heap.cancel(id);
+    }
+
+    heap.push(1001, start + 5ms);
+
+    std::vector<repowerd::AlarmId> expected_ids;
+    for (int id = 1000; id > 0; id -= 10)
+    {
+        expected_ids.push_back(id);
+        if (id == 1000)
+            expected_ids.push_back(1001);
+    }
+
+    EXPECT_THAT(heap.size(), Eq(expected_ids.size()));
+    EXPECT_THAT(pop_due(start + 1s), ContainerEq(expected_ids));
+}
+
+TEST(AnAlarmHeapWithOtherKeyAndClockTypes, pops_due_keys_in_deadline_order)
+{
+    using Heap = repowerd::BasicAlarmHeap<uint64_t,std::chrono::system_clock::time_point>;
+
+    Heap heap;
+    auto const start = std::chrono::system_clock::now();
+
+    heap.push(11, start + 20ms);
+    heap.push(12, start + 10ms);
+    heap.push(13, start + 30ms);
+
+    EXPECT_TRUE(heap.cancel(13));
+    EXPECT_FALSE(heap.cancel(13));
+
+    std::vector<uint64_t> due;
+    heap.pop_due(start + 30ms, due);
+
+    EXPECT_THAT(due, ElementsAre(12, 11));
+    EXPECT_THAT(heap.next_deadline(), Eq(Heap::TimePoint::max()));
+}
@@ -19,10 +19,11 @@
 #include "src/adapters/autobrightness_algorithm.h"
 #include "src/adapters/backlight_brightness_control.h"
 #include "src/adapters/backlight.h"
+#include "src/adapters/brightness_transition_trace.h"
 #include "src/adapters/event_loop_handler_registration.h"
 #include "src/adapters/light_sensor.h"
+#include "src/core/timer.h"
 
-#include "fake_chrono.h"
 #include "fake_device_config.h"
 #include "fake_device_quirks.h"
 #include "fake_log.h"
@@ -32,6 +33,7 @@
 #include <gmock/gmock.h>
 
 #include <thread>
+#include <mutex>
 #include <algorithm>
 #include <numeric>
 #include <cmath>
@@ -57,6 +59,11 @@ public:
         return brightness_history.back();
     }
 
+    int max_absolute_brightness() override
+    {
+        return max_brightness;
+    }
+
     void clear_brightness_history()
     {
         auto const last = brightness_history.back();
@@ -90,6 +97,7 @@ public:
 
     double const starting_brightness = 0.5;
     std::vector<double> brightness_history{starting_brightness};
+    int max_brightness = 255;
 };
 
 class FakeLightSensor : public repowerd::LightSensor
@@ -166,36 +174,108 @@ public:
     std::vector<double> light_history;
 };
 
+// A timer whose time jumps to each alarm as soon as it is scheduled, so that
+// transitions complete without waiting, but are still timed exactly. Like
+// EventLoopTimer, it calls the alarm handler on the thread of a shared loop.
+class FakeTimer : public repowerd::Timer
+{
+public:
+    FakeTimer(std::shared_ptr<repowerd::EventLoop> const& shared_loop)
+        : event_loop{shared_loop}
+    {
+    }
+
+    repowerd::HandlerRegistration register_alarm_handler(
+        repowerd::AlarmHandler const& handler) override
+    {
+        return repowerd::EventLoopHandlerRegistration{
+            event_loop,
+            [this, &handler] { alarm_handler = handler; },
+            [this] { alarm_handler = [](repowerd::AlarmId){}; }};
+    }
+
+    repowerd::AlarmId schedule_alarm_in(std::chrono::milliseconds t) override
+    {
+        repowerd::AlarmId id;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            now_ms += t;
+            id = next_alarm_id++;
+        }
+
+        event_loop.post([this, id] { alarm_handler(id); });
+        return id;
+    }
+
+    repowerd::AlarmId schedule_alarm_in(
+        std::chrono::milliseconds t, std::chrono::milliseconds) override
+    {
+        return schedule_alarm_in(t);
+    }
+
+    void cancel_alarm(repowerd::AlarmId) override {}
+    bool consume_fired_alarm(repowerd::AlarmId) override { return true; }
+
+    std::chrono::steady_clock::time_point now() override
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return std::chrono::steady_clock::time_point{now_ms};
+    }
+
+private:
+    repowerd::EventLoop event_loop;
+    repowerd::AlarmHandler alarm_handler{[](repowerd::AlarmId){}};
+    std::mutex mutex;
+    repowerd::AlarmId next_alarm_id{1};
+    std::chrono::milliseconds now_ms{0};
+};
+
 struct ABacklightBrightnessControl : Test
 {
     void expect_brightness_value(double brightness)
     {
+        brightness_control.flush();
         EXPECT_THAT(backlight.brightness_history.back(), Eq(brightness));
     }
 
     std::chrono::milliseconds duration_of(std::function<void()> const& func)
     {
-        auto start = fake_chrono.steady_now();
+        auto start = fake_timer.now();
         func();
+        brightness_control.flush();
         return std::chrono::duration_cast<std::chrono::milliseconds>(
-            fake_chrono.steady_now() - start);
+            fake_timer.now() - start);
+    }
+
+    // Holds the event loop until the returned promise is set, so that all
+    // requests made meanwhile are queued before any transition tick runs
+    std::promise<void> hold_event_loop()
+    {
+        std::promise<void> release_promise;
+        auto const release = release_promise.get_future().share();
+        autobrightness_algorithm.event_loop->post([release] { release.wait(); });
+        return release_promise;
     }
 
     rt::FakeDeviceConfig fake_device_config;
     FakeBacklight backlight;
     FakeLightSensor light_sensor;
     FakeAutobrightnessAlgorithm autobrightness_algorithm;
-    rt::FakeChrono fake_chrono;
+    std::shared_ptr<repowerd::EventLoop> const transition_event_loop{
+        std::make_shared<repowerd::EventLoop>()};
+    FakeTimer fake_timer{transition_event_loop};
     rt::FakeLog fake_log;
     rt::FakeDeviceQuirks fake_device_quirks;
     repowerd::BacklightBrightnessControl brightness_control{
         rt::fake_shared(backlight), 
         rt::fake_shared(light_sensor), 
         rt::fake_shared(autobrightness_algorithm),
-        rt::fake_shared(fake_chrono),
+        rt::fake_shared(fake_timer),
         rt::fake_shared(fake_log),
         fake_device_config,
-        fake_device_quirks};
+        fake_device_quirks,
+        transition_event_loop};
 
     double const normal_percent =
         static_cast<double>(fake_device_config.brightness_default_value) /
@@ -256,7 +336,9 @@ TEST_F(ABacklightBrightnessControl, does_not_write_new_normal_brightness_value_i
 TEST_F(ABacklightBrightnessControl, transitions_smoothly_between_brightness_values_when_increasing)
 {
     brightness_control.set_off_brightness();
+    brightness_control.flush();
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(backlight.brightness_history.size(), Ge(20));
     EXPECT_THAT(backlight.brightness_steps_stddev(), Le(0.01));
@@ -266,9 +348,11 @@ TEST_F(ABacklightBrightnessControl, transitions_smoothly_between_brightness_valu
 {
     brightness_control.set_off_brightness();
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
     backlight.clear_brightness_history();
 
     brightness_control.set_off_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(backlight.brightness_history.size(), Ge(20));
     EXPECT_THAT(backlight.brightness_steps_stddev(), Le(0.01));
@@ -278,6 +362,7 @@ TEST_F(ABacklightBrightnessControl,
        transitions_between_zero_and_non_zero_brightness_in_100ms)
 {
     brightness_control.set_off_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(duration_of([&]{brightness_control.set_normal_brightness();}), IsAbout(100ms));
     EXPECT_THAT(duration_of([&]{brightness_control.set_off_brightness();}), IsAbout(100ms));
@@ -297,6 +382,7 @@ TEST_F(ABacklightBrightnessControl,
 {
     brightness_control.set_normal_brightness();
     brightness_control.enable_autobrightness();
+    brightness_control.flush();
     light_sensor.emit_light_if_enabled(500.0);
 
     EXPECT_THAT(autobrightness_algorithm.light_history.size(), Eq(0));
@@ -307,6 +393,7 @@ TEST_F(ABacklightBrightnessControl,
 {
     brightness_control.enable_autobrightness();
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
     light_sensor.emit_light_if_enabled(500.0);
 
     EXPECT_THAT(autobrightness_algorithm.light_history.size(), Eq(0));
@@ -339,6 +426,7 @@ TEST_F(ABacklightBrightnessControl,
 
     brightness_control.enable_autobrightness();
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(backlight.brightness_history.size(), Eq(prev_history_size));
 
@@ -352,20 +440,23 @@ TEST_F(ABacklightBrightnessControl,
        sets_normal_brightness_if_autobrightness_enabled_when_set_from_off_to_normal_mode_with_quirk)
 {
     fake_device_quirks.set_normal_before_display_on_autobrightness(true);
+    FakeTimer quirked_fake_timer{transition_event_loop};
     repowerd::BacklightBrightnessControl quirked_brightness_control{
         rt::fake_shared(backlight), 
         rt::fake_shared(light_sensor), 
         rt::fake_shared(autobrightness_algorithm),
-        rt::fake_shared(fake_chrono),
+        rt::fake_shared(quirked_fake_timer),
         rt::fake_shared(fake_log),
         fake_device_config,
-        fake_device_quirks};
+        fake_device_quirks,
+        transition_event_loop};
 
     quirked_brightness_control.enable_autobrightness();
     quirked_brightness_control.set_normal_brightness();
     quirked_brightness_control.set_off_brightness();
 
     quirked_brightness_control.set_normal_brightness();
+    quirked_brightness_control.flush();
     expect_brightness_value(normal_percent);
 }
 
@@ -436,6 +527,7 @@ TEST_F(ABacklightBrightnessControl,
     brightness_control.set_normal_brightness();
     brightness_control.enable_autobrightness();
     brightness_control.enable_autobrightness();
+    brightness_control.flush();
     Mock::VerifyAndClearExpectations(&autobrightness_algorithm.mock);
 }
 
@@ -448,6 +540,7 @@ TEST_F(ABacklightBrightnessControl,
     brightness_control.enable_autobrightness();
     brightness_control.disable_autobrightness();
     brightness_control.disable_autobrightness();
+    brightness_control.flush();
     Mock::VerifyAndClearExpectations(&autobrightness_algorithm.mock);
 }
 
@@ -456,6 +549,7 @@ TEST_F(ABacklightBrightnessControl,
 {
     EXPECT_CALL(autobrightness_algorithm.mock, stop()).Times(1);
     brightness_control.set_off_brightness();
+    brightness_control.flush();
     Mock::VerifyAndClearExpectations(&autobrightness_algorithm.mock);
 }
 
@@ -465,6 +559,7 @@ TEST_F(ABacklightBrightnessControl,
     EXPECT_CALL(autobrightness_algorithm.mock, start()).Times(1);
     brightness_control.enable_autobrightness();
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
     Mock::VerifyAndClearExpectations(&autobrightness_algorithm.mock);
 }
 
@@ -492,10 +587,12 @@ TEST_F(ABacklightBrightnessControl, notifies_of_brightness_change)
 
     brightness_control.set_normal_brightness();
     brightness_control.set_normal_brightness_value(0.9);
+    brightness_control.flush();
 
     EXPECT_THAT(notified_brightness, Eq(0.9));
 
     brightness_control.set_dim_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(notified_brightness, Eq(dim_percent));
 }
@@ -511,6 +608,7 @@ TEST_F(ABacklightBrightnessControl, notifies_of_autobrightness_change)
     brightness_control.set_normal_brightness();
     brightness_control.enable_autobrightness();
     autobrightness_algorithm.emit_autobrightness(0.9);
+    brightness_control.flush();
 
     EXPECT_THAT(notified_brightness, Eq(0.9));
 }
@@ -529,13 +627,130 @@ TEST_F(ABacklightBrightnessControl, does_not_notify_if_brightness_does_not_chang
     brightness_control.set_normal_brightness_value(backlight.starting_brightness);
     brightness_control.enable_autobrightness();
     autobrightness_algorithm.emit_autobrightness(backlight.starting_brightness);
+    brightness_control.flush();
 
     EXPECT_THAT(notified_brightness, Eq(-1.0));
 }
 
+TEST_F(ABacklightBrightnessControl, notifies_of_transition_completion)
+{
+    double completed_brightness{-1.0};
+
+    auto const handler_registration =
+        brightness_control.register_brightness_transition_complete_handler(
+            [&](repowerd::BrightnessTransitionId, double brightness)
+            {
+                completed_brightness = brightness;
+            });
+
+    brightness_control.set_dim_brightness();
+    brightness_control.flush();
+
+    EXPECT_THAT(completed_brightness, Eq(dim_percent));
+}
+
+TEST_F(ABacklightBrightnessControl, notifies_completion_of_requests_that_do_not_change_brightness)
+{
+    double completed_brightness{-1.0};
+
+    auto const handler_registration =
+        brightness_control.register_brightness_transition_complete_handler(
+            [&](repowerd::BrightnessTransitionId, double brightness)
+            {
+                completed_brightness = brightness;
+            });
+
+    expect_brightness_value(backlight.starting_brightness);
+    auto const prev_history_size = backlight.brightness_history.size();
+
+    brightness_control.set_normal_brightness();
+    brightness_control.set_normal_brightness_value(backlight.starting_brightness);
+    brightness_control.flush();
+
+    EXPECT_THAT(completed_brightness, Eq(backlight.starting_brightness));
+    EXPECT_THAT(backlight.brightness_history.size(), Eq(prev_history_size));
+}
+
+TEST_F(ABacklightBrightnessControl, completes_once_when_in_flight_transition_is_retargeted)
+{
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+
+    std::vector<double> notified_brightness;
+    std::vector<repowerd::BrightnessTransitionId> completed_ids;
+    std::vector<double> completed_brightness;
+
+    auto const handler_registration =
+        brightness_control.register_brightness_handler(
+            [&](double brightness) { notified_brightness.push_back(brightness); });
+    auto const complete_handler_registration =
+        brightness_control.register_brightness_transition_complete_handler(
+            [&](repowerd::BrightnessTransitionId id, double brightness)
+            {
+                completed_ids.push_back(id);
+                completed_brightness.push_back(brightness);
+            });
+
+    auto release_event_loop = hold_event_loop();
+    brightness_control.set_normal_brightness();
+    brightness_control.set_normal_brightness_value(0.9);
+    auto const off_id = brightness_control.set_off_brightness();
+    release_event_loop.set_value();
+    brightness_control.flush();
+
+    EXPECT_THAT(completed_ids, ElementsAre(off_id));
+    EXPECT_THAT(completed_brightness, ElementsAre(0.0));
+    EXPECT_THAT(notified_brightness, IsEmpty());
+}
+
+TEST_F(ABacklightBrightnessControl, reports_off_transition_id_only_for_off_transitions)
+{
+    std::vector<repowerd::BrightnessTransitionId> completed_ids;
+
+    auto const handler_registration =
+        brightness_control.register_brightness_transition_complete_handler(
+            [&](repowerd::BrightnessTransitionId id, double)
+            {
+                completed_ids.push_back(id);
+            });
+
+    auto const off_id1 = brightness_control.set_off_brightness();
+    brightness_control.flush();
+    brightness_control.set_normal_brightness();
+    brightness_control.flush();
+    auto const off_id2 = brightness_control.set_off_brightness();
+    brightness_control.flush();
+
+    EXPECT_THAT(off_id1, Ne(repowerd::no_brightness_transition_id));
+    EXPECT_THAT(off_id2, Ne(off_id1));
+    EXPECT_THAT(completed_ids,
+                ElementsAre(off_id1, repowerd::no_brightness_transition_id, off_id2));
+}
+
+TEST_F(ABacklightBrightnessControl, does_not_report_off_transition_id_if_retargeted_by_other_request)
+{
+    std::vector<repowerd::BrightnessTransitionId> completed_ids;
+
+    auto const handler_registration =
+        brightness_control.register_brightness_transition_complete_handler(
+            [&](repowerd::BrightnessTransitionId id, double)
+            {
+                completed_ids.push_back(id);
+            });
+
+    auto release_event_loop = hold_event_loop();
+    brightness_control.set_off_brightness();
+    brightness_control.set_normal_brightness();
+    release_event_loop.set_value();
+    brightness_control.flush();
+
+    EXPECT_THAT(completed_ids, ElementsAre(repowerd::no_brightness_transition_id));
+}
+
 TEST_F(ABacklightBrightnessControl, logs_brightness_transition)
 {
     brightness_control.set_off_brightness();
+    brightness_control.flush();
 
     EXPECT_TRUE(fake_log.contains_line(
         {std::to_string(normal_percent).substr(0, 4), "0.00", "steps"}));
@@ -546,6 +761,7 @@ TEST_F(ABacklightBrightnessControl, logs_brightness_transition)
 TEST_F(ABacklightBrightnessControl, does_not_log_null_brightness_transition)
 {
     brightness_control.set_normal_brightness();
+    brightness_control.flush();
 
     EXPECT_FALSE(fake_log.contains_line({"steps"}));
     EXPECT_FALSE(fake_log.contains_line({"done"}));
@@ -557,6 +773,7 @@ TEST_F(ABacklightBrightnessControl, transitions_directly_to_new_value_if_current
     auto const prev_history_size = backlight.brightness_history.size();
 
     brightness_control.set_dim_brightness();
+    brightness_control.flush();
 
     EXPECT_THAT(backlight.brightness_history.size(), Eq(prev_history_size + 1));
     expect_brightness_value(dim_percent);
@@ -573,3 +790,123 @@ TEST_F(ABacklightBrightnessControl, logs_autobrightness_values)
     EXPECT_TRUE(fake_log.contains_line(
         {"autobrightness", "value", std::to_string(autobrightness_value).substr(0, 4)}));
 }
+
+TEST_F(ABacklightBrightnessControl, returns_before_transition_completes)
+{
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+
+    auto const start = std::chrono::steady_clock::now();
+    brightness_control.set_normal_brightness();
+    auto const duration = std::chrono::steady_clock::now() - start;
+
+    EXPECT_THAT(duration, Lt(100ms));
+
+    expect_brightness_value(normal_percent);
+}
+
+TEST_F(ABacklightBrightnessControl, retargets_in_flight_transition_from_its_current_value)
+{
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+    backlight.clear_brightness_history();
+
+    auto release_event_loop = hold_event_loop();
+    brightness_control.set_normal_brightness();
+    brightness_control.set_dim_brightness();
+    brightness_control.set_normal_brightness_value(0.9);
+    brightness_control.set_off_brightness();
+    release_event_loop.set_value();
+    brightness_control.flush();
+
+    auto const steps = backlight.brightness_steps();
+    EXPECT_THAT(*std::max_element(steps.begin(), steps.end()),
+                Le(0.01 + 1.0 / backlight.max_brightness));
+    expect_brightness_value(0.0);
+}
+
+TEST_F(ABacklightBrightnessControl, writes_only_distinct_absolute_values_in_transitions)
+{
+    for (auto const max_brightness : {10, 100, 255, 1023})
+    {
+        FakeBacklight fake_backlight;
+        fake_backlight.max_brightness = max_brightness;
+        FakeTimer local_fake_timer{transition_event_loop};
+
+        repowerd::BacklightBrightnessControl control{
+            rt::fake_shared(fake_backlight),
+            rt::fake_shared(light_sensor),
+            rt::fake_shared(autobrightness_algorithm),
+            rt::fake_shared(local_fake_timer),
+            rt::fake_shared(fake_log),
+            fake_device_config,
+            fake_device_quirks,
+        transition_event_loop};
+
+        control.set_off_brightness();
+        control.flush();
+        fake_backlight.clear_brightness_history();
+
+        control.set_normal_brightness();
+        control.flush();
+
+        std::vector<long> abs_values;
+        for (auto const v : fake_backlight.brightness_history)
+            abs_values.push_back(std::lround(v * max_brightness));
+
+        auto const num_writes = abs_values.size() - 1;
+        auto const num_levels = static_cast<size_t>(abs_values.back() - abs_values.front());
+
+        EXPECT_THAT(num_writes, Le(num_levels)) << "max_brightness " << max_brightness;
+        EXPECT_THAT(num_writes, Le(100u)) << "max_brightness " << max_brightness;
+        EXPECT_TRUE(std::adjacent_find(abs_values.begin(), abs_values.end(),
+                                       std::greater_equal<long>()) == abs_values.end())
+            << "max_brightness " << max_brightness;
+        EXPECT_THAT(fake_backlight.brightness_history.back(), Eq(normal_percent));
+    }
+}
+
+TEST_F(ABacklightBrightnessControl, records_transition_writes_in_trace)
+{
+    auto const trace = std::make_shared<repowerd::BrightnessTransitionTrace>(1000);
+
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+    backlight.clear_brightness_history();
+    brightness_control.set_transition_trace(trace);
+
+    brightness_control.set_normal_brightness();
+    brightness_control.flush();
+
+    auto const steps = trace->steps();
+    std::vector<double> written{backlight.brightness_history.begin() + 1,
+                                backlight.brightness_history.end()};
+    std::vector<double> traced;
+    for (auto const& step : steps)
+        traced.push_back(step.brightness);
+
+    EXPECT_THAT(traced, Eq(written));
+    for (auto const& step : steps)
+    {
+        EXPECT_THAT(step.target, Eq(normal_percent));
+        EXPECT_THAT(step.write_time, Eq(step.scheduled_time));
+        EXPECT_THAT(step.write_duration.count(), Ge(0));
+    }
+}
+
+TEST_F(ABacklightBrightnessControl, stops_recording_transition_writes_when_trace_is_unset)
+{
+    auto const trace = std::make_shared<repowerd::BrightnessTransitionTrace>(1000);
+
+    brightness_control.set_transition_trace(trace);
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+    auto const recorded = trace->total_recorded();
+
+    brightness_control.set_transition_trace(nullptr);
+    brightness_control.set_normal_brightness();
+    brightness_control.flush();
+
+    EXPECT_THAT(recorded, Gt(0u));
+    EXPECT_THAT(trace->total_recorded(), Eq(recorded));
+}
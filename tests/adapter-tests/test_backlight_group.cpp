@@ -0,0 +1,196 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/backlight_group.h"
+
+#include "fake_device_config.h"
+#include "fake_shared.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <vector>
+
+namespace rt = repowerd::test;
+using namespace testing;
+
+namespace
+{
+
+class FakeBacklight : public repowerd::Backlight
+{
+public:
+    FakeBacklight(int max_brightness)
+        : max_brightness{max_brightness}
+    {
+    }
+
+    void set_brightness(double v) override
+    {
+        brightness_history.push_back(v);
+    }
+
+    // Simulates a change made by someone else, e.g. the user
+    void set_brightness_externally(double v)
+    {
+        brightness_history.push_back(v);
+    }
+
+    double get_brightness() override
+    {
+        return brightness_history.empty() ? unknown_brightness : brightness_history.back();
+    }
+
+    int max_absolute_brightness() override
+    {
+        return max_brightness;
+    }
+
+    int const max_brightness;
+    std::vector<double> brightness_history;
+};
+
+struct ABacklightGroup : Test
+{
+    repowerd::BrightnessCurve const cie_curve{
+        repowerd::BrightnessCurve::Type::cie_lightness, 2.2};
+    repowerd::BrightnessCurve const linear_curve{
+        repowerd::BrightnessCurve::Type::linear, 2.2};
+
+    FakeBacklight panel{255};
+    FakeBacklight keyboard{100};
+    FakeBacklight keyboard_leds{3};
+
+    repowerd::BacklightGroup group{
+        rt::fake_shared(panel),
+        cie_curve,
+        {{rt::fake_shared(keyboard), linear_curve, 0.5},
+         {rt::fake_shared(keyboard_leds), cie_curve, 1.0}}};
+};
+
+}
+
+TEST_F(ABacklightGroup, writes_brightness_to_primary_unchanged)
+{
+    group.set_brightness(0.3);
+
+    EXPECT_THAT(panel.brightness_history, ElementsAre(0.3));
+}
+
+TEST_F(ABacklightGroup, writes_secondaries_in_primary_perceived_lightness_scaled_by_ratio)
+{
+    group.set_brightness(0.3);
+
+    ASSERT_THAT(keyboard.brightness_history.size(), Eq(1u));
+    EXPECT_THAT(keyboard.brightness_history.back(),
+                DoubleNear(0.5 * cie_curve.lightness_for(0.3), 1e-9));
+    ASSERT_THAT(keyboard_leds.brightness_history.size(), Eq(1u));
+    EXPECT_THAT(keyboard_leds.brightness_history.back(), DoubleNear(0.3, 1e-9));
+}
+
+TEST_F(ABacklightGroup, turns_off_all_members_for_zero_brightness)
+{
+    group.set_brightness(0.5);
+    group.set_brightness(0.0);
+
+    EXPECT_THAT(panel.brightness_history.back(), Eq(0.0));
+    EXPECT_THAT(keyboard.brightness_history.back(), Eq(0.0));
+    EXPECT_THAT(keyboard_leds.brightness_history.back(), Eq(0.0));
+}
+
+TEST_F(ABacklightGroup, writes_secondaries_only_when_their_absolute_value_changes)
+{
+    for (int i = 0; i <= 255; ++i)
+        group.set_brightness(i / 255.0);
+
+    EXPECT_THAT(panel.brightness_history.size(), Eq(256u));
+    EXPECT_THAT(keyboard.brightness_history.size(), Le(51u));
+    EXPECT_THAT(keyboard_leds.brightness_history.size(), Eq(4u));
+}
+
+TEST_F(ABacklightGroup, does_not_overwrite_secondary_changed_externally)
+{
+    group.set_brightness(0.3);
+    keyboard.set_brightness_externally(0.9);
+
+    group.set_brightness(0.6);
+    group.set_brightness(0.8);
+
+    EXPECT_THAT(keyboard.brightness_history.back(), Eq(0.9));
+    EXPECT_THAT(keyboard.brightness_history.size(), Eq(2u));
+    EXPECT_THAT(keyboard_leds.brightness_history.back(), DoubleNear(0.6, 1e-9));
+}
+
+TEST_F(ABacklightGroup, drives_externally_changed_secondary_again_after_display_turns_off)
+{
+    group.set_brightness(0.3);
+    keyboard.set_brightness_externally(0.9);
+    group.set_brightness(0.6);
+
+    group.set_brightness(0.0);
+    EXPECT_THAT(keyboard.brightness_history.back(), Eq(0.0));
+
+    group.set_brightness(0.3);
+    EXPECT_THAT(keyboard.brightness_history.back(),
+                DoubleNear(0.5 * cie_curve.lightness_for(0.3), 1e-9));
+}
+
+TEST_F(ABacklightGroup, writes_secondary_changed_externally_to_the_value_we_last_wrote)
+{
+    group.set_brightness(0.3);
+    keyboard.set_brightness_externally(0.9);
+    keyboard.set_brightness_externally(keyboard.brightness_history.front());
+
+    group.set_brightness(0.6);
+
+    EXPECT_THAT(keyboard.brightness_history.back(),
+                DoubleNear(0.5 * cie_curve.lightness_for(0.6), 1e-9));
+}
+
+TEST_F(ABacklightGroup, reports_primary_brightness_and_resolution)
+{
+    group.set_brightness(0.3);
+
+    EXPECT_THAT(group.get_brightness(), Eq(0.3));
+    EXPECT_THAT(group.max_absolute_brightness(), Eq(255));
+}
+
+TEST_F(ABacklightGroup, reads_member_curve_and_ratio_from_device_config)
+{
+    rt::FakeDeviceConfig device_config;
+    device_config.set("keyboardBacklightCurve", "linear");
+    device_config.set("keyboardBacklightRatio", "0.25");
+
+    auto const member = repowerd::BacklightGroupMember::from_device_config(
+        rt::fake_shared(keyboard), device_config, "keyboardBacklight");
+
+    EXPECT_THAT(member.backlight.get(), Eq(&keyboard));
+    EXPECT_THAT(member.curve.type, Eq(repowerd::BrightnessCurve::Type::linear));
+    EXPECT_THAT(member.ratio, Eq(0.25));
+}
+
+TEST_F(ABacklightGroup, uses_full_ratio_if_member_config_entries_are_missing)
+{
+    rt::FakeDeviceConfig device_config;
+
+    auto const member = repowerd::BacklightGroupMember::from_device_config(
+        rt::fake_shared(keyboard), device_config, "keyboardBacklight");
+
+    EXPECT_THAT(member.curve.type, Eq(repowerd::BrightnessCurve::Type::cie_lightness));
+    EXPECT_THAT(member.ratio, Eq(1.0));
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/brightness_curve.h"
+
+#include "fake_device_config.h"
+
+#include <gmock/gmock.h>
+
+#include <cmath>
+
+namespace rt = repowerd::test;
+using namespace testing;
+
+namespace
+{
+
+struct ABrightnessCurve : Test
+{
+    repowerd::BrightnessCurve curve_for(std::string const& type)
+    {
+        device_config.set("brightnessTransitionCurve", type);
+        return repowerd::BrightnessCurve::from_device_config(device_config);
+    }
+
+    rt::FakeDeviceConfig device_config;
+};
+
+}
+
+TEST_F(ABrightnessCurve, uses_cie_lightness_by_default)
+{
+    auto const curve = repowerd::BrightnessCurve::from_device_config(device_config);
+
+    EXPECT_THAT(curve.type, Eq(repowerd::BrightnessCurve::Type::cie_lightness));
+}
+
+TEST_F(ABrightnessCurve, uses_curve_from_device_config)
+{
+    device_config.set("brightnessTransitionCurveGamma", "1.8");
+
+    EXPECT_THAT(curve_for("linear").type, Eq(repowerd::BrightnessCurve::Type::linear));
+    EXPECT_THAT(curve_for("gamma").type, Eq(repowerd::BrightnessCurve::Type::gamma));
+    EXPECT_THAT(curve_for("gamma").gamma, DoubleEq(1.8));
+}
+
+TEST_F(ABrightnessCurve, falls_back_to_sensible_values_if_config_entries_are_invalid)
+{
+    device_config.set("brightnessTransitionCurveGamma", "-1");
+
+    auto const curve = curve_for("bogus");
+
+    EXPECT_THAT(curve.type, Eq(repowerd::BrightnessCurve::Type::cie_lightness));
+    EXPECT_THAT(curve.gamma, DoubleEq(2.2));
+}
+
+TEST_F(ABrightnessCurve, maps_cie_lightness)
+{
+    auto const curve = curve_for("cie");
+
+    // 18% grey has a lightness of about L* = 50
+    EXPECT_THAT(curve.lightness_for(0.18), DoubleNear(0.495, 0.001));
+    EXPECT_THAT(curve.lightness_for(0.0), DoubleEq(0.0));
+    EXPECT_THAT(curve.lightness_for(1.0), DoubleNear(1.0, 1e-9));
+}
+
+TEST_F(ABrightnessCurve, maps_gamma)
+{
+    auto const curve = curve_for("gamma");
+
+    EXPECT_THAT(curve.lightness_for(0.25), DoubleNear(std::pow(0.25, 1 / 2.2), 1e-9));
+    EXPECT_THAT(curve.brightness_for(0.5), DoubleNear(std::pow(0.5, 2.2), 1e-9));
+}
+
+TEST_F(ABrightnessCurve, maps_lightness_back_to_brightness)
+{
+    for (auto const type : {"linear", "cie", "gamma"})
+    {
+        auto const curve = curve_for(type);
+
+        for (auto b = 0.0; b <= 1.0; b += 0.001)
+        {
+            EXPECT_THAT(curve.brightness_for(curve.lightness_for(b)), DoubleNear(b, 1e-9))
+                << type << " " << b;
+        }
+    }
+}
+
+TEST_F(ABrightnessCurve, is_monotonic)
+{
+    for (auto const type : {"linear", "cie", "gamma"})
+    {
+        auto const curve = curve_for(type);
+
+        auto prev = curve.lightness_for(0.0);
+        for (auto b = 0.001; b <= 1.0; b += 0.001)
+        {
+            auto const l = curve.lightness_for(b);
+            EXPECT_THAT(l, Gt(prev)) << type << " " << b;
+            prev = l;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/brightness_transition_planner.h"
+
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct ABrightnessTransitionPlanner : Test
+{
+    repowerd::BrightnessCurve const cie_curve{
+        repowerd::BrightnessCurve::Type::cie_lightness, 2.2};
+    int const max_brightness = 255;
+
+    repowerd::BrightnessTransitionPlanner const planner{cie_curve, max_brightness};
+
+    using Speed = repowerd::BrightnessTransitionPlanner::Speed;
+};
+
+}
+
+TEST_F(ABrightnessTransitionPlanner, plans_nothing_for_null_transition)
+{
+    EXPECT_THAT(planner.plan(0.5, 0.5, Speed::normal), IsEmpty());
+}
+
+TEST_F(ABrightnessTransitionPlanner, starts_immediately_and_ends_at_exact_target)
+{
+    auto const plan = planner.plan(0.1, 0.7, Speed::normal);
+
+    ASSERT_THAT(plan, Not(IsEmpty()));
+    EXPECT_THAT(plan.front().time, Eq(0ms));
+    EXPECT_THAT(plan.back().brightness, Eq(0.7));
+}
+
+TEST_F(ABrightnessTransitionPlanner, takes_fixed_time_for_slow_transitions_and_from_to_zero)
+{
+    EXPECT_THAT(planner.plan(0.4, 0.5, Speed::slow).back().time, Eq(100ms));
+    EXPECT_THAT(planner.plan(0.0, 0.5, Speed::normal).back().time, Eq(100ms));
+    EXPECT_THAT(planner.plan(0.5, 0.0, Speed::normal).back().time, Eq(100ms));
+}
+
+TEST_F(ABrightnessTransitionPlanner, takes_time_proportional_to_lightness_change)
+{
+    auto const plan = planner.plan(0.1, 0.7, Speed::normal);
+    auto const delta_lightness =
+        cie_curve.lightness_for(0.7) - cie_curve.lightness_for(0.1);
+
+    EXPECT_THAT(plan.back().time.count(),
+                Eq(static_cast<int>(std::ceil(delta_lightness / 0.01))));
+}
+
+TEST_F(ABrightnessTransitionPlanner, steps_uniformly_in_perceived_lightness)
+{
+    auto const plan = planner.plan(0.05, 0.8, Speed::normal);
+
+    auto prev_lightness = cie_curve.lightness_for(0.05);
+    for (auto const& step : plan)
+    {
+        auto const lightness = cie_curve.lightness_for(step.brightness);
+        EXPECT_THAT(lightness - prev_lightness, AllOf(Gt(0.0), Le(0.02 + 1e-9)));
+        prev_lightness = lightness;
+    }
+}
+
+TEST_F(ABrightnessTransitionPlanner, plans_one_write_per_distinct_absolute_value_at_most)
+{
+    for (auto const max : {10, 100, 255, 1023})
+    {
+        repowerd::BrightnessTransitionPlanner const p{cie_curve, max};
+        auto const plan = p.plan(0.0, 1.0, Speed::normal);
+
+        std::vector<int> abs_values;
+        for (auto const& step : plan)
+            abs_values.push_back(p.absolute_brightness_for(step.brightness));
+
+        EXPECT_TRUE(std::adjacent_find(abs_values.begin(), abs_values.end(),
+                                       std::greater_equal<int>()) == abs_values.end())
+            << "max " << max;
+        EXPECT_THAT(plan.size(), Le(static_cast<size_t>(max))) << "max " << max;
+    }
+}
+
+TEST_F(ABrightnessTransitionPlanner, plans_at_most_one_write_per_ms)
+{
+    auto const plan = planner.plan(0.0, 1.0, Speed::normal);
+
+    for (size_t i = 1; i < plan.size(); ++i)
+        EXPECT_THAT(plan[i].time, Gt(plan[i-1].time));
+}
+
+TEST_F(ABrightnessTransitionPlanner, plans_fewer_writes_than_linear_steps_of_one_percent)
+{
+    EXPECT_THAT(planner.plan(0.0, 1.0, Speed::normal).size(), Lt(100u));
+    EXPECT_THAT(planner.plan(0.04, 0.4, Speed::normal).size(), Lt(36u));
+    EXPECT_THAT(planner.plan(0.4, 1.0, Speed::normal).size(), Lt(60u));
+}
+
+TEST_F(ABrightnessTransitionPlanner, writes_single_step_if_target_is_indistinguishable)
+{
+    auto const plan = planner.plan(0.5, 0.501, Speed::normal);
+
+    ASSERT_THAT(plan.size(), Eq(1u));
+    EXPECT_THAT(plan[0].time, Eq(0ms));
+    EXPECT_THAT(plan[0].brightness, Eq(0.501));
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/brightness_transition_trace.h"
+
+#include <gmock/gmock.h>
+
+#include <vector>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct ABrightnessTransitionTrace : Test
+{
+    repowerd::BrightnessTransitionTraceStep step_with_brightness(double brightness)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        return {1.0, brightness, now, now + 1ms, 10us};
+    }
+
+    std::vector<double> traced_brightness()
+    {
+        std::vector<double> brightness;
+        for (auto const& step : trace.steps())
+            brightness.push_back(step.brightness);
+        return brightness;
+    }
+
+    repowerd::BrightnessTransitionTrace trace{3};
+};
+
+}
+
+TEST_F(ABrightnessTransitionTrace, is_initially_empty)
+{
+    EXPECT_THAT(trace.steps(), IsEmpty());
+    EXPECT_THAT(trace.total_recorded(), Eq(0u));
+}
+
+TEST_F(ABrightnessTransitionTrace, keeps_recorded_steps_in_order)
+{
+    trace.record(step_with_brightness(0.1));
+    trace.record(step_with_brightness(0.2));
+
+    EXPECT_THAT(traced_brightness(), ElementsAre(0.1, 0.2));
+    EXPECT_THAT(trace.total_recorded(), Eq(2u));
+}
+
+TEST_F(ABrightnessTransitionTrace, keeps_step_fields)
+{
+    auto const step = step_with_brightness(0.3);
+
+    trace.record(step);
+
+    auto const steps = trace.steps();
+    ASSERT_THAT(steps.size(), Eq(1u));
+    EXPECT_THAT(steps[0].target, Eq(step.target));
+    EXPECT_THAT(steps[0].brightness, Eq(step.brightness));
+    EXPECT_THAT(steps[0].scheduled_time, Eq(step.scheduled_time));
+    EXPECT_THAT(steps[0].write_time, Eq(step.write_time));
+    EXPECT_THAT(steps[0].write_duration, Eq(step.write_duration));
+}
+
+TEST_F(ABrightnessTransitionTrace, overwrites_oldest_steps_when_full)
+{
+    for (auto const brightness : {0.1, 0.2, 0.3, 0.4, 0.5})
+        trace.record(step_with_brightness(brightness));
+
+    EXPECT_THAT(traced_brightness(), ElementsAre(0.3, 0.4, 0.5));
+    EXPECT_THAT(trace.total_recorded(), Eq(5u));
+}
+
+TEST_F(ABrightnessTransitionTrace, forgets_steps_when_cleared)
+{
+    for (auto const brightness : {0.1, 0.2, 0.3, 0.4})
+        trace.record(step_with_brightness(brightness));
+
+    trace.clear();
+    trace.record(step_with_brightness(0.5));
+
+    EXPECT_THAT(traced_brightness(), ElementsAre(0.5));
+    EXPECT_THAT(trace.total_recorded(), Eq(1u));
+}
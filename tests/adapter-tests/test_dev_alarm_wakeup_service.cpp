@@ -89,6 +89,13 @@ struct FakeDevAlarm
 
         auto const duration = seconds{ts->tv_sec} + nanoseconds{ts->tv_nsec};
         next_wakeup_tp = system_clock::time_point{duration_cast<system_clock::duration>(duration)};
+        ++alarm_set_count_;
+    }
+
+    int alarm_set_count()
+    {
+        std::lock_guard<std::mutex> lock{next_wakeup_tp_mutex};
+        return alarm_set_count_;
     }
 
     void advance_time_by(std::chrono::system_clock::duration advance)
@@ -107,6 +114,7 @@ struct FakeDevAlarm
     std::chrono::system_clock::time_point next_wakeup_tp;
     std::chrono::system_clock::time_point now;
     bool fail_on_next_alarm_set_ = false;
+    int alarm_set_count_ = 0;
 };
 
 struct ADevAlarmWakeupService : Test
@@ -114,20 +122,30 @@ struct ADevAlarmWakeupService : Test
     ADevAlarmWakeupService()
     {
         handler_registration = wakeup_service.register_wakeup_handler(
-            [this] (std::string const& cookie)
+            [this] (std::vector<std::string> const& cookies)
             {
-                wakeup_handler(cookie);
+                wakeup_handler(cookies);
             });
     }
 
-    void wakeup_handler(std::string const& cookie)
+    void wakeup_handler(std::vector<std::string> const& cookies)
     {
         std::unique_lock<std::mutex> lock{wakeup_mutex};
-        wakeup_time_points.push_back(fake_dev_alarm.system_now());
-        wakeup_cookies.push_back(cookie);
+        for (auto const& cookie : cookies)
+        {
+            wakeup_time_points.push_back(fake_dev_alarm.system_now());
+            wakeup_cookies.push_back(cookie);
+        }
+        ++wakeup_batches;
         wakeup_cv.notify_all();
     }
 
+    int wakeup_batch_count()
+    {
+        std::lock_guard<std::mutex> lock{wakeup_mutex};
+        return wakeup_batches;
+    }
+
     void wait_for_wakeups(
         std::vector<std::string> const& cookies,
         std::vector<std::chrono::system_clock::time_point> const& time_points)
@@ -149,6 +167,7 @@ struct ADevAlarmWakeupService : Test
     std::condition_variable wakeup_cv;
     std::vector<std::string> wakeup_cookies;
     std::vector<std::chrono::system_clock::time_point> wakeup_time_points;
+    int wakeup_batches = 0;
 };
 
 }
@@ -227,6 +246,44 @@ TEST_F(ADevAlarmWakeupService, cancels_one_of_many_wakeups)
     wait_for_wakeups({cookie1, cookie3}, {tp1, tp3});
 }
 
+TEST_F(ADevAlarmWakeupService, serves_wakeups_with_overlapping_windows_with_single_resume)
+{
+    auto const now = fake_dev_alarm.system_now();
+    auto const tp1 = now + 50ms;
+    auto const tp2 = now + 100ms;
+    auto const tp3 = now + 300ms;
+
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(tp1, 100ms);
+    auto const cookie2 = wakeup_service.schedule_wakeup_at(tp2, 100ms);
+    auto const cookie3 = wakeup_service.schedule_wakeup_at(tp3, 100ms);
+
+    fake_dev_alarm.advance_time_by(150ms);
+    wait_for_wakeups({cookie1, cookie2}, {now + 150ms, now + 150ms});
+    EXPECT_THAT(wakeup_batch_count(), Eq(1));
+
+    fake_dev_alarm.advance_time_by(250ms);
+    wait_for_wakeups({cookie1, cookie2, cookie3}, {now + 150ms, now + 150ms, now + 400ms});
+    EXPECT_THAT(wakeup_batch_count(), Eq(2));
+}
+
+TEST_F(ADevAlarmWakeupService, sets_dev_alarm_only_when_earliest_wakeup_changes)
+{
+    auto const now = fake_dev_alarm.system_now();
+    auto const alarm_set_count_before = fake_dev_alarm.alarm_set_count();
+
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(now + 100ms);
+    wakeup_service.schedule_wakeup_at(now + 200ms);
+    auto const cookie3 = wakeup_service.schedule_wakeup_at(now + 300ms);
+    wakeup_service.cancel_wakeup(cookie3);
+    wakeup_service.cancel_wakeup("unknown");
+
+    EXPECT_THAT(fake_dev_alarm.alarm_set_count() - alarm_set_count_before, Eq(1));
+
+    wakeup_service.cancel_wakeup(cookie1);
+
+    EXPECT_THAT(fake_dev_alarm.alarm_set_count() - alarm_set_count_before, Eq(2));
+}
+
 TEST_F(ADevAlarmWakeupService, throws_if_cannot_open_dev_alarm_at_construction)
 {
     EXPECT_THROW({
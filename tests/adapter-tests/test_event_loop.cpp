@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/event_loop.h"
+
+#include "wait_condition.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace rt = repowerd::test;
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct AnEventLoop : testing::Test
+{
+    repowerd::EventLoop event_loop;
+    std::chrono::seconds const default_timeout{3};
+};
+
+}
+
+TEST_F(AnEventLoop, runs_enqueued_and_posted_callbacks_in_order)
+{
+    std::vector<int> order;
+
+    event_loop.post([&] { order.push_back(1); });
+    event_loop.enqueue([&] { order.push_back(2); });
+    event_loop.post([&] { order.push_back(3); });
+    event_loop.enqueue([&] { order.push_back(4); }).wait();
+
+    EXPECT_THAT(order, ElementsAre(1, 2, 3, 4));
+}
+
+TEST_F(AnEventLoop, reports_exceptions_from_enqueued_callbacks)
+{
+    auto future = event_loop.enqueue([] { throw std::runtime_error{"error"}; });
+
+    EXPECT_THROW({ future.get(); }, std::runtime_error);
+}
+
+TEST_F(AnEventLoop, ignores_exceptions_from_posted_callbacks)
+{
+    event_loop.post([] { throw std::runtime_error{"error"}; });
+
+    auto const status = event_loop.enqueue([]{}).wait_for(default_timeout);
+
+    EXPECT_THAT(status, Eq(std::future_status::ready));
+}
+
+TEST_F(AnEventLoop, runs_posted_callback_after_timeout)
+{
+    rt::WaitCondition callback_called;
+
+    auto const start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point called_time;
+
+    event_loop.post_in(
+        50ms,
+        [&]
+        {
+            called_time = std::chrono::steady_clock::now();
+            callback_called.wake_up();
+        });
+
+    callback_called.wait_for(default_timeout);
+
+    EXPECT_TRUE(callback_called.woken());
+    EXPECT_THAT(called_time - start, Ge(50ms));
+}
@@ -18,11 +18,14 @@
 
 #include "src/adapters/event_loop_timer.h"
 
+#include "fake_log.h"
+#include "fake_shared.h"
 #include "wait_condition.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <future>
 #include <thread>
 
 namespace rt = repowerd::test;
@@ -35,7 +38,8 @@ namespace
 
 struct AnEventLoopTimer : testing::Test
 {
-    repowerd::EventLoopTimer timer;
+    rt::FakeLog fake_log;
+    repowerd::EventLoopTimer timer{rt::fake_shared(fake_log)};
     repowerd::HandlerRegistration const reg{
         timer.register_alarm_handler(
             [this](repowerd::AlarmId id) { alarm_handler(id); })};
@@ -133,3 +137,79 @@ TEST_F(AnEventLoopTimer, does_not_notify_for_cancelled_alarms)
 
     std::this_thread::sleep_for(250ms);
 }
+
+TEST_F(AnEventLoopTimer, reports_alarms_cancelled_after_firing_as_stale)
+{
+    auto const id1 = timer.schedule_alarm_in(10ms);
+    auto const id2 = timer.schedule_alarm_in(10ms);
+
+    rt::WaitCondition alarms_triggered;
+
+    EXPECT_CALL(*this, alarm_handler(id1));
+    EXPECT_CALL(*this, alarm_handler(id2))
+        .WillOnce(WakeUp(&alarms_triggered));
+
+    alarms_triggered.wait_for(1s);
+    EXPECT_TRUE(alarms_triggered.woken());
+
+    timer.cancel_alarm(id2);
+
+    EXPECT_TRUE(timer.consume_fired_alarm(id1));
+    EXPECT_FALSE(timer.consume_fired_alarm(id1));
+    EXPECT_FALSE(timer.consume_fired_alarm(id2));
+}
+
+TEST_F(AnEventLoopTimer, fires_alarms_with_overlapping_windows_in_a_single_wakeup)
+{
+    auto const id1 = timer.schedule_alarm_in(50ms, 100ms);
+    auto const id2 = timer.schedule_alarm_in(100ms, 100ms);
+    auto const id3 = timer.schedule_alarm_in(140ms);
+
+    rt::WaitCondition alarms_triggered;
+
+    testing::InSequence s;
+    EXPECT_CALL(*this, alarm_handler(id1));
+    EXPECT_CALL(*this, alarm_handler(id2));
+    EXPECT_CALL(*this, alarm_handler(id3))
+        .WillOnce(WakeUp(&alarms_triggered));
+
+    alarms_triggered.wait_for(1s);
+    EXPECT_TRUE(alarms_triggered.woken());
+
+    auto const stats = timer.wakeup_stats();
+    EXPECT_THAT(stats.wakeups, Eq(1u));
+    EXPECT_THAT(stats.alarms_fired, Eq(3u));
+    EXPECT_THAT(stats.wakeups_saved, Eq(2u));
+}
+
+TEST_F(AnEventLoopTimer, does_not_fire_alarms_before_their_window_starts)
+{
+    auto const id1 = timer.schedule_alarm_in(50ms);
+    auto const id2 = timer.schedule_alarm_in(150ms, 100ms);
+
+    EXPECT_CALL(*this, alarm_handler(id1));
+    EXPECT_CALL(*this, alarm_handler(id2)).Times(0);
+
+    std::this_thread::sleep_for(120ms);
+}
+
+TEST(AnEventLoopTimerWithSharedLoop, notifies_on_the_shared_loop_thread)
+{
+    auto const shared_loop = std::make_shared<repowerd::EventLoop>();
+    std::thread::id shared_loop_thread_id;
+    shared_loop->enqueue([&] { shared_loop_thread_id = std::this_thread::get_id(); }).wait();
+
+    rt::FakeLog fake_log;
+    repowerd::EventLoopTimer timer{rt::fake_shared(fake_log), shared_loop};
+
+    std::promise<std::thread::id> alarm_thread_id_promise;
+    auto alarm_thread_id = alarm_thread_id_promise.get_future();
+
+    auto const reg = timer.register_alarm_handler(
+        [&](repowerd::AlarmId) { alarm_thread_id_promise.set_value(std::this_thread::get_id()); });
+
+    timer.schedule_alarm_in(10ms);
+
+    ASSERT_THAT(alarm_thread_id.wait_for(1s), Eq(std::future_status::ready));
+    EXPECT_THAT(alarm_thread_id.get(), Eq(shared_loop_thread_id));
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/file_daemon_event_trace.h"
+#include "temporary_file.h"
+
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+struct AFileDaemonEventTrace : Test
+{
+    std::vector<repowerd::DaemonEvent> read_trace()
+    {
+        std::ifstream trace{temporary_file.name(), std::ios::binary};
+
+        repowerd::DaemonEventTraceHeader header;
+        trace.read(reinterpret_cast<char*>(&header), sizeof(header));
+        EXPECT_TRUE(trace.good());
+        EXPECT_TRUE(repowerd::is_valid_daemon_event_trace_header(header));
+
+        std::vector<repowerd::DaemonEvent> events;
+        repowerd::DaemonEventTraceRecord record;
+        while (trace.read(reinterpret_cast<char*>(&record), sizeof(record)))
+            events.push_back(repowerd::daemon_event_for(record));
+
+        return events;
+    }
+
+    rt::TemporaryFile temporary_file;
+};
+
+}
+
+TEST_F(AFileDaemonEventTrace, writes_header_to_new_trace)
+{
+    repowerd::FileDaemonEventTrace trace{temporary_file.name()};
+
+    EXPECT_THAT(read_trace(), IsEmpty());
+}
+
+TEST_F(AFileDaemonEventTrace, appends_recorded_events)
+{
+    repowerd::FileDaemonEventTrace trace{temporary_file.name()};
+
+    auto alarm = repowerd::DaemonEvent::alarm(7);
+    alarm.enqueue_time = std::chrono::steady_clock::time_point{10ms};
+    repowerd::DaemonEvent press{repowerd::DaemonEventType::power_button_press};
+    press.enqueue_time = std::chrono::steady_clock::time_point{20ms};
+
+    trace.record(alarm);
+    trace.record(press);
+    trace.flush();
+
+    auto const events = read_trace();
+
+    ASSERT_THAT(events.size(), Eq(2));
+    EXPECT_THAT(events[0].type, Eq(repowerd::DaemonEventType::alarm));
+    EXPECT_THAT(events[0].alarm_id, Eq(7));
+    EXPECT_THAT(events[0].enqueue_time, Eq(alarm.enqueue_time));
+    EXPECT_THAT(events[1].type, Eq(repowerd::DaemonEventType::power_button_press));
+    EXPECT_THAT(events[1].enqueue_time, Eq(press.enqueue_time));
+}
+
+TEST_F(AFileDaemonEventTrace, writes_buffered_events_when_destroyed)
+{
+    {
+        repowerd::FileDaemonEventTrace trace{temporary_file.name()};
+        trace.record(repowerd::DaemonEvent::alarm(7));
+        trace.record(repowerd::DaemonEvent::alarm(8));
+    }
+
+    auto const events = read_trace();
+
+    ASSERT_THAT(events.size(), Eq(2));
+    EXPECT_THAT(events[0].alarm_id, Eq(7));
+    EXPECT_THAT(events[1].alarm_id, Eq(8));
+}
+
+TEST_F(AFileDaemonEventTrace, writes_events_recorded_after_flush)
+{
+    repowerd::FileDaemonEventTrace trace{temporary_file.name()};
+
+    trace.record(repowerd::DaemonEvent::alarm(7));
+    trace.flush();
+    trace.record(repowerd::DaemonEvent::alarm(8));
+    trace.flush();
+
+    auto const events = read_trace();
+
+    ASSERT_THAT(events.size(), Eq(2));
+    EXPECT_THAT(events[0].alarm_id, Eq(7));
+    EXPECT_THAT(events[1].alarm_id, Eq(8));
+}
+
+TEST_F(AFileDaemonEventTrace, throws_if_trace_cannot_be_created)
+{
+    EXPECT_THROW({
+        repowerd::FileDaemonEventTrace trace{"/nonexistent/dir/trace"};
+    }, std::system_error);
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/mmap_request_journal.h"
+#include "temporary_file.h"
+
+#include <fstream>
+
+#include <gmock/gmock.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+struct AnMmapRequestJournal : Test
+{
+    std::unique_ptr<repowerd::MmapRequestJournal> open_journal()
+    {
+        return std::make_unique<repowerd::MmapRequestJournal>(
+            temporary_file.name(), max_records);
+    }
+
+    std::vector<uint64_t> outstanding_wakeup_cookies(repowerd::RequestJournal& journal)
+    {
+        std::vector<uint64_t> cookies;
+        for (auto const& wakeup : journal.outstanding_requests().wakeups)
+            cookies.push_back(wakeup.cookie);
+        return cookies;
+    }
+
+    void corrupt_record(size_t index)
+    {
+        size_t const record_size = 64;
+        std::fstream file{temporary_file.name(),
+                          std::ios::binary | std::ios::in | std::ios::out};
+        // The first record sized slot holds the header
+        file.seekp((index + 1) * record_size + record_size / 2);
+        file.put('X');
+    }
+
+    rt::TemporaryFile temporary_file;
+    size_t const max_records{16};
+    std::chrono::system_clock::time_point const tp{std::chrono::system_clock::from_time_t(12345)};
+};
+
+}
+
+TEST_F(AnMmapRequestJournal, restores_outstanding_wakeups_after_reopening)
+{
+    {
+        auto const journal = open_journal();
+        journal->record_wakeup_request(1, tp, 0ms);
+        journal->record_wakeup_request(2, tp + 10s, 5000ms);
+    }
+
+    auto const journal = open_journal();
+    auto const wakeups = journal->outstanding_requests().wakeups;
+
+    ASSERT_THAT(wakeups.size(), Eq(2u));
+    EXPECT_THAT(wakeups[0].cookie, Eq(1u));
+    EXPECT_THAT(wakeups[0].time, Eq(tp));
+    EXPECT_THAT(wakeups[0].tolerance, Eq(0ms));
+    EXPECT_THAT(wakeups[1].cookie, Eq(2u));
+    EXPECT_THAT(wakeups[1].time, Eq(tp + 10s));
+    EXPECT_THAT(wakeups[1].tolerance, Eq(5000ms));
+}
+
+TEST_F(AnMmapRequestJournal, restores_outstanding_sys_state_requests_after_reopening)
+{
+    {
+        auto const journal = open_journal();
+        journal->record_sys_state_request(":1.10", 3);
+        journal->record_sys_state_request(":1.11", 4);
+    }
+
+    auto const journal = open_journal();
+    auto const sys_states = journal->outstanding_requests().sys_states;
+
+    ASSERT_THAT(sys_states.size(), Eq(2u));
+    EXPECT_THAT(sys_states[0].sender, StrEq(":1.10"));
+    EXPECT_THAT(sys_states[0].id, Eq(3));
+    EXPECT_THAT(sys_states[1].sender, StrEq(":1.11"));
+    EXPECT_THAT(sys_states[1].id, Eq(4));
+}
+
+TEST_F(AnMmapRequestJournal, does_not_restore_cleared_requests)
+{
+    {
+        auto const journal = open_journal();
+        journal->record_wakeup_request(1, tp, 0ms);
+        journal->record_wakeup_request(2, tp, 0ms);
+        journal->record_sys_state_request(":1.10", 3);
+        journal->record_wakeup_clear(1);
+        journal->record_sys_state_clear(":1.10", 3);
+    }
+
+    auto const journal = open_journal();
+
+    EXPECT_THAT(outstanding_wakeup_cookies(*journal), ElementsAre(2u));
+    EXPECT_THAT(journal->outstanding_requests().sys_states, IsEmpty());
+}
+
+TEST_F(AnMmapRequestJournal, stops_replay_at_first_corrupt_record)
+{
+    {
+        auto const journal = open_journal();
+        journal->record_wakeup_request(1, tp, 0ms);
+        journal->record_wakeup_request(2, tp, 0ms);
+        journal->record_wakeup_request(3, tp, 0ms);
+    }
+
+    corrupt_record(1);
+
+    auto const journal = open_journal();
+
+    EXPECT_THAT(outstanding_wakeup_cookies(*journal), ElementsAre(1u));
+}
+
+TEST_F(AnMmapRequestJournal, starts_empty_journal_if_file_is_not_a_journal)
+{
+    temporary_file.write("not a journal");
+
+    auto const journal = open_journal();
+
+    EXPECT_THAT(journal->outstanding_requests().wakeups, IsEmpty());
+    EXPECT_THAT(journal->outstanding_requests().sys_states, IsEmpty());
+}
+
+TEST_F(AnMmapRequestJournal, compacts_journal_when_full)
+{
+    {
+        auto const journal = open_journal();
+        journal->record_wakeup_request(1000, tp, 0ms);
+
+        for (uint64_t i = 1; i < 10 * max_records; ++i)
+        {
+            journal->record_wakeup_request(i, tp, 0ms);
+            journal->record_wakeup_clear(i);
+        }
+
+        EXPECT_THAT(journal->records_in_use(), Le(max_records));
+    }
+
+    auto const journal = open_journal();
+
+    EXPECT_THAT(outstanding_wakeup_cookies(*journal), ElementsAre(1000u));
+}
+
+TEST_F(AnMmapRequestJournal, compacts_journal_when_reopened)
+{
+    {
+        auto const journal = open_journal();
+        for (uint64_t i = 1; i < max_records; ++i)
+        {
+            journal->record_wakeup_request(i, tp, 0ms);
+            if (i > 1) journal->record_wakeup_clear(i);
+        }
+    }
+
+    auto const journal = open_journal();
+
+    EXPECT_THAT(journal->records_in_use(), Eq(1u));
+}
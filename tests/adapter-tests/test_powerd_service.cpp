@@ -20,6 +20,7 @@
 #include "src/adapters/dbus_message_handle.h"
 #include "src/adapters/temporary_suspend_inhibition.h"
 #include "src/adapters/unity_screen_service.h"
+#include "src/core/daemon_statistics.h"
 
 #include "dbus_bus.h"
 #include "dbus_client.h"
@@ -36,8 +37,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <thread>
 
 using namespace testing;
 
@@ -95,6 +98,16 @@ struct PowerdDBusClient : rt::DBusClient
             g_variant_new("(st)", "test", t64));
     }
 
+    rt::DBusAsyncReplyString request_request_wakeup_with_tolerance(
+        std::chrono::system_clock::time_point tp, std::chrono::seconds tolerance)
+    {
+        auto const t64 = static_cast<uint64_t>(std::chrono::system_clock::to_time_t(tp));
+        auto const tolerance32 = static_cast<uint32_t>(tolerance.count());
+        return invoke_with_reply<rt::DBusAsyncReplyString>(
+            powerd_interface, "requestWakeupWithTolerance",
+            g_variant_new("(stu)", "test", t64, tolerance32));
+    }
+
     rt::DBusAsyncReplyVoid request_clear_wakeup(std::string const& cookie)
     {
         return invoke_with_reply<rt::DBusAsyncReplyVoid>(
@@ -108,6 +121,18 @@ struct PowerdDBusClient : rt::DBusClient
             powerd_interface, "getBrightnessParams", nullptr);
     }
 
+    rt::DBusAsyncReply request_get_event_statistics()
+    {
+        return invoke_with_reply<rt::DBusAsyncReply>(
+            powerd_interface, "getEventStatistics", nullptr);
+    }
+
+    rt::DBusAsyncReply request_get_handler_stall_count()
+    {
+        return invoke_with_reply<rt::DBusAsyncReply>(
+            powerd_interface, "getHandlerStallCount", nullptr);
+    }
+
     repowerd::HandlerRegistration register_wakeup_handler(
         std::function<void()> const& func)
     {
@@ -198,6 +223,7 @@ struct APowerdService : testing::Test
 
     rt::DBusBus bus;
     rt::FakeBrightnessNotification fake_brightness_notification;
+    repowerd::DaemonStatistics daemon_statistics;
     rt::FakeDeviceConfig fake_device_config;
     rt::FakeLog fake_log;
     rt::FakeSuspendControl fake_suspend_control;
@@ -206,6 +232,7 @@ struct APowerdService : testing::Test
     repowerd::UnityScreenService unity_screen_service{
         rt::fake_shared(fake_wakeup_service),
         rt::fake_shared(fake_brightness_notification),
+        rt::fake_shared(daemon_statistics),
         rt::fake_shared(fake_log),
         rt::fake_shared(fake_suspend_control),
         rt::fake_shared(mock_temporary_suspend_inhibition),
@@ -362,6 +389,37 @@ TEST_F(APowerdService, emits_wakeup_signal)
                 Eq(std::future_status::ready));
 }
 
+TEST_F(APowerdService, schedules_wakeup_with_tolerance)
+{
+    auto const tp = std::chrono::system_clock::from_time_t(12345);
+
+    auto const cookie =
+        client.request_request_wakeup_with_tolerance(tp, std::chrono::seconds{30}).get();
+
+    EXPECT_THAT(fake_wakeup_service.tolerance_of(cookie), Eq(std::chrono::seconds{30}));
+    EXPECT_THAT(fake_wakeup_service.emit_next_wakeup(), Eq(tp));
+}
+
+TEST_F(APowerdService, emits_single_wakeup_signal_for_batched_wakeups)
+{
+    auto const tp1 = std::chrono::system_clock::from_time_t(12345);
+    auto const tp2 = std::chrono::system_clock::from_time_t(12350);
+
+    std::atomic<int> wakeup_signals{0};
+
+    auto const reg = client.register_wakeup_handler([&] { ++wakeup_signals; });
+
+    client.request_request_wakeup_with_tolerance(tp1, std::chrono::seconds{10}).get();
+    client.request_request_wakeup_with_tolerance(tp2, std::chrono::seconds{10}).get();
+    fake_wakeup_service.emit_next_wakeup();
+
+    EXPECT_TRUE(rt::spin_wait_for_condition_or_timeout(
+        [&] { return wakeup_signals > 0; }, default_timeout));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    EXPECT_THAT(wakeup_signals.load(), Eq(1));
+}
+
 TEST_F(APowerdService, clears_wakeup)
 {
     auto const tp = std::chrono::system_clock::from_time_t(12345);
@@ -415,6 +473,68 @@ TEST_F(APowerdService, replies_to_get_brightness_params_request)
                 Eq(fake_device_config.brightness_autobrightness_supported));
 }
 
+TEST_F(APowerdService, replies_to_get_event_statistics_request)
+{
+    using namespace std::chrono_literals;
+
+    auto const type = repowerd::DaemonEventType::power_button_press;
+    daemon_statistics.record_dispatched(type);
+    daemon_statistics.record_dispatched(type);
+    daemon_statistics.record_coalesced(type);
+    daemon_statistics.record_queue_latency(type, 100us);
+    daemon_statistics.record_handler_latency(type, 5ms);
+
+    auto reply = client.request_get_event_statistics().get();
+    auto body = g_dbus_message_get_body(reply);
+
+    GVariantIter* statistics_iter;
+    g_variant_get(body, "(a(stttttttt))", &statistics_iter);
+
+    char const* name{""};
+    guint64 dispatched, coalesced;
+    guint64 queue_p50, queue_p99, queue_max;
+    guint64 handler_p50, handler_p99, handler_max;
+    size_t num_types{0};
+    bool found{false};
+
+    while (g_variant_iter_loop(
+            statistics_iter, "(&stttttttt)", &name, &dispatched, &coalesced,
+            &queue_p50, &queue_p99, &queue_max,
+            &handler_p50, &handler_p99, &handler_max))
+    {
+        ++num_types;
+        if (std::string{name} != repowerd::name_for(type))
+            continue;
+
+        found = true;
+        EXPECT_THAT(dispatched, Eq(2));
+        EXPECT_THAT(coalesced, Eq(1));
+        EXPECT_THAT(queue_p50, Eq(100));
+        EXPECT_THAT(queue_max, Eq(100));
+        EXPECT_THAT(handler_p99, Eq(5000));
+        EXPECT_THAT(handler_max, Eq(5000));
+    }
+
+    g_variant_iter_free(statistics_iter);
+
+    EXPECT_TRUE(found);
+    EXPECT_THAT(num_types, Eq(repowerd::num_daemon_event_types));
+}
+
+TEST_F(APowerdService, replies_to_get_handler_stall_count_request)
+{
+    daemon_statistics.record_stall(repowerd::DaemonEventType::alarm);
+    daemon_statistics.record_stall(repowerd::DaemonEventType::power_button_press);
+
+    auto reply = client.request_get_handler_stall_count().get();
+    auto body = g_dbus_message_get_body(reply);
+
+    guint64 count{0};
+    g_variant_get(body, "(t)", &count);
+
+    EXPECT_THAT(count, Eq(2));
+}
+
 TEST_F(APowerdService, emits_brightness_property_change)
 {
     std::promise<int32_t> brightness_promise;
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/real_timerfd_clock.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <sys/timerfd.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+std::chrono::nanoseconds time_until_expiration(int fd)
+{
+    itimerspec spec;
+    if (timerfd_gettime(fd, &spec) < 0)
+        throw std::runtime_error("Failed to get timerfd time");
+    return std::chrono::seconds{spec.it_value.tv_sec} +
+           std::chrono::nanoseconds{spec.it_value.tv_nsec};
+}
+
+MATCHER_P(IsAbout, a, "")
+{
+    return arg <= a && arg >= a - 1s;
+}
+
+}
+
+TEST(ARealTimerfdClock, arms_realtime_timerfd_for_wall_clock_time)
+{
+    repowerd::RealTimerfdClock clock{CLOCK_REALTIME};
+    auto const timer_fd = clock.create_timerfd();
+    auto const now = clock.now();
+
+    ASSERT_THAT(clock.arm_timerfd(timer_fd, now + 10s, now), Eq(0));
+
+    EXPECT_THAT(time_until_expiration(timer_fd), IsAbout(10s));
+}
+
+TEST(ARealTimerfdClock, converts_wall_clock_time_for_boottime_timerfd)
+{
+    repowerd::RealTimerfdClock clock{CLOCK_BOOTTIME};
+    auto const timer_fd = clock.create_timerfd();
+    auto const now = clock.now();
+
+    ASSERT_THAT(clock.arm_timerfd(timer_fd, now + 10s, now), Eq(0));
+
+    EXPECT_THAT(time_until_expiration(timer_fd), IsAbout(10s));
+}
+
+TEST(ARealTimerfdClock, disarms_timerfd_for_max_time_point)
+{
+    repowerd::RealTimerfdClock clock{CLOCK_BOOTTIME};
+    auto const timer_fd = clock.create_timerfd();
+    auto const now = clock.now();
+
+    ASSERT_THAT(clock.arm_timerfd(timer_fd, now + 10s, now), Eq(0));
+    ASSERT_THAT(
+        clock.arm_timerfd(timer_fd, std::chrono::system_clock::time_point::max(), now),
+        Eq(0));
+
+    EXPECT_THAT(time_until_expiration(timer_fd), Eq(0ns));
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/event_loop.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct ASharedEventLoop : testing::Test
+{
+    std::thread::id loop_thread_id(repowerd::EventLoop& loop)
+    {
+        std::thread::id id;
+        loop.enqueue([&id] { id = std::this_thread::get_id(); }).wait();
+        return id;
+    }
+
+    std::shared_ptr<repowerd::EventLoop> const shared_loop{
+        std::make_shared<repowerd::EventLoop>()};
+};
+
+}
+
+TEST_F(ASharedEventLoop, runs_callbacks_of_sharing_loops_on_shared_loop_thread)
+{
+    repowerd::EventLoop sharing_loop1{shared_loop};
+    repowerd::EventLoop sharing_loop2{shared_loop};
+
+    auto const shared_id = loop_thread_id(*shared_loop);
+
+    EXPECT_THAT(loop_thread_id(sharing_loop1), Eq(shared_id));
+    EXPECT_THAT(loop_thread_id(sharing_loop2), Eq(shared_id));
+    EXPECT_THAT(shared_id, Ne(std::this_thread::get_id()));
+}
+
+TEST_F(ASharedEventLoop, keeps_running_after_sharing_loop_is_stopped)
+{
+    {
+        repowerd::EventLoop sharing_loop{shared_loop};
+        sharing_loop.enqueue([]{}).wait();
+    }
+
+    repowerd::EventLoop other_sharing_loop{shared_loop};
+
+    auto const status1 = shared_loop->enqueue([]{}).wait_for(3s);
+    auto const status2 = other_sharing_loop.enqueue([]{}).wait_for(3s);
+
+    EXPECT_THAT(status1, Eq(std::future_status::ready));
+    EXPECT_THAT(status2, Eq(std::future_status::ready));
+}
+
+TEST_F(ASharedEventLoop, does_not_run_pending_callbacks_of_stopped_sharing_loop)
+{
+    std::atomic<bool> stopped_loop_callback_called{false};
+    std::atomic<bool> shared_loop_callback_called{false};
+
+    repowerd::EventLoop sharing_loop{shared_loop};
+    sharing_loop.schedule_in(
+        100ms, [&] { stopped_loop_callback_called = true; });
+    auto shared_loop_done = shared_loop->schedule_in(
+        100ms, [&] { shared_loop_callback_called = true; });
+
+    sharing_loop.stop();
+
+    shared_loop_done.wait_for(3s);
+    std::this_thread::sleep_for(50ms);
+
+    EXPECT_FALSE(stopped_loop_callback_called);
+    EXPECT_TRUE(shared_loop_callback_called);
+}
+
+TEST_F(ASharedEventLoop, can_be_stopped_from_its_own_enqueued_callback)
+{
+    auto sharing_loop = std::make_unique<repowerd::EventLoop>(shared_loop);
+    std::atomic<bool> later_callback_called{false};
+
+    // Hold the shared loop thread until both callbacks are queued
+    std::promise<void> queued;
+    auto queued_future = queued.get_future();
+    shared_loop->post([&] { queued_future.wait(); });
+
+    auto const done = sharing_loop->enqueue([&] { sharing_loop.reset(); });
+    sharing_loop->post([&] { later_callback_called = true; });
+    queued.set_value();
+
+    EXPECT_THAT(done.wait_for(3s), Eq(std::future_status::ready));
+    EXPECT_THAT(shared_loop->enqueue([]{}).wait_for(3s), Eq(std::future_status::ready));
+    EXPECT_FALSE(later_callback_called);
+}
+
+TEST_F(ASharedEventLoop, can_be_stopped_from_its_own_scheduled_callback)
+{
+    auto sharing_loop = std::make_unique<repowerd::EventLoop>(shared_loop);
+    std::atomic<bool> scheduled_callback_called{false};
+
+    sharing_loop->post_in(
+        10ms,
+        [&]
+        {
+            sharing_loop.reset();
+            scheduled_callback_called = true;
+        });
+
+    auto const status = shared_loop->schedule_in(100ms, []{}).wait_for(3s);
+
+    EXPECT_THAT(status, Eq(std::future_status::ready));
+    EXPECT_TRUE(scheduled_callback_called);
+    EXPECT_THAT(sharing_loop, IsNull());
+}
@@ -75,6 +75,26 @@ public:
     std::shared_ptr<std::deque<std::string>> brightness_contents;
 };
 
+class FakeSysfsKeyboardBacklight
+{
+public:
+    FakeSysfsKeyboardBacklight(
+        rt::FakeFilesystem& fake_fs,
+        std::string const& name,
+        int max_brightness)
+        : path{repowerd::Path{"/sys/class/leds"}/name}
+    {
+        brightness_contents = fake_fs.add_file_with_live_contents(path/"brightness");
+        fake_fs.add_file_with_contents(
+            path/"max_brightness",
+            std::to_string(max_brightness));
+        brightness_contents->push_back("0");
+    }
+
+    repowerd::Path const path;
+    std::shared_ptr<std::deque<std::string>> brightness_contents;
+};
+
 struct ASysfsBacklight : Test
 {
     void set_up_sysfs_backlight()
@@ -241,3 +261,45 @@ TEST_F(ASysfsBacklight, uses_raw_backlight_if_no_other_choice)
 
     EXPECT_THAT(raw->brightness_contents->size(), Gt(1));
 }
+
+TEST_F(ASysfsBacklight, keeps_brightness_file_open_across_writes)
+{
+    set_up_sysfs_backlight();
+
+    auto const backlight = create_sysfs_backlight();
+    for (int i = 0; i <= 100; ++i)
+        backlight->set_brightness(i / 100.0);
+    backlight->get_brightness();
+
+    EXPECT_THAT(fake_fs.times_opened(sysfs_backlight->path/"brightness"), Eq(1));
+    EXPECT_THAT(sysfs_backlight->brightness_contents->size(), Eq(102u));
+    expect_brightness_value(max_brightness);
+}
+
+TEST_F(ASysfsBacklight, finds_keyboard_backlight_leds)
+{
+    set_up_sysfs_led_backlight();
+    FakeSysfsKeyboardBacklight const kbd2{fake_fs, "tpacpi::kbd_backlight", 2};
+    FakeSysfsKeyboardBacklight const kbd1{fake_fs, "asus::kbd_backlight", 3};
+    FakeSysfsKeyboardBacklight const other{fake_fs, "input3::capslock", 1};
+
+    auto const dirs = repowerd::SysfsBacklight::keyboard_backlight_dirs(fake_fs);
+
+    ASSERT_THAT(dirs.size(), Eq(2u));
+    EXPECT_THAT(std::string{dirs[0]}, StrEq(kbd1.path));
+    EXPECT_THAT(std::string{dirs[1]}, StrEq(kbd2.path));
+}
+
+TEST_F(ASysfsBacklight, uses_given_sysfs_dir)
+{
+    set_up_sysfs_backlight();
+    FakeSysfsKeyboardBacklight const kbd{fake_fs, "tpacpi::kbd_backlight", 2};
+
+    repowerd::SysfsBacklight backlight{
+        rt::fake_shared(fake_log), rt::fake_shared(fake_fs), kbd.path};
+    backlight.set_brightness(0.5);
+
+    EXPECT_THAT(backlight.max_absolute_brightness(), Eq(2));
+    EXPECT_THAT(kbd.brightness_contents->back(), StrEq("1"));
+    EXPECT_THAT(sysfs_backlight->brightness_contents->size(), Eq(1u));
+}
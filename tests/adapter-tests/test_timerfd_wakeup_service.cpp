@@ -0,0 +1,322 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/real_timerfd_clock.h"
+#include "src/adapters/temporary_suspend_inhibition.h"
+#include "src/adapters/timerfd_wakeup_service.h"
+#include "src/adapters/unity_screen_service.h"
+#include "src/core/daemon_statistics.h"
+
+#include "dbus_bus.h"
+#include "dbus_client.h"
+#include "fake_brightness_notification.h"
+#include "fake_device_config.h"
+#include "fake_log.h"
+#include "fake_suspend_control.h"
+#include "fake_timerfd_clock.h"
+
+#include "fake_shared.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+char const* const powerd_service_name = "com.canonical.powerd";
+char const* const powerd_path = "/com/canonical/powerd";
+char const* const powerd_interface = "com.canonical.powerd";
+
+// The maximum acceptable latency between the requested wakeup time and
+// the emission of the wakeup signal, which is generous, since it uses the
+// real clock
+auto const max_wakeup_signal_latency = 1s;
+
+struct ATimerfdWakeupService : Test
+{
+    ATimerfdWakeupService()
+    {
+        handler_registration = wakeup_service.register_wakeup_handler(
+            [this] (std::vector<std::string> const& cookies)
+            {
+                wakeup_handler(cookies);
+            });
+    }
+
+    void wakeup_handler(std::vector<std::string> const& cookies)
+    {
+        std::lock_guard<std::mutex> lock{wakeup_mutex};
+        for (auto const& cookie : cookies)
+            wakeup_cookies.push_back(cookie);
+        ++wakeup_batches;
+        wakeup_cv.notify_all();
+    }
+
+    int wakeup_batch_count()
+    {
+        std::lock_guard<std::mutex> lock{wakeup_mutex};
+        return wakeup_batches;
+    }
+
+    void wait_for_wakeups(std::vector<std::string> const& cookies)
+    {
+        std::unique_lock<std::mutex> lock{wakeup_mutex};
+        auto const result = wakeup_cv.wait_for(
+            lock, 3s, [&] { return cookies == wakeup_cookies; });
+        if (!result)
+            throw std::runtime_error("Timeout waiting for wakeups");
+    }
+
+    std::mutex wakeup_mutex;
+    std::condition_variable wakeup_cv;
+    std::vector<std::string> wakeup_cookies;
+    int wakeup_batches = 0;
+    rt::FakeLog fake_log;
+    rt::FakeTimerfdClock fake_timerfd_clock;
+    repowerd::TimerfdWakeupService wakeup_service{
+        rt::fake_shared(fake_log), rt::fake_shared(fake_timerfd_clock)};
+    repowerd::HandlerRegistration handler_registration;
+};
+
+struct NullTemporarySuspendInhibition : repowerd::TemporarySuspendInhibition
+{
+    void inhibit_suspend_for(std::chrono::milliseconds, std::string const&) {}
+};
+
+struct PowerdWakeupDBusClient : rt::DBusClient
+{
+    PowerdWakeupDBusClient(std::string const& dbus_address)
+        : rt::DBusClient{
+            dbus_address,
+            powerd_service_name,
+            powerd_path}
+    {
+    }
+
+    rt::DBusAsyncReplyString request_request_wakeup(
+        std::chrono::system_clock::time_point tp)
+    {
+        auto const t64 = static_cast<uint64_t>(std::chrono::system_clock::to_time_t(tp));
+        return invoke_with_reply<rt::DBusAsyncReplyString>(
+            powerd_interface, "requestWakeup",
+            g_variant_new("(st)", "test", t64));
+    }
+
+    repowerd::HandlerRegistration register_wakeup_handler(
+        std::function<void()> const& func)
+    {
+        return event_loop.register_signal_handler(
+            connection,
+            nullptr,
+            powerd_interface,
+            "Wakeup",
+            powerd_path,
+            [func] (
+                GDBusConnection* /*connection*/,
+                gchar const* /*sender*/,
+                gchar const* /*object_path*/,
+                gchar const* /*interface_name*/,
+                gchar const* /*signal_name*/,
+                GVariant* /*parameters*/)
+            {
+                func();
+            });
+    }
+};
+
+struct APowerdServiceWithTimerfdWakeups : Test
+{
+    APowerdServiceWithTimerfdWakeups()
+    {
+        unity_screen_service.start_processing();
+    }
+
+    rt::DBusBus bus;
+    rt::FakeBrightnessNotification fake_brightness_notification;
+    repowerd::DaemonStatistics daemon_statistics;
+    rt::FakeDeviceConfig fake_device_config;
+    rt::FakeLog fake_log;
+    rt::FakeSuspendControl fake_suspend_control;
+    NullTemporarySuspendInhibition null_temporary_suspend_inhibition;
+    // Use the unprivileged counterpart of CLOCK_REALTIME_ALARM
+    std::shared_ptr<repowerd::TimerfdWakeupService> const wakeup_service{
+        std::make_shared<repowerd::TimerfdWakeupService>(
+            rt::fake_shared(fake_log),
+            std::make_shared<repowerd::RealTimerfdClock>(CLOCK_REALTIME))};
+    repowerd::UnityScreenService unity_screen_service{
+        wakeup_service,
+        rt::fake_shared(fake_brightness_notification),
+        rt::fake_shared(daemon_statistics),
+        rt::fake_shared(fake_log),
+        rt::fake_shared(fake_suspend_control),
+        rt::fake_shared(null_temporary_suspend_inhibition),
+        fake_device_config,
+        bus.address()};
+    PowerdWakeupDBusClient client{bus.address()};
+};
+
+}
+
+TEST_F(ATimerfdWakeupService, returns_different_cookies)
+{
+    auto const tp = fake_timerfd_clock.now() + 10s;
+
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(tp);
+    auto const cookie2 = wakeup_service.schedule_wakeup_at(tp);
+
+    EXPECT_THAT(cookie1, StrNe(""));
+    EXPECT_THAT(cookie2, StrNe(""));
+    EXPECT_THAT(cookie1, StrNe(cookie2));
+}
+
+TEST_F(ATimerfdWakeupService, delivers_wakeup_at_requested_time)
+{
+    auto const tp = fake_timerfd_clock.now() + 100ms;
+
+    auto const cookie = wakeup_service.schedule_wakeup_at(tp);
+
+    EXPECT_THAT(fake_timerfd_clock.armed_time(), Eq(tp));
+
+    fake_timerfd_clock.advance_by(100ms);
+
+    wait_for_wakeups({cookie});
+}
+
+TEST_F(ATimerfdWakeupService, does_not_deliver_wakeup_before_requested_time)
+{
+    auto const tp = fake_timerfd_clock.now() + 100ms;
+
+    wakeup_service.schedule_wakeup_at(tp);
+    fake_timerfd_clock.advance_by(99ms);
+
+    EXPECT_THAT(fake_timerfd_clock.armed_time(), Eq(tp));
+}
+
+TEST_F(ATimerfdWakeupService, schedules_multiple_wakeups_in_order)
+{
+    auto const now = fake_timerfd_clock.now();
+    auto const tp1 = now + 50ms;
+    auto const tp2 = now + 100ms;
+    auto const tp3 = now + 150ms;
+
+    auto const cookie3 = wakeup_service.schedule_wakeup_at(tp3);
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(tp1);
+    auto const cookie2 = wakeup_service.schedule_wakeup_at(tp2);
+
+    fake_timerfd_clock.advance_by(50ms);
+    wait_for_wakeups({cookie1});
+    fake_timerfd_clock.advance_by(50ms);
+    wait_for_wakeups({cookie1, cookie2});
+    fake_timerfd_clock.advance_by(50ms);
+    wait_for_wakeups({cookie1, cookie2, cookie3});
+
+    EXPECT_THAT(wakeup_batch_count(), Eq(3));
+}
+
+TEST_F(ATimerfdWakeupService, serves_wakeups_with_overlapping_windows_with_single_resume)
+{
+    auto const now = fake_timerfd_clock.now();
+    auto const tp1 = now + 50ms;
+    auto const tp2 = now + 100ms;
+
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(tp1, 100ms);
+    auto const cookie2 = wakeup_service.schedule_wakeup_at(tp2, 100ms);
+
+    EXPECT_THAT(fake_timerfd_clock.armed_time(), Eq(tp1 + 100ms));
+
+    fake_timerfd_clock.advance_by(150ms);
+    wait_for_wakeups({cookie1, cookie2});
+
+    EXPECT_THAT(wakeup_batch_count(), Eq(1));
+}
+
+TEST_F(ATimerfdWakeupService, cancels_one_of_many_wakeups)
+{
+    auto const now = fake_timerfd_clock.now();
+
+    auto const cookie1 = wakeup_service.schedule_wakeup_at(now + 50ms);
+    auto const cookie2 = wakeup_service.schedule_wakeup_at(now + 100ms);
+    auto const cookie3 = wakeup_service.schedule_wakeup_at(now + 150ms);
+    wakeup_service.cancel_wakeup(cookie1);
+    wakeup_service.cancel_wakeup(cookie2);
+
+    EXPECT_THAT(fake_timerfd_clock.armed_time(), Eq(now + 150ms));
+
+    fake_timerfd_clock.advance_by(150ms);
+    wait_for_wakeups({cookie3});
+
+    EXPECT_THAT(wakeup_batch_count(), Eq(1));
+}
+
+TEST_F(ATimerfdWakeupService, disarms_timer_when_all_wakeups_are_cancelled)
+{
+    auto const cookie = wakeup_service.schedule_wakeup_at(
+        fake_timerfd_clock.now() + 100ms);
+    wakeup_service.cancel_wakeup(cookie);
+
+    EXPECT_THAT(fake_timerfd_clock.armed_time(),
+                Eq(std::chrono::system_clock::time_point::max()));
+}
+
+TEST_F(ATimerfdWakeupService, delivers_wakeups_scheduled_in_the_past)
+{
+    auto const cookie = wakeup_service.schedule_wakeup_at(
+        std::chrono::system_clock::from_time_t(12345));
+
+    wait_for_wakeups({cookie});
+}
+
+TEST_F(ATimerfdWakeupService, logs_failure_to_arm_timer)
+{
+    fake_timerfd_clock.fail_on_next_arm();
+
+    wakeup_service.schedule_wakeup_at(fake_timerfd_clock.now() + 100ms);
+
+    EXPECT_TRUE(fake_log.contains_line({"Failed to set timerfd"}));
+}
+
+TEST_F(APowerdServiceWithTimerfdWakeups, emits_wakeup_signal_with_low_latency)
+{
+    std::promise<std::chrono::system_clock::time_point> wakeup_promise;
+    auto wakeup_future = wakeup_promise.get_future();
+
+    auto const reg = client.register_wakeup_handler(
+        [&] { wakeup_promise.set_value(std::chrono::system_clock::now()); });
+
+    // requestWakeup has a resolution of one second
+    auto const tp = std::chrono::system_clock::from_time_t(
+        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) + 1);
+
+    client.request_request_wakeup(tp).get();
+
+    ASSERT_THAT(wakeup_future.wait_for(3s), Eq(std::future_status::ready));
+
+    auto const latency = wakeup_future.get() - tp;
+    EXPECT_THAT(latency, Ge(0ms));
+    EXPECT_THAT(latency, Le(max_wakeup_signal_latency));
+}
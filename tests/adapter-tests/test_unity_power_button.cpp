@@ -160,3 +160,59 @@ TEST_F(AUnityPowerButton, emits_long_press_signal)
 
     EXPECT_THAT(future.wait_for(default_timeout), std::future_status::ready);
 }
+
+TEST_F(AUnityPowerButton, calls_handlers_when_using_shared_event_loop)
+{
+    using namespace testing;
+
+    auto const shared_event_loop = std::make_shared<repowerd::EventLoop>();
+    repowerd::UnityPowerButton shared_unity_power_button{
+        bus.address(), shared_event_loop};
+
+    rt::WaitCondition request_processed;
+    MockHandlers shared_mock_handlers;
+    auto const reg = shared_unity_power_button.register_power_button_handler(
+        [&] (repowerd::PowerButtonState state)
+        {
+            shared_mock_handlers.power_button(state);
+        });
+    shared_unity_power_button.start_processing();
+
+    EXPECT_CALL(shared_mock_handlers, power_button(repowerd::PowerButtonState::pressed))
+        .WillOnce(WakeUp(&request_processed));
+
+    client.emit_power_button_press();
+
+    request_processed.wait_for(default_timeout);
+    EXPECT_TRUE(request_processed.woken());
+}
+
+TEST_F(AUnityPowerButton, calls_handlers_when_sharing_dbus_connection)
+{
+    using namespace testing;
+
+    repowerd::DBusConnectionHandle const shared_connection{bus.address()};
+    auto destroyed_unity_power_button =
+        std::make_unique<repowerd::UnityPowerButton>(shared_connection);
+    repowerd::UnityPowerButton shared_unity_power_button{shared_connection};
+
+    destroyed_unity_power_button->start_processing();
+    destroyed_unity_power_button.reset();
+
+    rt::WaitCondition request_processed;
+    MockHandlers shared_mock_handlers;
+    auto const reg = shared_unity_power_button.register_power_button_handler(
+        [&] (repowerd::PowerButtonState state)
+        {
+            shared_mock_handlers.power_button(state);
+        });
+    shared_unity_power_button.start_processing();
+
+    EXPECT_CALL(shared_mock_handlers, power_button(repowerd::PowerButtonState::pressed))
+        .WillOnce(WakeUp(&request_processed));
+
+    client.emit_power_button_press();
+
+    request_processed.wait_for(default_timeout);
+    EXPECT_TRUE(request_processed.woken());
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/wakeup_queue.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct AWakeupQueue : testing::Test
+{
+    std::vector<repowerd::WakeupQueue::Cookie> pop_due(
+        repowerd::WakeupQueue::TimePoint now)
+    {
+        std::vector<repowerd::WakeupQueue::Cookie> due;
+        queue.pop_due(now, due);
+        return due;
+    }
+
+    std::vector<repowerd::WakeupQueue::Cookie> pop_next_batch()
+    {
+        std::vector<repowerd::WakeupQueue::Cookie> batch;
+        queue.pop_next_batch(batch);
+        return batch;
+    }
+
+    repowerd::WakeupQueue queue;
+    repowerd::WakeupQueue::TimePoint const start{std::chrono::system_clock::now()};
+};
+
+}
+
+TEST_F(AWakeupQueue, returns_different_non_zero_cookies)
+{
+    auto const cookie1 = queue.push(start);
+    auto const cookie2 = queue.push(start);
+
+    EXPECT_THAT(cookie1, Ne(0u));
+    EXPECT_THAT(cookie2, Ne(0u));
+    EXPECT_THAT(cookie1, Ne(cookie2));
+}
+
+TEST_F(AWakeupQueue, pops_wakeups_in_deadline_and_scheduling_order)
+{
+    auto const cookie1 = queue.push(start + 20ms);
+    auto const cookie2 = queue.push(start + 10ms);
+    auto const cookie3 = queue.push(start + 20ms);
+
+    EXPECT_THAT(pop_next_batch(), ElementsAre(cookie2));
+    EXPECT_THAT(pop_next_batch(), ElementsAre(cookie1, cookie3));
+    EXPECT_THAT(pop_next_batch(), IsEmpty());
+}
+
+TEST_F(AWakeupQueue, resumes_at_earliest_window_end)
+{
+    queue.push(start + 10ms, 100ms);
+    queue.push(start + 20ms, 50ms);
+    queue.push(start + 30ms, 0ms);
+
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 30ms));
+}
+
+TEST_F(AWakeupQueue, batches_wakeups_with_windows_started_by_next_resume)
+{
+    auto const cookie1 = queue.push(start + 10ms, 100ms);
+    auto const cookie2 = queue.push(start + 50ms, 100ms);
+    auto const cookie3 = queue.push(start + 120ms, 100ms);
+    auto const cookie4 = queue.push(start + 150ms, 0ms);
+
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 110ms));
+    EXPECT_THAT(pop_next_batch(), ElementsAre(cookie1, cookie2));
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 150ms));
+    EXPECT_THAT(pop_next_batch(), ElementsAre(cookie3, cookie4));
+    EXPECT_THAT(queue.size(), Eq(0u));
+}
+
+TEST_F(AWakeupQueue, ignores_cancelled_wakeups_when_picking_next_resume)
+{
+    auto const cookie1 = queue.push(start + 10ms, 10ms);
+    auto const cookie2 = queue.push(start + 15ms, 100ms);
+
+    queue.cancel(cookie1);
+
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 115ms));
+    EXPECT_THAT(pop_next_batch(), ElementsAre(cookie2));
+}
+
+TEST_F(AWakeupQueue, pops_only_due_wakeups)
+{
+    auto const cookie1 = queue.push(start + 30ms);
+    auto const cookie2 = queue.push(start + 10ms);
+    auto const cookie3 = queue.push(start + 40ms);
+
+    EXPECT_THAT(pop_due(start + 30ms), ElementsAre(cookie2, cookie1));
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 40ms));
+    EXPECT_THAT(pop_due(start + 40ms), ElementsAre(cookie3));
+    EXPECT_THAT(queue.size(), Eq(0u));
+}
+
+TEST_F(AWakeupQueue, cancels_wakeups_by_cookie)
+{
+    auto const cookie1 = queue.push(start + 10ms);
+    auto const cookie2 = queue.push(start + 20ms);
+    auto const cookie3 = queue.push(start + 30ms);
+
+    EXPECT_TRUE(queue.cancel(cookie1));
+    EXPECT_FALSE(queue.cancel(cookie1));
+    EXPECT_TRUE(queue.cancel(cookie3));
+
+    EXPECT_THAT(queue.next_deadline(), Eq(start + 20ms));
+    EXPECT_THAT(pop_due(start + 30ms), ElementsAre(cookie2));
+    EXPECT_THAT(queue.next_deadline(), Eq(repowerd::WakeupQueue::TimePoint::max()));
+}
+
+TEST_F(AWakeupQueue, keeps_order_after_many_random_cancellations)
+{
+    std::mt19937 rng{1234};
+    std::uniform_int_distribution<int> deadline_ms{0, 10000};
+
+    std::vector<std::pair<repowerd::WakeupQueue::TimePoint,repowerd::WakeupQueue::Cookie>> live;
+    std::vector<repowerd::WakeupQueue::Cookie> cancelled;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto const deadline = start + std::chrono::milliseconds{deadline_ms(rng)};
+        auto const cookie = queue.push(deadline);
+        if (i % 3 == 0)
+            cancelled.push_back(cookie);
+        else
+            live.emplace_back(deadline, cookie);
+    }
+
+    for (auto const cookie : cancelled)
+        queue.cancel(cookie);
+
+    std::sort(live.begin(), live.end());
+    std::vector<repowerd::WakeupQueue::Cookie> expected;
+    for (auto const& wakeup : live)
+        expected.push_back(wakeup.second);
+
+    EXPECT_THAT(queue.size(), Eq(expected.size()));
+    EXPECT_THAT(pop_due(start + 10s), ContainerEq(expected));
+}
+
+TEST(AWakeupCookie, is_parsed_from_string)
+{
+    EXPECT_THAT(repowerd::parse_wakeup_cookie("12345"), Eq(12345u));
+}
+
+TEST(AWakeupCookie, is_zero_when_malformed)
+{
+    EXPECT_THAT(repowerd::parse_wakeup_cookie(""), Eq(0u));
+    EXPECT_THAT(repowerd::parse_wakeup_cookie("12a"), Eq(0u));
+    EXPECT_THAT(repowerd::parse_wakeup_cookie("abc"), Eq(0u));
+}
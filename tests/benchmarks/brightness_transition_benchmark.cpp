@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/autobrightness_algorithm.h"
+#include "src/adapters/backlight_brightness_control.h"
+#include "src/adapters/brightness_transition_trace.h"
+#include "src/adapters/event_loop_timer.h"
+#include "src/adapters/light_sensor.h"
+#include "src/adapters/null_log.h"
+#include "src/adapters/path.h"
+#include "src/adapters/real_filesystem.h"
+#include "src/adapters/sysfs_backlight.h"
+
+#include "fake_device_config.h"
+#include "fake_device_quirks.h"
+#include "fake_filesystem.h"
+#include "fake_shared.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+int const num_rounds = 5;
+int const max_brightness = 255;
+
+// Regression thresholds, generous enough for a loaded machine. Steps are
+// usually a few ms apart, so later writes would make transitions stutter.
+std::chrono::microseconds const max_p99_jitter{10000};
+double const max_duration_overrun = 0.2;
+
+struct NullLightSensor : repowerd::LightSensor
+{
+    repowerd::HandlerRegistration register_light_handler(
+        repowerd::LightHandler const&) override
+    {
+        return {};
+    }
+
+    void enable_light_events() override {}
+    void disable_light_events() override {}
+};
+
+struct NullAutobrightnessAlgorithm : repowerd::AutobrightnessAlgorithm
+{
+    bool init(repowerd::EventLoop&) override { return false; }
+    void new_light_value(double) override {}
+    void start() override {}
+    void stop() override {}
+
+    repowerd::HandlerRegistration register_autobrightness_handler(
+        repowerd::AutobrightnessHandler const&) override
+    {
+        return {};
+    }
+};
+
+// Regular files keep trailing bytes when a shorter value is written over a
+// longer one, so truncate after writes to get sysfs attribute semantics
+struct SysfsLikeFilesystem : repowerd::RealFilesystem
+{
+    ssize_t pwrite(int fd, void const* buf, size_t count, off_t offset) const override
+    {
+        auto const ret = RealFilesystem::pwrite(fd, buf, count, offset);
+        if (ret >= 0 && ftruncate(fd, offset + ret) != 0)
+            return -1;
+        return ret;
+    }
+};
+
+// A directory with brightness and max_brightness files, like a
+// /sys/class/backlight device
+struct TemporarySysfsBacklightDir
+{
+    TemporarySysfsBacklightDir()
+    {
+        char tmpl[] = "/tmp/repowerd-brightness-benchmark-XXXXXX";
+        if (!mkdtemp(tmpl))
+        {
+            perror("mkdtemp");
+            exit(EXIT_FAILURE);
+        }
+        path = tmpl;
+
+        std::ofstream{path + "/brightness"} << 0;
+        std::ofstream{path + "/max_brightness"} << max_brightness;
+    }
+
+    ~TemporarySysfsBacklightDir()
+    {
+        unlink((path + "/brightness").c_str());
+        unlink((path + "/max_brightness").c_str());
+        rmdir(path.c_str());
+    }
+
+    std::string path;
+};
+
+template <typename T>
+T percentile(std::vector<T> values, double percentage)
+{
+    std::sort(values.begin(), values.end());
+    auto const index = static_cast<size_t>(percentage / 100.0 * (values.size() - 1));
+    return values[index];
+}
+
+bool benchmark(char const* name, std::shared_ptr<repowerd::Backlight> const& backlight)
+{
+    rt::FakeDeviceConfig device_config;
+    rt::FakeDeviceQuirks device_quirks;
+    NullLightSensor light_sensor;
+    NullAutobrightnessAlgorithm autobrightness_algorithm;
+    auto const trace = std::make_shared<repowerd::BrightnessTransitionTrace>(100000);
+    auto const transition_event_loop = std::make_shared<repowerd::EventLoop>();
+
+    repowerd::BacklightBrightnessControl brightness_control{
+        backlight,
+        rt::fake_shared(light_sensor),
+        rt::fake_shared(autobrightness_algorithm),
+        std::make_shared<repowerd::EventLoopTimer>(
+            std::make_shared<repowerd::NullLog>(), transition_event_loop),
+        std::make_shared<repowerd::NullLog>(),
+        device_config,
+        device_quirks,
+        transition_event_loop};
+
+    brightness_control.set_off_brightness();
+    brightness_control.flush();
+    brightness_control.set_transition_trace(trace);
+
+    std::vector<std::function<void()>> const transitions{
+        [&] { brightness_control.set_normal_brightness(); },
+        [&] { brightness_control.set_dim_brightness(); },
+        [&] { brightness_control.set_normal_brightness(); },
+        [&] { brightness_control.set_off_brightness(); }};
+
+    std::chrono::steady_clock::duration total_duration{};
+    std::chrono::steady_clock::duration planned_duration{};
+
+    for (int i = 0; i < num_rounds; ++i)
+    {
+        for (auto const& transition : transitions)
+        {
+            auto const first_step = trace->total_recorded();
+            auto const start = std::chrono::steady_clock::now();
+            transition();
+            brightness_control.flush();
+            total_duration += std::chrono::steady_clock::now() - start;
+
+            // Every transition here moves the backlight, so the last write
+            // of the trace is the last step of the plan
+            auto const steps = trace->steps();
+            if (trace->total_recorded() > first_step)
+            {
+                auto const first = steps.end() - (trace->total_recorded() - first_step);
+                planned_duration += steps.back().scheduled_time - first->scheduled_time;
+            }
+        }
+    }
+
+    auto const steps = trace->steps();
+    if (steps.empty())
+    {
+        printf("%-24s no backlight writes\n", name);
+        return false;
+    }
+
+    std::vector<std::chrono::microseconds> jitters;
+    std::vector<std::chrono::microseconds> write_durations;
+    for (auto const& step : steps)
+    {
+        jitters.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                step.write_time - step.scheduled_time));
+        write_durations.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(step.write_duration));
+    }
+
+    auto const total_s = std::chrono::duration<double>{total_duration}.count();
+    auto const planned_s = std::chrono::duration<double>{planned_duration}.count();
+    auto const overrun = planned_s > 0.0 ? total_s / planned_s - 1.0 : 0.0;
+    auto const p99_jitter = percentile(jitters, 99);
+
+    printf("%-24s %6zu writes %8.1f writes/s %7.3f s total (%+5.1f%% of plan)\n",
+           name, steps.size(), steps.size() / total_s, total_s, overrun * 100);
+    printf("%-24s step jitter us: min %5ld p50 %5ld p99 %5ld max %5ld\n",
+           "",
+           static_cast<long>(percentile(jitters, 0).count()),
+           static_cast<long>(percentile(jitters, 50).count()),
+           static_cast<long>(p99_jitter.count()),
+           static_cast<long>(percentile(jitters, 100).count()));
+    printf("%-24s write us: p50 %5ld p99 %5ld max %5ld\n",
+           "",
+           static_cast<long>(percentile(write_durations, 50).count()),
+           static_cast<long>(percentile(write_durations, 99).count()),
+           static_cast<long>(percentile(write_durations, 100).count()));
+
+    auto const passed = p99_jitter <= max_p99_jitter && overrun <= max_duration_overrun;
+    if (!passed)
+    {
+        printf("%-24s FAILED: p99 jitter must be <= %ldus and overrun <= %.0f%%\n",
+               "", static_cast<long>(max_p99_jitter.count()), max_duration_overrun * 100);
+    }
+
+    return passed;
+}
+
+}
+
+int main()
+{
+    printf("%d rounds of off => normal => dim => normal => off transitions\n",
+           num_rounds);
+
+    auto passed = true;
+
+    {
+        auto const fake_fs = std::make_shared<rt::FakeFilesystem>();
+        repowerd::Path const dir{"/sys/class/backlight/benchmark"};
+        fake_fs->add_file_with_contents(dir/"type", "raw");
+        fake_fs->add_file_with_live_contents(dir/"brightness");
+        fake_fs->add_file_with_contents(dir/"max_brightness", std::to_string(max_brightness));
+
+        auto const backlight = std::make_shared<repowerd::SysfsBacklight>(
+            std::make_shared<repowerd::NullLog>(), fake_fs, dir);
+        passed = benchmark("FakeFilesystem", backlight) && passed;
+    }
+
+    {
+        TemporarySysfsBacklightDir const dir;
+        auto const backlight = std::make_shared<repowerd::SysfsBacklight>(
+            std::make_shared<repowerd::NullLog>(),
+            std::make_shared<SysfsLikeFilesystem>(),
+            repowerd::Path{dir.path});
+        passed = benchmark("Temporary sysfs-like dir", backlight) && passed;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_config.h"
+#include "fake_user_activity.h"
+
+#include "src/core/daemon.h"
+#include "src/core/daemon_event_queue.h"
+#include "src/core/daemon_event_trace.h"
+#include "src/core/daemon_statistics.h"
+#include "src/core/state_machine.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+std::atomic<size_t> num_allocations{0};
+
+size_t const num_events = 1000000;
+size_t num_producers = 1;
+size_t events_per_producer = num_events;
+
+// The action queue used by Daemon before typed events were introduced,
+// kept here as the baseline to compare against
+class StdFunctionActionQueue
+{
+public:
+    using Action = std::function<void()>;
+
+    void push_back(Action const& action)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        actions.push_back(action);
+        cv.notify_one();
+    }
+
+    Action pop_front()
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        cv.wait(lock, [this] { return !actions.empty(); });
+        auto action = actions.front();
+        actions.pop_front();
+        return action;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Action> actions;
+};
+
+struct NullStateMachine : repowerd::StateMachine
+{
+    void handle_alarm(repowerd::AlarmId) override {}
+    void handle_active_call() override {}
+    void handle_no_active_call() override {}
+    void handle_enable_inactivity_timeout() override {}
+    void handle_disable_inactivity_timeout() override {}
+    void handle_set_inactivity_timeout(std::chrono::milliseconds) override {}
+    void handle_no_notification() override {}
+    void handle_notification() override {}
+    void handle_power_button_press() override {}
+    void handle_power_button_release() override {}
+    void handle_power_source_change() override {}
+    void handle_power_source_critical() override {}
+    void handle_proximity_far() override {}
+    void handle_proximity_near() override {}
+    void handle_turn_on_display() override {}
+    void handle_user_activity_changing_power_state() override {}
+    void handle_user_activity_extending_power_state() override { ++handled; }
+    void handle_brightness_transition_complete(repowerd::BrightnessTransitionId) override {}
+
+    size_t handled = 0;
+};
+
+struct NullDaemonEventTrace : repowerd::DaemonEventTrace
+{
+    void record(repowerd::DaemonEvent const&) override {}
+};
+
+struct DaemonConfigWithNullStateMachine : rt::DaemonConfig
+{
+    std::shared_ptr<repowerd::DaemonEventTrace> the_daemon_event_trace() override
+    {
+        return null_daemon_event_trace;
+    }
+
+    std::shared_ptr<repowerd::StateMachine> the_state_machine() override
+    {
+        return null_state_machine;
+    }
+
+    std::shared_ptr<NullDaemonEventTrace> const null_daemon_event_trace{
+        std::make_shared<NullDaemonEventTrace>()};
+    std::shared_ptr<NullStateMachine> const null_state_machine{
+        std::make_shared<NullStateMachine>()};
+};
+
+template <typename Producer>
+void run_producers(Producer const& producer)
+{
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < num_producers; ++i)
+        producers.emplace_back(producer);
+    for (auto& p : producers)
+        p.join();
+}
+
+void report(char const* name, std::chrono::steady_clock::duration duration,
+            size_t allocations)
+{
+    auto const secs = std::chrono::duration<double>{duration}.count();
+    printf("%-40s %12.0f events/s %8.2f allocations/event\n",
+           name, num_events / secs, static_cast<double>(allocations) / num_events);
+}
+
+void benchmark_std_function_action_queue()
+{
+    StdFunctionActionQueue queue;
+    size_t handled = 0;
+
+    auto const start_allocations = num_allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+
+    std::thread consumer{
+        [&]
+        {
+            while (handled < num_events)
+                queue.pop_front()();
+        }};
+
+    run_producers(
+        [&]
+        {
+            for (size_t i = 0; i < events_per_producer; ++i)
+                queue.push_back([&handled] { ++handled; });
+        });
+
+    consumer.join();
+
+    report("std::function action queue (before)",
+           std::chrono::steady_clock::now() - start,
+           num_allocations - start_allocations);
+}
+
+void benchmark_daemon_event_queue()
+{
+    repowerd::DaemonEventQueue queue;
+    size_t handled = 0;
+
+    auto const start_allocations = num_allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+
+    std::thread consumer{
+        [&]
+        {
+            repowerd::DaemonEvent event;
+            while (handled < num_events)
+            {
+                if (!queue.try_pop(repowerd::DaemonEventLane::interactive, event))
+                    queue.wait_for_events();
+                else if (event.type ==
+                         repowerd::DaemonEventType::user_activity_extending_power_state)
+                    ++handled;
+            }
+        }};
+
+    run_producers(
+        [&]
+        {
+            for (size_t i = 0; i < events_per_producer; ++i)
+            {
+                queue.push(
+                    repowerd::DaemonEventType::user_activity_extending_power_state);
+            }
+        });
+
+    consumer.join();
+
+    report("DaemonEventQueue (after)",
+           std::chrono::steady_clock::now() - start,
+           num_allocations - start_allocations);
+}
+
+void benchmark_daemon()
+{
+    DaemonConfigWithNullStateMachine config;
+    repowerd::Daemon daemon{config};
+    std::thread daemon_thread{[&] { daemon.run(); }};
+    daemon.flush();
+
+    auto const user_activity = config.the_fake_user_activity();
+
+    auto const start_allocations = num_allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+
+    run_producers(
+        [&]
+        {
+            for (size_t i = 0; i < events_per_producer; ++i)
+                user_activity->perform(repowerd::UserActivityType::extend_power_state);
+        });
+
+    daemon.flush();
+
+    report("Daemon with user activity events",
+           std::chrono::steady_clock::now() - start,
+           num_allocations - start_allocations);
+
+    daemon.stop();
+    daemon_thread.join();
+
+    auto const handled = config.null_state_machine->handled;
+    auto const coalesced = config.the_daemon_statistics()->coalesced(
+        repowerd::DaemonEventType::user_activity_extending_power_state);
+
+    printf("%-40s %12zu dispatched %8zu coalesced\n", "", handled,
+           static_cast<size_t>(coalesced));
+
+    if (handled + coalesced != num_events)
+    {
+        fprintf(stderr, "Daemon handled %zu events, expected %zu\n",
+                static_cast<size_t>(handled + coalesced), num_events);
+        exit(EXIT_FAILURE);
+    }
+}
+
+}
+
+void* operator new(size_t size)
+{
+    ++num_allocations;
+    if (auto const ptr = malloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+int main()
+{
+    for (auto const producers : {1, 4})
+    {
+        num_producers = producers;
+        events_per_producer = num_events / num_producers;
+
+        printf("%zu events from %zu producer thread(s)\n", num_events, num_producers);
+
+        benchmark_std_function_action_queue();
+        benchmark_daemon_event_queue();
+        benchmark_daemon();
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/event_loop.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+
+#include <glib.h>
+
+namespace
+{
+
+std::atomic<size_t> num_allocations{0};
+
+size_t const num_callbacks = 200000;
+
+// The per-callback idle source EventLoop::enqueue() used before callbacks
+// were batched through a single eventfd-backed source, kept here as the
+// baseline to compare against
+class IdleSourceEventLoop : public repowerd::EventLoop
+{
+public:
+    std::future<void> enqueue_with_idle_source(std::function<void()> const& callback)
+    {
+        auto const gsource = g_idle_source_new();
+        auto const ctx = new IdleSourceContext{callback};
+        g_source_set_callback(
+                gsource,
+                reinterpret_cast<GSourceFunc>(&IdleSourceContext::static_call),
+                ctx,
+                reinterpret_cast<GDestroyNotify>(&IdleSourceContext::static_destroy));
+
+        auto future = ctx->done.get_future();
+
+        g_source_attach(gsource, main_context);
+        g_source_unref(gsource);
+
+        return future;
+    }
+
+private:
+    struct IdleSourceContext
+    {
+        IdleSourceContext(std::function<void()> const& callback)
+            : callback{callback}
+        {
+        }
+
+        static gboolean static_call(IdleSourceContext* ctx)
+        {
+            ctx->callback();
+            ctx->done.set_value();
+            return G_SOURCE_REMOVE;
+        }
+
+        static void static_destroy(IdleSourceContext* ctx) { delete ctx; }
+        std::function<void()> const callback;
+        std::promise<void> done;
+    };
+};
+
+void report(char const* name, std::chrono::steady_clock::duration duration,
+            size_t allocations)
+{
+    auto const secs = std::chrono::duration<double>{duration}.count();
+    printf("%-40s %12.0f callbacks/s %8.2f allocations/callback\n",
+           name, num_callbacks / secs, static_cast<double>(allocations) / num_callbacks);
+}
+
+template <typename Enqueue>
+void benchmark(char const* name, Enqueue const& enqueue)
+{
+    size_t handled = 0;
+
+    auto const start_allocations = num_allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+
+    std::future<void> last;
+    for (size_t i = 0; i < num_callbacks; ++i)
+        last = enqueue([&handled] { ++handled; });
+    last.wait();
+
+    report(name,
+           std::chrono::steady_clock::now() - start,
+           num_allocations - start_allocations);
+
+    if (handled != num_callbacks)
+    {
+        fprintf(stderr, "%s ran %zu callbacks, expected %zu\n",
+                name, handled, num_callbacks);
+        exit(EXIT_FAILURE);
+    }
+}
+
+}
+
+// GLib allocates sources with g_malloc(), which operator new doesn't see,
+// so count allocations at the malloc level
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t nmemb, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t nmemb, size_t size)
+{
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(nmemb, size);
+}
+
+int main()
+{
+    IdleSourceEventLoop event_loop;
+    size_t posted = 0;
+
+    printf("%zu callbacks enqueued from one thread\n", num_callbacks);
+
+    benchmark(
+        "Idle GSource per callback (before)",
+        [&] (std::function<void()> const& callback)
+        {
+            return event_loop.enqueue_with_idle_source(callback);
+        });
+
+    benchmark(
+        "EventLoop::enqueue (after)",
+        [&] (std::function<void()> const& callback)
+        {
+            return event_loop.enqueue(callback);
+        });
+
+    benchmark(
+        "EventLoop::post",
+        [&] (std::function<void()> const& callback)
+        {
+            // Track only the completion of the last callback
+            if (++posted < num_callbacks)
+            {
+                event_loop.post(callback);
+                return std::future<void>{};
+            }
+            posted = 0;
+            return event_loop.enqueue(callback);
+        });
+}
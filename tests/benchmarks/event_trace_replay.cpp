@@ -0,0 +1,232 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "daemon_config.h"
+#include "fake_proximity_sensor.h"
+#include "fake_timer.h"
+
+#include "src/core/brightness_control.h"
+#include "src/core/daemon_event_trace.h"
+#include "src/core/log.h"
+#include "src/core/state_machine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rt = repowerd::test;
+
+// Replays a binary event trace recorded with REPOWERD_EVENT_TRACE into
+// DefaultStateMachine as fast as possible. Time is virtual: the FakeTimer is
+// advanced to the timestamp of each traced event, firing the alarms the state
+// machine scheduled in the meantime. Traced alarm events are not replayed,
+// since the alarms are regenerated by the virtual clock, but their number is
+// reported for comparison.
+
+namespace
+{
+
+struct NullLog : repowerd::Log
+{
+    void log(char const*, char const*, ...) override {}
+};
+
+struct ReplayDaemonConfig : rt::DaemonConfig
+{
+    std::shared_ptr<repowerd::Log> the_log() override
+    {
+        return null_log;
+    }
+
+    std::shared_ptr<NullLog> const null_log{std::make_shared<NullLog>()};
+};
+
+std::vector<repowerd::DaemonEventTraceRecord> read_trace(std::string const& path)
+{
+    std::ifstream trace{path, std::ios::binary};
+    if (!trace)
+        throw std::runtime_error{"Failed to open " + path};
+
+    repowerd::DaemonEventTraceHeader header;
+    if (!trace.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !repowerd::is_valid_daemon_event_trace_header(header))
+    {
+        throw std::runtime_error{path + " is not a valid event trace"};
+    }
+
+    // A truncated last record (e.g. if repowerd was killed while
+    // writing it) is ignored
+    std::vector<repowerd::DaemonEventTraceRecord> records;
+    repowerd::DaemonEventTraceRecord record;
+    while (trace.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        records.push_back(record);
+
+    return records;
+}
+
+class Replay
+{
+public:
+    Replay()
+        : state_machine{config.the_state_machine()},
+          brightness_control{config.the_brightness_control()},
+          fake_proximity_sensor{config.the_fake_proximity_sensor()},
+          fake_timer{config.the_fake_timer()},
+          alarm_registration{
+              fake_timer->register_alarm_handler(
+                  [this] (repowerd::AlarmId id) { fired_alarms.push_back(id); })},
+          start_time{fake_timer->now()}
+    {
+    }
+
+    void replay(std::vector<repowerd::DaemonEventTraceRecord> const& records)
+    {
+        if (records.empty()) return;
+
+        auto const first_timestamp = records.front().timestamp_ns;
+
+        for (auto const& record : records)
+        {
+            repowerd::DaemonEvent event;
+            try
+            {
+                event = repowerd::daemon_event_for(record);
+            }
+            catch (std::invalid_argument const&)
+            {
+                ++skipped_records;
+                continue;
+            }
+
+            advance_virtual_clock_to(
+                start_time + std::chrono::nanoseconds{record.timestamp_ns - first_timestamp});
+
+            if (event.type == repowerd::DaemonEventType::alarm)
+            {
+                ++traced_alarms;
+                continue;
+            }
+
+            if (event.type == repowerd::DaemonEventType::proximity_far)
+                fake_proximity_sensor->set_proximity_state(repowerd::ProximityState::far);
+            else if (event.type == repowerd::DaemonEventType::proximity_near)
+                fake_proximity_sensor->set_proximity_state(repowerd::ProximityState::near);
+
+            repowerd::dispatch_daemon_event(event, *state_machine, *brightness_control);
+            ++replayed_events;
+        }
+    }
+
+    std::chrono::steady_clock::duration virtual_time_elapsed()
+    {
+        return fake_timer->now() - start_time;
+    }
+
+    size_t replayed_events = 0;
+    size_t skipped_records = 0;
+    size_t traced_alarms = 0;
+    size_t handled_alarms = 0;
+
+private:
+    void advance_virtual_clock_to(std::chrono::steady_clock::time_point target)
+    {
+        // Advance alarm by alarm, so that alarms scheduled by alarm
+        // handlers fire at the right virtual time too
+        while (fake_timer->next_alarm_time() <= target)
+            advance_virtual_clock_by(fake_timer->next_alarm_time() - fake_timer->now());
+
+        advance_virtual_clock_by(target - fake_timer->now());
+    }
+
+    void advance_virtual_clock_by(std::chrono::steady_clock::duration duration)
+    {
+        auto const duration_ms = std::max(
+            std::chrono::milliseconds{0},
+            std::chrono::duration_cast<std::chrono::milliseconds>(duration));
+
+        fake_timer->advance_by(duration_ms);
+
+        // Alarm handlers may schedule or cancel alarms, so they can't run
+        // while FakeTimer is iterating over its alarms
+        std::vector<repowerd::AlarmId> alarms;
+        alarms.swap(fired_alarms);
+        for (auto const& id : alarms)
+        {
+            if (!fake_timer->consume_fired_alarm(id))
+                continue;
+            state_machine->handle_alarm(id);
+            ++handled_alarms;
+        }
+    }
+
+    ReplayDaemonConfig config;
+    std::shared_ptr<repowerd::StateMachine> const state_machine;
+    std::shared_ptr<repowerd::BrightnessControl> const brightness_control;
+    std::shared_ptr<rt::FakeProximitySensor> const fake_proximity_sensor;
+    std::shared_ptr<rt::FakeTimer> const fake_timer;
+    std::vector<repowerd::AlarmId> fired_alarms;
+    repowerd::HandlerRegistration const alarm_registration;
+    std::chrono::steady_clock::time_point const start_time;
+};
+
+double to_seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>{d}.count();
+}
+
+}
+
+int main(int argc, char** argv)
+try
+{
+    if (argc != 2)
+    {
+        printf("Usage: %s <event-trace-file>\n", argv[0]);
+        return 1;
+    }
+
+    auto const records = read_trace(argv[1]);
+
+    Replay replay;
+
+    auto const start = std::chrono::steady_clock::now();
+    replay.replay(records);
+    auto const wall_time = std::chrono::steady_clock::now() - start;
+
+    auto const virtual_time = replay.virtual_time_elapsed();
+    auto const events = replay.replayed_events + replay.handled_alarms;
+
+    printf("Replayed %zu events and %zu alarms in %.3f s\n",
+           replay.replayed_events, replay.handled_alarms, to_seconds(wall_time));
+    printf("%-40s %12.1f s\n", "Virtual time", to_seconds(virtual_time));
+    printf("%-40s %12.0f events/s\n", "Throughput", events / to_seconds(wall_time));
+    printf("%-40s %12.0fx\n", "Speedup", to_seconds(virtual_time) / to_seconds(wall_time));
+    printf("%-40s %12zu\n", "Alarms in trace", replay.traced_alarms);
+    printf("%-40s %12zu\n", "Skipped records", replay.skipped_records);
+
+    return 0;
+}
+catch (std::exception const& e)
+{
+    printf("Error: %s\n", e.what());
+    return 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "src/adapters/alarm_heap.h"
+#include "src/adapters/event_loop.h"
+#include "src/adapters/event_loop_timer.h"
+#include "src/adapters/null_log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+size_t const num_user_activities = 100000;
+
+// The EventLoopTimer implementation that used a GLib timeout source per
+// alarm and a blocking cancellation, kept here as the baseline to compare
+// against
+class TimeoutSourceTimer
+{
+public:
+    ~TimeoutSourceTimer()
+    {
+        event_loop.stop();
+
+        for (auto const& alarm : alarms)
+            alarm.second();
+    }
+
+    repowerd::AlarmId schedule_alarm_in(std::chrono::milliseconds t)
+    {
+        repowerd::AlarmId alarm_id;
+
+        {
+            std::lock_guard<std::mutex> lock{alarms_mutex};
+            alarm_id = next_alarm_id++;
+        }
+
+        event_loop.schedule_with_cancellation_in(
+            t,
+            [this, alarm_id] { cancel_alarm_unqueued(alarm_id); },
+            [this, alarm_id] (repowerd::EventLoopCancellation const& cancellation)
+            {
+                std::lock_guard<std::mutex> lock{alarms_mutex};
+                alarms[alarm_id] = cancellation;
+            });
+
+        return alarm_id;
+    }
+
+    void cancel_alarm(repowerd::AlarmId id)
+    {
+        event_loop.enqueue([this,id] { cancel_alarm_unqueued(id); }).get();
+    }
+
+private:
+    void cancel_alarm_unqueued(repowerd::AlarmId id)
+    {
+        std::lock_guard<std::mutex> lock{alarms_mutex};
+
+        auto const iter = alarms.find(id);
+        if (iter != alarms.end())
+        {
+            iter->second();
+            alarms.erase(iter);
+        }
+    }
+
+    repowerd::EventLoop event_loop;
+    std::mutex alarms_mutex;
+    std::unordered_map<repowerd::AlarmId,repowerd::EventLoopCancellation> alarms;
+    repowerd::AlarmId next_alarm_id{1};
+};
+
+// Each user activity cancels and reschedules the display dim and off
+// inactivity alarms, like DefaultStateMachine does
+template <typename Timer>
+void benchmark(char const* name, Timer& timer)
+{
+    auto dim_alarm = timer.schedule_alarm_in(50s);
+    auto off_alarm = timer.schedule_alarm_in(60s);
+
+    auto const start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < num_user_activities; ++i)
+    {
+        timer.cancel_alarm(dim_alarm);
+        timer.cancel_alarm(off_alarm);
+        dim_alarm = timer.schedule_alarm_in(50s);
+        off_alarm = timer.schedule_alarm_in(60s);
+    }
+
+    auto const secs = std::chrono::duration<double>{
+        std::chrono::steady_clock::now() - start}.count();
+
+    printf("%-40s %12.0f user activities/s %8.2f us/user activity\n",
+           name, num_user_activities / secs, secs * 1000000 / num_user_activities);
+}
+
+// Schedules the four DefaultStateMachine alarms a number of times with
+// nearby deadlines, and reports how many wakeups the tolerance saved
+void benchmark_coalescing(std::chrono::milliseconds tolerance)
+{
+    size_t const rounds = 10;
+
+    repowerd::EventLoopTimer timer{std::make_shared<repowerd::NullLog>()};
+    std::atomic<size_t> alarms_left{4 * rounds};
+    auto const reg = timer.register_alarm_handler(
+        [&] (repowerd::AlarmId) { --alarms_left; });
+
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        auto const base = std::chrono::milliseconds{20 * i};
+        timer.schedule_alarm_in(base + 1ms, tolerance);
+        timer.schedule_alarm_in(base + 3ms, tolerance);
+        timer.schedule_alarm_in(base + 5ms, tolerance);
+        timer.schedule_alarm_in(base + 7ms, tolerance);
+    }
+
+    while (alarms_left > 0)
+        std::this_thread::sleep_for(10ms);
+
+    auto const stats = timer.wakeup_stats();
+    printf("%3lldms tolerance: %3llu wakeups for %3llu alarms, %3llu wakeups saved\n",
+           static_cast<long long>(tolerance.count()),
+           static_cast<unsigned long long>(stats.wakeups),
+           static_cast<unsigned long long>(stats.alarms_fired),
+           static_cast<unsigned long long>(stats.wakeups_saved));
+}
+
+struct AlarmHeapOnly
+{
+    repowerd::AlarmId schedule_alarm_in(std::chrono::milliseconds t)
+    {
+        auto const id = next_alarm_id++;
+        heap.push(id, std::chrono::steady_clock::now() + t);
+        return id;
+    }
+
+    void cancel_alarm(repowerd::AlarmId id)
+    {
+        heap.cancel(id);
+    }
+
+    repowerd::AlarmHeap heap;
+    repowerd::AlarmId next_alarm_id{1};
+};
+
+}
+
+int main()
+{
+    printf("%zu user activities, each cancelling and rescheduling two alarms\n",
+           num_user_activities);
+
+    {
+        TimeoutSourceTimer timer;
+        benchmark("GLib timeout source per alarm (before)", timer);
+    }
+
+    {
+        repowerd::EventLoopTimer timer{std::make_shared<repowerd::NullLog>()};
+        benchmark("EventLoopTimer with timerfd (after)", timer);
+    }
+
+    {
+        AlarmHeapOnly timer;
+        benchmark("AlarmHeap alone", timer);
+    }
+
+    benchmark_coalescing(0ms);
+    benchmark_coalescing(10ms);
+}
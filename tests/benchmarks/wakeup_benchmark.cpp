@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/adapters/dev_alarm_wakeup_service.h"
+
+#include "fake_filesystem.h"
+#include "fake_shared.h"
+
+#include <android/linux/android_alarm.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+size_t const num_wakeups = 100000;
+size_t const num_cancellations = 10000;
+
+// A /dev/alarm that counts hardware alarm settings, and blocks waiters
+// until the alarm is cleared when the service is destroyed
+struct CountingDevAlarm
+{
+    CountingDevAlarm(rt::FakeFilesystem& fake_fs)
+    {
+        fake_fs.add_file_ioctl(
+            "/dev/alarm",
+            [this](auto, auto cmd, auto arg)
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+
+                if (cmd == ANDROID_ALARM_WAIT)
+                {
+                    cv.wait(lock, [this] { return cleared; });
+                }
+                else if (cmd == ANDROID_ALARM_SET(ANDROID_ALARM_RTC_WAKEUP))
+                {
+                    auto const ts = static_cast<timespec*>(arg);
+                    ++alarm_sets;
+                    cleared = ts->tv_sec == 0 && ts->tv_nsec == 0;
+                    cv.notify_all();
+                }
+                return 0;
+            });
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool cleared = false;
+    size_t alarm_sets = 0;
+};
+
+// The wakeup store DevAlarmWakeupService used before it was indexed by
+// deadline and cookie, kept here as the baseline to compare against
+class MultimapWakeupStore
+{
+public:
+    std::string schedule_wakeup_at(std::chrono::system_clock::time_point tp)
+    {
+        auto const cookie = std::to_string(next_cookie++);
+        wakeups.insert({tp, cookie});
+        reset_hardware_alarm();
+        return cookie;
+    }
+
+    void cancel_wakeup(std::string const& cookie)
+    {
+        for (auto iter = wakeups.begin(); iter != wakeups.end(); ++iter)
+        {
+            if (iter->second == cookie)
+            {
+                wakeups.erase(iter);
+                break;
+            }
+        }
+        reset_hardware_alarm();
+    }
+
+    size_t alarm_sets = 0;
+
+private:
+    void reset_hardware_alarm()
+    {
+        ++alarm_sets;
+    }
+
+    uint64_t next_cookie{1};
+    std::multimap<std::chrono::system_clock::time_point,std::string> wakeups;
+};
+
+template <typename WakeupService>
+void benchmark(char const* name, WakeupService& wakeup_service, size_t const& alarm_sets)
+{
+    std::mt19937 rng{1234};
+    std::uniform_int_distribution<int> deadline_s{60, 7 * 24 * 3600};
+    auto const now = std::chrono::system_clock::now();
+
+    std::vector<std::string> cookies;
+    cookies.reserve(num_wakeups);
+
+    auto const schedule_start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < num_wakeups; ++i)
+    {
+        cookies.push_back(
+            wakeup_service.schedule_wakeup_at(now + std::chrono::seconds{deadline_s(rng)}));
+    }
+
+    auto const cancel_start = std::chrono::steady_clock::now();
+
+    std::shuffle(cookies.begin(), cookies.end(), rng);
+    for (size_t i = 0; i < num_cancellations; ++i)
+        wakeup_service.cancel_wakeup(cookies[i]);
+
+    auto const end = std::chrono::steady_clock::now();
+
+    auto const schedule_us = std::chrono::duration<double,std::micro>{
+        cancel_start - schedule_start}.count();
+    auto const cancel_us = std::chrono::duration<double,std::micro>{
+        end - cancel_start}.count();
+
+    printf("%-40s %8.3f us/schedule %10.3f us/cancel %8zu alarm sets\n",
+           name, schedule_us / num_wakeups, cancel_us / num_cancellations, alarm_sets);
+}
+
+}
+
+int main()
+{
+    printf("%zu scheduled wakeups, %zu cancellations in random order\n",
+           num_wakeups, num_cancellations);
+
+    {
+        MultimapWakeupStore wakeup_service;
+        benchmark("Multimap with string cookies (before)", wakeup_service,
+                  wakeup_service.alarm_sets);
+    }
+
+    {
+        rt::FakeFilesystem fake_fs;
+        CountingDevAlarm dev_alarm{fake_fs};
+        repowerd::DevAlarmWakeupService wakeup_service{rt::fake_shared(fake_fs)};
+        // Only count the alarm sets caused by the benchmark itself. The
+        // wakeup thread stays blocked in ANDROID_ALARM_WAIT meanwhile.
+        dev_alarm.alarm_sets = 0;
+        benchmark("DevAlarmWakeupService (after)", wakeup_service,
+                  dev_alarm.alarm_sets);
+    }
+}
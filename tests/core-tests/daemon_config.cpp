@@ -17,10 +17,13 @@
  */
 
 #include "daemon_config.h"
+#include "src/core/daemon_statistics.h"
 #include "src/core/default_state_machine.h"
+#include "src/core/infinite_timeout.h"
 
 #include "mock_brightness_control.h"
 #include "fake_client_requests.h"
+#include "fake_daemon_event_trace.h"
 #include "mock_display_power_control.h"
 #include "mock_display_power_event_sink.h"
 #include "fake_log.h"
@@ -51,6 +54,18 @@ std::shared_ptr<repowerd::ClientRequests> rt::DaemonConfig::the_client_requests(
     return the_fake_client_requests();
 }
 
+std::shared_ptr<repowerd::DaemonEventTrace> rt::DaemonConfig::the_daemon_event_trace()
+{
+    return the_fake_daemon_event_trace();
+}
+
+std::shared_ptr<repowerd::DaemonStatistics> rt::DaemonConfig::the_daemon_statistics()
+{
+    if (!daemon_statistics)
+        daemon_statistics = std::make_shared<DaemonStatistics>();
+    return daemon_statistics;
+}
+
 std::shared_ptr<repowerd::DisplayPowerControl> rt::DaemonConfig::the_display_power_control()
 {
     return the_mock_display_power_control();
@@ -133,6 +148,12 @@ std::shared_ptr<repowerd::VoiceCallService> rt::DaemonConfig::the_voice_call_ser
     return the_fake_voice_call_service();
 }
 
+std::chrono::milliseconds
+rt::DaemonConfig::handler_stall_budget()
+{
+    return repowerd::infinite_timeout;
+}
+
 std::chrono::milliseconds
 rt::DaemonConfig::notification_expiration_timeout()
 {
@@ -191,6 +212,14 @@ std::shared_ptr<rt::FakeClientRequests> rt::DaemonConfig::the_fake_client_reques
     return fake_client_requests;
 }
 
+std::shared_ptr<rt::FakeDaemonEventTrace> rt::DaemonConfig::the_fake_daemon_event_trace()
+{
+    if (!fake_daemon_event_trace)
+        fake_daemon_event_trace = std::make_shared<rt::FakeDaemonEventTrace>();
+
+    return fake_daemon_event_trace;
+}
+
 std::shared_ptr<NiceMock<rt::MockDisplayPowerControl>>
 rt::DaemonConfig::the_mock_display_power_control()
 {
@@ -29,6 +29,7 @@ namespace test
 
 class MockBrightnessControl;
 class FakeClientRequests;
+class FakeDaemonEventTrace;
 class MockDisplayPowerControl;
 class MockDisplayPowerEventSink;
 class FakeLog;
@@ -50,6 +51,8 @@ class DaemonConfig : public repowerd::DaemonConfig
 public:
     std::shared_ptr<BrightnessControl> the_brightness_control() override;
     std::shared_ptr<ClientRequests> the_client_requests() override;
+    std::shared_ptr<DaemonEventTrace> the_daemon_event_trace() override;
+    std::shared_ptr<DaemonStatistics> the_daemon_statistics() override;
     std::shared_ptr<DisplayPowerControl> the_display_power_control() override;
     std::shared_ptr<DisplayPowerEventSink> the_display_power_event_sink() override;
     std::shared_ptr<Log> the_log() override;
@@ -67,6 +70,7 @@ public:
     std::shared_ptr<UserActivity> the_user_activity() override;
     std::shared_ptr<VoiceCallService> the_voice_call_service() override;
 
+    std::chrono::milliseconds handler_stall_budget() override;
     std::chrono::milliseconds notification_expiration_timeout() override;
     std::chrono::milliseconds power_button_long_press_timeout() override;
     std::chrono::milliseconds user_inactivity_normal_display_dim_duration() override;
@@ -78,6 +82,7 @@ public:
 
     std::shared_ptr<testing::NiceMock<MockBrightnessControl>> the_mock_brightness_control();
     std::shared_ptr<FakeClientRequests> the_fake_client_requests();
+    std::shared_ptr<FakeDaemonEventTrace> the_fake_daemon_event_trace();
     std::shared_ptr<testing::NiceMock<MockDisplayPowerControl>> the_mock_display_power_control();
     std::shared_ptr<testing::NiceMock<MockDisplayPowerEventSink>> the_mock_display_power_event_sink();
     std::shared_ptr<FakeLog> the_fake_log();
@@ -96,9 +101,11 @@ public:
 
 private:
     std::shared_ptr<StateMachine> state_machine;
+    std::shared_ptr<DaemonStatistics> daemon_statistics;
 
     std::shared_ptr<testing::NiceMock<MockBrightnessControl>> mock_brightness_control;
     std::shared_ptr<FakeClientRequests> fake_client_requests;
+    std::shared_ptr<FakeDaemonEventTrace> fake_daemon_event_trace;
     std::shared_ptr<testing::NiceMock<MockDisplayPowerControl>> mock_display_power_control;
     std::shared_ptr<testing::NiceMock<MockDisplayPowerEventSink>> mock_display_power_event_sink;
     std::shared_ptr<FakeLog> fake_log;
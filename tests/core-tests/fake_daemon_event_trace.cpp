@@ -0,0 +1,33 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "fake_daemon_event_trace.h"
+
+namespace rt = repowerd::test;
+
+void rt::FakeDaemonEventTrace::record(DaemonEvent const& event)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    events.push_back(event);
+}
+
+std::vector<repowerd::DaemonEvent> rt::FakeDaemonEventTrace::recorded_events()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    return events;
+}
@@ -48,6 +48,12 @@ repowerd::AlarmId rt::FakeTimer::schedule_alarm_in(std::chrono::milliseconds t)
     return next_alarm_id++;
 }
 
+repowerd::AlarmId rt::FakeTimer::schedule_alarm_in(
+    std::chrono::milliseconds t, std::chrono::milliseconds)
+{
+    return schedule_alarm_in(t);
+}
+
 void rt::FakeTimer::cancel_alarm(AlarmId id)
 {
     alarms.erase(
@@ -56,6 +62,21 @@ void rt::FakeTimer::cancel_alarm(AlarmId id)
             alarms.end(),
             [id](auto const& alarm) { return alarm.id == id; }),
         alarms.end());
+
+    auto const fired = fired_alarms.find(id);
+    if (fired != fired_alarms.end())
+        fired->second = true;
+}
+
+bool rt::FakeTimer::consume_fired_alarm(AlarmId id)
+{
+    auto const fired = fired_alarms.find(id);
+    if (fired == fired_alarms.end())
+        return false;
+
+    auto const cancelled = fired->second;
+    fired_alarms.erase(fired);
+    return !cancelled;
 }
 
 std::chrono::steady_clock::time_point rt::FakeTimer::now()
@@ -70,7 +91,10 @@ void rt::FakeTimer::advance_by(std::chrono::milliseconds advance)
     for (auto const& alarm : alarms)
     {
         if (now_ms >= alarm.time)
+        {
+            fired_alarms[alarm.id] = false;
             handler(alarm.id);
+        }
     }
 
     alarms.erase(
@@ -80,3 +104,16 @@ void rt::FakeTimer::advance_by(std::chrono::milliseconds advance)
             [this](auto const& alarm) { return now_ms >= alarm.time; }),
         alarms.end());
 }
+
+std::chrono::steady_clock::time_point rt::FakeTimer::next_alarm_time()
+{
+    auto const next = std::min_element(
+        alarms.begin(),
+        alarms.end(),
+        [](auto const& a, auto const& b) { return a.time < b.time; });
+
+    if (next == alarms.end())
+        return std::chrono::steady_clock::time_point::max();
+
+    return std::chrono::steady_clock::time_point{next->time};
+}
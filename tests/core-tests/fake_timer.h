@@ -22,6 +22,7 @@
 
 #include <gmock/gmock.h>
 
+#include <unordered_map>
 #include <vector>
 
 namespace repowerd
@@ -36,10 +37,16 @@ public:
 
     HandlerRegistration register_alarm_handler(AlarmHandler const& handler) override;
     AlarmId schedule_alarm_in(std::chrono::milliseconds t) override;
+    // Alarms fire as soon as their window starts
+    AlarmId schedule_alarm_in(
+        std::chrono::milliseconds t, std::chrono::milliseconds tolerance) override;
     void cancel_alarm(AlarmId id) override;
+    bool consume_fired_alarm(AlarmId id) override;
     std::chrono::steady_clock::time_point now() override;
 
     void advance_by(std::chrono::milliseconds advance);
+    // Returns time_point::max() if no alarm is scheduled
+    std::chrono::steady_clock::time_point next_alarm_time();
 
     struct Mock
     {
@@ -59,6 +66,8 @@ private:
     AlarmId next_alarm_id;
     std::chrono::milliseconds now_ms;
     std::vector<Alarm> alarms;
+    // Fired alarms not consumed yet, and whether they have been cancelled
+    std::unordered_map<AlarmId,bool> fired_alarms;
 };
 
 }
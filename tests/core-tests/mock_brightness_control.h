@@ -30,12 +30,55 @@ namespace test
 class MockBrightnessControl : public BrightnessControl
 {
 public:
+    // By default, transitions complete as soon as they are requested
+    MockBrightnessControl()
+    {
+        ON_CALL(*this, set_dim_brightness())
+            .WillByDefault(testing::Invoke(
+                [this] { complete_transition(no_brightness_transition_id, dim_brightness); }));
+        ON_CALL(*this, set_normal_brightness())
+            .WillByDefault(testing::Invoke(
+                [this] { complete_transition(no_brightness_transition_id, normal_brightness); }));
+        ON_CALL(*this, set_off_brightness())
+            .WillByDefault(testing::Invoke(
+                [this]
+                {
+                    auto const id = next_off_transition_id();
+                    complete_transition(id, 0.0);
+                    return id;
+                }));
+    }
+
     MOCK_METHOD0(disable_autobrightness, void());
     MOCK_METHOD0(enable_autobrightness, void());
     MOCK_METHOD0(set_dim_brightness, void());
     MOCK_METHOD0(set_normal_brightness, void());
     MOCK_METHOD1(set_normal_brightness_value, void(double));
-    MOCK_METHOD0(set_off_brightness, void());
+    MOCK_METHOD0(set_off_brightness, BrightnessTransitionId());
+
+    HandlerRegistration register_brightness_transition_complete_handler(
+        BrightnessTransitionCompleteHandler const& handler) override
+    {
+        transition_complete_handler = handler;
+        return HandlerRegistration{[this] { transition_complete_handler = [](auto...){}; }};
+    }
+
+    void complete_transition(BrightnessTransitionId id, double brightness)
+    {
+        transition_complete_handler(id, brightness);
+    }
+
+    BrightnessTransitionId next_off_transition_id()
+    {
+        return ++last_off_transition_id;
+    }
+
+    double const dim_brightness = 0.1;
+    double const normal_brightness = 0.5;
+
+private:
+    BrightnessTransitionCompleteHandler transition_complete_handler{[](auto...){}};
+    BrightnessTransitionId last_off_transition_id{no_brightness_transition_id};
 };
 
 }
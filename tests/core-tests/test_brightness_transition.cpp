@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+#include "acceptance_test.h"
+#include "fake_suspend_control.h"
+#include "mock_brightness_control.h"
+#include "mock_display_power_control.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace rt = repowerd::test;
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct ABrightnessTransition : rt::AcceptanceTest
+{
+    ABrightnessTransition()
+    {
+        turn_on_display();
+    }
+
+    // Off transitions complete only when complete_transition() is called
+    repowerd::BrightnessTransitionId start_off_transition()
+    {
+        auto const brightness_control = config.the_mock_brightness_control();
+        auto const id = brightness_control->next_off_transition_id();
+
+        ON_CALL(*brightness_control, set_off_brightness())
+            .WillByDefault(Return(id));
+        EXPECT_CALL(*brightness_control, set_off_brightness());
+        press_power_button();
+        release_power_button();
+        daemon.flush();
+
+        return id;
+    }
+
+    void complete_transition(repowerd::BrightnessTransitionId id, double brightness)
+    {
+        config.the_mock_brightness_control()->complete_transition(id, brightness);
+        daemon.flush();
+    }
+
+    void expect_no_display_power_off()
+    {
+        EXPECT_CALL(*config.the_mock_display_power_control(), turn_off()).Times(0);
+    }
+
+    void expect_display_power_off()
+    {
+        EXPECT_CALL(*config.the_mock_display_power_control(), turn_off());
+    }
+
+    bool is_suspend_allowed()
+    {
+        return config.the_fake_suspend_control()->is_suspend_allowed();
+    }
+};
+
+}
+
+TEST_F(ABrightnessTransition, to_off_overlaps_with_display_power_off_notification)
+{
+    expect_display_power_off_notification(repowerd::DisplayPowerChangeReason::power_button);
+    expect_no_display_power_off();
+
+    start_off_transition();
+}
+
+TEST_F(ABrightnessTransition, to_off_turns_off_display_power_when_complete)
+{
+    auto const id = start_off_transition();
+    verify_expectations();
+
+    expect_display_power_off();
+
+    complete_transition(id, 0.0);
+}
+
+TEST_F(ABrightnessTransition, to_off_allows_suspend_only_when_complete)
+{
+    auto const id = start_off_transition();
+
+    EXPECT_FALSE(is_suspend_allowed());
+
+    complete_transition(id, 0.0);
+
+    EXPECT_TRUE(is_suspend_allowed());
+}
+
+TEST_F(ABrightnessTransition, completion_at_normal_brightness_after_off_does_not_turn_off_display_power)
+{
+    start_off_transition();
+    verify_expectations();
+
+    expect_no_display_power_off();
+
+    complete_transition(
+        repowerd::no_brightness_transition_id,
+        config.the_mock_brightness_control()->normal_brightness);
+}
+
+TEST_F(ABrightnessTransition, to_off_turns_off_display_power_if_it_does_not_complete_in_time)
+{
+    start_off_transition();
+    verify_expectations();
+
+    expect_display_power_off();
+
+    advance_time_by(1000ms);
+
+    EXPECT_TRUE(is_suspend_allowed());
+}
+
+TEST_F(ABrightnessTransition, to_off_turns_off_display_power_only_once_if_completed_in_time)
+{
+    auto const id = start_off_transition();
+    verify_expectations();
+
+    expect_display_power_off();
+
+    complete_transition(id, 0.0);
+    advance_time_by(1000ms);
+}
+
+TEST_F(ABrightnessTransition, to_off_does_not_turn_off_display_power_if_display_turned_back_on)
+{
+    auto const id = start_off_transition();
+    turn_on_display();
+
+    expect_no_display_power_off();
+
+    complete_transition(id, 0.0);
+    advance_time_by(1000ms);
+
+    EXPECT_FALSE(is_suspend_allowed());
+}
+
+TEST_F(ABrightnessTransition, completion_of_earlier_off_transition_does_not_turn_off_display_power)
+{
+    auto const earlier_id = start_off_transition();
+    turn_on_display();
+    auto const id = start_off_transition();
+    verify_expectations();
+
+    expect_no_display_power_off();
+
+    complete_transition(earlier_id, 0.0);
+
+    EXPECT_FALSE(is_suspend_allowed());
+    verify_expectations();
+
+    expect_display_power_off();
+
+    complete_transition(id, 0.0);
+
+    EXPECT_TRUE(is_suspend_allowed());
+}
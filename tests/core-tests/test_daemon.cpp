@@ -18,6 +18,8 @@
 
 #include "daemon_config.h"
 #include "fake_client_requests.h"
+#include "fake_daemon_event_trace.h"
+#include "fake_log.h"
 #include "fake_notification_service.h"
 #include "fake_power_button.h"
 #include "fake_power_source.h"
@@ -28,9 +30,14 @@
 #include "mock_brightness_control.h"
 
 #include "src/core/daemon.h"
+#include "src/core/daemon_statistics.h"
 #include "src/core/state_machine.h"
 
+#include <algorithm>
+#include <future>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -68,6 +75,8 @@ struct MockStateMachine : public repowerd::StateMachine
 
     MOCK_METHOD0(handle_user_activity_extending_power_state, void());
     MOCK_METHOD0(handle_user_activity_changing_power_state, void());
+
+    MOCK_METHOD1(handle_brightness_transition_complete, void(repowerd::BrightnessTransitionId));
 };
 
 struct DaemonConfigWithMockStateMachine : rt::DaemonConfig
@@ -117,6 +126,30 @@ struct ADaemon : testing::Test
         daemon->stop();
         daemon_thread.join();
     }
+
+    template <typename EmitEvents>
+    void emit_events_while_daemon_is_busy(EmitEvents const& emit_events)
+    {
+        using namespace testing;
+
+        std::promise<void> handler_blocked;
+        std::promise<void> unblock_handler;
+
+        EXPECT_CALL(*config.the_mock_state_machine(), handle_alarm(_))
+            .WillOnce(InvokeWithoutArgs(
+                [&]
+                {
+                    handler_blocked.set_value();
+                    unblock_handler.get_future().wait();
+                }));
+
+        config.the_fake_timer()->schedule_alarm_in(0ms);
+        config.the_fake_timer()->advance_by(0ms);
+        handler_blocked.get_future().wait();
+        emit_events();
+        unblock_handler.set_value();
+        daemon->flush();
+    }
 };
 
 }
@@ -145,6 +178,21 @@ TEST_F(ADaemon, notifies_state_machine_of_timer_alarm)
     config.the_fake_timer()->advance_by(1s);
 }
 
+TEST_F(ADaemon, does_not_notify_state_machine_of_alarms_cancelled_after_firing)
+{
+    start_daemon();
+
+    auto const alarm_id = config.the_fake_timer()->schedule_alarm_in(1s);
+
+    // Only the alarm that keeps the daemon busy is expected to be handled
+    emit_events_while_daemon_is_busy(
+        [&]
+        {
+            config.the_fake_timer()->advance_by(1s);
+            config.the_fake_timer()->cancel_alarm(alarm_id);
+        });
+}
+
 TEST_F(ADaemon, registers_starts_and_unregisters_power_button_handler)
 {
     using namespace testing;
@@ -554,3 +602,499 @@ TEST_F(ADaemon, notifies_state_machine_of_power_source_critical)
 
     config.the_fake_power_source()->emit_power_source_critical();
 }
+
+TEST_F(ADaemon, notifies_state_machine_of_brightness_transition_complete)
+{
+    start_daemon();
+
+    repowerd::BrightnessTransitionId const id{7};
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_brightness_transition_complete(id));
+
+    config.the_mock_brightness_control()->complete_transition(id, 0.0);
+}
+
+TEST_F(ADaemon, handles_brightness_transition_completed_from_within_a_request)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs(
+            [this] { config.the_mock_brightness_control()->set_off_brightness(); }));
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_brightness_transition_complete(Ne(repowerd::no_brightness_transition_id)));
+
+    config.the_fake_power_button()->press();
+    daemon->flush();
+}
+
+TEST_F(ADaemon, handles_more_pending_events_than_event_queue_capacity)
+{
+    using namespace testing;
+
+    auto const num_events = 2 * repowerd::DaemonEventQueue::capacity;
+
+    start_daemon();
+
+    std::promise<void> handler_blocked;
+    std::promise<void> unblock_handler;
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs(
+            [&]
+            {
+                handler_blocked.set_value();
+                unblock_handler.get_future().wait();
+            }));
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_user_activity_extending_power_state())
+        .Times(AtLeast(1));
+
+    config.the_fake_power_button()->press();
+    handler_blocked.get_future().wait();
+
+    std::thread producer{
+        [&]
+        {
+            for (size_t i = 0; i < num_events; ++i)
+                config.the_fake_user_activity()->perform(
+                    repowerd::UserActivityType::extend_power_state);
+        }};
+
+    unblock_handler.set_value();
+    producer.join();
+    daemon->flush();
+
+    auto const event_type = repowerd::DaemonEventType::user_activity_extending_power_state;
+    auto const statistics = config.the_daemon_statistics();
+    EXPECT_THAT(statistics->dispatched(event_type) + statistics->coalesced(event_type),
+                Eq(num_events));
+}
+
+TEST_F(ADaemon, does_not_block_producers_while_event_queue_is_full)
+{
+    using namespace testing;
+
+    auto const num_events = 2 * repowerd::DaemonEventQueue::capacity;
+
+    start_daemon();
+
+    std::promise<void> handler_blocked;
+    std::promise<void> unblock_handler;
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs(
+            [&]
+            {
+                handler_blocked.set_value();
+                unblock_handler.get_future().wait();
+            }));
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_user_activity_extending_power_state())
+        .Times(AtLeast(1));
+
+    config.the_fake_power_button()->press();
+    handler_blocked.get_future().wait();
+
+    // The producer must finish while the daemon is still blocked
+    std::thread producer{
+        [&]
+        {
+            for (size_t i = 0; i < num_events; ++i)
+                config.the_fake_user_activity()->perform(
+                    repowerd::UserActivityType::extend_power_state);
+        }};
+
+    producer.join();
+    unblock_handler.set_value();
+    daemon->flush();
+
+    auto const event_type = repowerd::DaemonEventType::user_activity_extending_power_state;
+    auto const statistics = config.the_daemon_statistics();
+    EXPECT_THAT(statistics->dispatched(event_type) + statistics->coalesced(event_type),
+                Eq(num_events));
+}
+
+TEST_F(ADaemon, handles_events_enqueued_beyond_capacity_from_its_own_handlers)
+{
+    using namespace testing;
+
+    auto const num_events = 2 * repowerd::DaemonEventQueue::capacity;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs(
+            [&]
+            {
+                for (size_t i = 0; i < num_events; ++i)
+                    config.the_fake_user_activity()->perform(
+                        repowerd::UserActivityType::extend_power_state);
+            }));
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_user_activity_extending_power_state())
+        .Times(AtLeast(1));
+
+    config.the_fake_power_button()->press();
+    daemon->flush();
+
+    auto const event_type = repowerd::DaemonEventType::user_activity_extending_power_state;
+    auto const statistics = config.the_daemon_statistics();
+    EXPECT_THAT(statistics->dispatched(event_type) + statistics->coalesced(event_type),
+                Eq(num_events));
+}
+
+TEST_F(ADaemon, stops_before_processing_pending_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    std::promise<void> handler_blocked;
+    std::promise<void> unblock_handler;
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs(
+            [&]
+            {
+                handler_blocked.set_value();
+                unblock_handler.get_future().wait();
+            }));
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_release())
+        .Times(0);
+
+    config.the_fake_power_button()->press();
+    handler_blocked.get_future().wait();
+    config.the_fake_power_button()->release();
+
+    daemon->stop();
+    unblock_handler.set_value();
+    daemon_thread.join();
+}
+
+TEST_F(ADaemon, coalesces_consecutive_user_activity_events)
+{
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(),
+                handle_user_activity_extending_power_state());
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            for (int i = 0; i < 5; ++i)
+            {
+                config.the_fake_user_activity()->perform(
+                    repowerd::UserActivityType::extend_power_state);
+            }
+        });
+
+    EXPECT_THAT(
+        config.the_daemon_statistics()->coalesced(
+            repowerd::DaemonEventType::user_activity_extending_power_state),
+        testing::Eq(4));
+}
+
+TEST_F(ADaemon, dispatches_last_payload_of_coalesced_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_brightness_control(), set_normal_brightness_value(_))
+        .Times(0);
+    EXPECT_CALL(*config.the_mock_brightness_control(), set_normal_brightness_value(0.7));
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_client_requests()->emit_set_normal_brightness_value(0.3);
+            config.the_fake_client_requests()->emit_set_normal_brightness_value(0.5);
+            config.the_fake_client_requests()->emit_set_normal_brightness_value(0.7);
+        });
+}
+
+TEST_F(ADaemon, does_not_coalesce_events_that_are_not_consecutive)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    Sequence s;
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_source_change())
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_notification())
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_source_change())
+        .InSequence(s);
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_power_source()->emit_power_source_change();
+            config.the_fake_notification_service()->emit_notification();
+            config.the_fake_power_source()->emit_power_source_change();
+        });
+
+    EXPECT_THAT(config.the_daemon_statistics()->total_coalesced(), Eq(0));
+}
+
+TEST_F(ADaemon, does_not_coalesce_power_button_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press()).Times(2);
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_power_button()->press();
+            config.the_fake_power_button()->press();
+        });
+
+    EXPECT_THAT(config.the_daemon_statistics()->total_coalesced(), Eq(0));
+}
+
+TEST_F(ADaemon, dispatches_interactive_events_before_queued_background_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    Sequence s;
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_brightness_control(), set_normal_brightness_value(0.5))
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_brightness_control(), disable_autobrightness())
+        .InSequence(s);
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_client_requests()->emit_set_normal_brightness_value(0.5);
+            config.the_fake_client_requests()->emit_disable_autobrightness();
+            config.the_fake_power_button()->press();
+        });
+}
+
+TEST_F(ADaemon, dispatches_critical_events_before_queued_interactive_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    Sequence s;
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_source_critical())
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .InSequence(s);
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_release())
+        .InSequence(s);
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_power_button()->press();
+            config.the_fake_power_button()->release();
+            config.the_fake_power_source()->emit_power_source_critical();
+        });
+}
+
+TEST_F(ADaemon, does_not_starve_background_events)
+{
+    using namespace testing;
+
+    int const num_interactive_events = 100;
+    std::vector<std::string> dispatched;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillRepeatedly(InvokeWithoutArgs([&] { dispatched.push_back("interactive"); }));
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_release())
+        .WillRepeatedly(InvokeWithoutArgs([&] { dispatched.push_back("interactive"); }));
+    EXPECT_CALL(*config.the_mock_brightness_control(), enable_autobrightness())
+        .WillOnce(InvokeWithoutArgs([&] { dispatched.push_back("background"); }));
+
+    emit_events_while_daemon_is_busy(
+        [&]
+        {
+            config.the_fake_client_requests()->emit_enable_autobrightness();
+            for (int i = 0; i < num_interactive_events / 2; ++i)
+            {
+                config.the_fake_power_button()->press();
+                config.the_fake_power_button()->release();
+            }
+        });
+
+    auto const background_pos =
+        std::find(dispatched.begin(), dispatched.end(), "background") - dispatched.begin();
+
+    EXPECT_THAT(dispatched.size(), Eq(num_interactive_events + 1u));
+    EXPECT_THAT(background_pos, Gt(0));
+    EXPECT_THAT(background_pos, Lt(num_interactive_events));
+}
+
+TEST_F(ADaemon, does_not_starve_background_events_behind_a_flush)
+{
+    using namespace testing;
+
+    int const num_interactive_events = 100;
+    int num_presses = 0;
+    std::vector<std::string> dispatched;
+    std::thread flusher;
+
+    start_daemon();
+
+    // Steady interactive traffic: each press is followed by another one
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillRepeatedly(InvokeWithoutArgs(
+            [&]
+            {
+                dispatched.push_back("interactive");
+                if (++num_presses < num_interactive_events)
+                    config.the_fake_power_button()->press();
+            }));
+    EXPECT_CALL(*config.the_mock_brightness_control(), enable_autobrightness())
+        .WillOnce(InvokeWithoutArgs([&] { dispatched.push_back("background"); }));
+
+    emit_events_while_daemon_is_busy(
+        [&]
+        {
+            config.the_fake_power_button()->press();
+            flusher = std::thread{[this] { daemon->flush(); }};
+            // Give the flush time to be enqueued ahead of the background event
+            std::this_thread::sleep_for(10ms);
+            config.the_fake_client_requests()->emit_enable_autobrightness();
+        });
+
+    flusher.join();
+
+    auto const background_pos =
+        std::find(dispatched.begin(), dispatched.end(), "background") - dispatched.begin();
+
+    EXPECT_THAT(dispatched.size(), Eq(num_interactive_events + 1u));
+    EXPECT_THAT(background_pos, Lt(num_interactive_events));
+}
+
+TEST_F(ADaemon, flushes_events_in_all_lanes)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_source_critical());
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press());
+    EXPECT_CALL(*config.the_mock_brightness_control(), enable_autobrightness());
+
+    config.the_fake_client_requests()->emit_enable_autobrightness();
+    config.the_fake_power_button()->press();
+    config.the_fake_power_source()->emit_power_source_critical();
+    daemon->flush();
+
+    Mock::VerifyAndClearExpectations(config.the_mock_state_machine().get());
+    Mock::VerifyAndClearExpectations(config.the_mock_brightness_control().get());
+}
+
+TEST_F(ADaemon, records_queue_and_handler_latencies_of_dispatched_events)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs([] { std::this_thread::sleep_for(10ms); }));
+
+    config.the_fake_power_button()->press();
+    daemon->flush();
+
+    auto const statistics = config.the_daemon_statistics();
+    auto const& queue_latency =
+        statistics->queue_latency(repowerd::DaemonEventType::power_button_press);
+    auto const& handler_latency =
+        statistics->handler_latency(repowerd::DaemonEventType::power_button_press);
+
+    EXPECT_THAT(queue_latency.count(), Eq(1));
+    EXPECT_THAT(handler_latency.count(), Eq(1));
+    EXPECT_THAT(handler_latency.max(), Ge(10ms));
+    EXPECT_THAT(handler_latency.percentile(50), Ge(10ms));
+}
+
+TEST_F(ADaemon, records_latencies_of_blocked_events_as_queue_latency)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    EXPECT_CALL(*config.the_mock_state_machine(), handle_power_button_press());
+
+    emit_events_while_daemon_is_busy(
+        [this]
+        {
+            config.the_fake_power_button()->press();
+            std::this_thread::sleep_for(10ms);
+        });
+
+    auto const statistics = config.the_daemon_statistics();
+
+    EXPECT_THAT(
+        statistics->queue_latency(repowerd::DaemonEventType::power_button_press).max(),
+        Ge(10ms));
+    EXPECT_THAT(
+        statistics->handler_latency(repowerd::DaemonEventType::alarm).max(),
+        Ge(10ms));
+}
+
+TEST_F(ADaemon, records_enqueued_events_in_event_trace)
+{
+    using namespace testing;
+
+    start_daemon();
+
+    config.the_fake_power_button()->press();
+    config.the_fake_client_requests()->emit_set_normal_brightness_value(0.5);
+    daemon->flush();
+
+    auto const events = config.the_fake_daemon_event_trace()->recorded_events();
+
+    ASSERT_THAT(events.size(), Eq(2));
+    EXPECT_THAT(events[0].type, Eq(repowerd::DaemonEventType::power_button_press));
+    EXPECT_THAT(events[1].type, Eq(repowerd::DaemonEventType::set_normal_brightness_value));
+    EXPECT_THAT(events[1].brightness_value, Eq(0.5));
+    EXPECT_THAT(events[0].enqueue_time, Le(events[1].enqueue_time));
+}
+
+TEST_F(ADaemon, reports_stalled_handlers)
+{
+    using namespace testing;
+
+    struct DaemonConfigWithShortHandlerStallBudget : DaemonConfigWithMockStateMachine
+    {
+        std::chrono::milliseconds handler_stall_budget() override { return 20ms; }
+    };
+    DaemonConfigWithShortHandlerStallBudget config_with_short_budget;
+
+    start_daemon_with_config(config_with_short_budget);
+
+    EXPECT_CALL(*config_with_short_budget.the_mock_state_machine(),
+                handle_power_button_press())
+        .WillOnce(InvokeWithoutArgs([] { std::this_thread::sleep_for(200ms); }));
+
+    config_with_short_budget.the_fake_power_button()->press();
+    daemon->flush();
+
+    EXPECT_THAT(
+        config_with_short_budget.the_daemon_statistics()->stalls(
+            repowerd::DaemonEventType::power_button_press),
+        Eq(1));
+    EXPECT_TRUE(
+        config_with_short_budget.the_fake_log()->contains_line(
+            {"power_button_press", "stalled"}));
+
+    stop_daemon();
+}
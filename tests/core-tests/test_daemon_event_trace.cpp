@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/core/daemon_event_trace.h"
+
+#include <stdexcept>
+
+#include <gmock/gmock.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+repowerd::DaemonEvent round_trip(repowerd::DaemonEvent const& event)
+{
+    return repowerd::daemon_event_for(repowerd::daemon_event_trace_record_for(event));
+}
+
+std::chrono::steady_clock::time_point const timestamp{123456789ns};
+
+}
+
+TEST(ADaemonEventTrace, has_valid_header)
+{
+    EXPECT_TRUE(repowerd::is_valid_daemon_event_trace_header(
+        repowerd::daemon_event_trace_header()));
+}
+
+TEST(ADaemonEventTrace, rejects_header_with_different_record_size)
+{
+    auto header = repowerd::daemon_event_trace_header();
+    header.record_size += 1;
+
+    EXPECT_FALSE(repowerd::is_valid_daemon_event_trace_header(header));
+}
+
+TEST(ADaemonEventTrace, round_trips_type_and_timestamp)
+{
+    repowerd::DaemonEvent event{repowerd::DaemonEventType::power_button_press};
+    event.enqueue_time = timestamp;
+
+    auto const read = round_trip(event);
+
+    EXPECT_THAT(read.type, Eq(repowerd::DaemonEventType::power_button_press));
+    EXPECT_THAT(read.enqueue_time, Eq(timestamp));
+}
+
+TEST(ADaemonEventTrace, round_trips_payloads)
+{
+    auto const alarm = round_trip(repowerd::DaemonEvent::alarm(42));
+    auto const timeout = round_trip(repowerd::DaemonEvent::set_inactivity_timeout(30s));
+    auto const brightness = round_trip(repowerd::DaemonEvent::set_normal_brightness_value(0.25));
+    auto const transition =
+        round_trip(repowerd::DaemonEvent::brightness_transition_complete(7));
+
+    EXPECT_THAT(alarm.alarm_id, Eq(42));
+    EXPECT_THAT(timeout.timeout_ms, Eq(30000));
+    EXPECT_THAT(brightness.brightness_value, Eq(0.25));
+    EXPECT_THAT(transition.brightness_transition_id, Eq(7u));
+}
+
+TEST(ADaemonEventTrace, rejects_records_of_untraceable_events)
+{
+    auto record = repowerd::daemon_event_trace_record_for(
+        repowerd::DaemonEvent::flush(nullptr));
+
+    EXPECT_THROW(repowerd::daemon_event_for(record), std::invalid_argument);
+
+    record.type = 1000;
+
+    EXPECT_THROW(repowerd::daemon_event_for(record), std::invalid_argument);
+}
@@ -136,3 +136,57 @@ TEST_F(AFakeTimer, does_not_notify_for_cancelled_alarms)
 
     fake_timer.advance_by(30s);
 }
+
+TEST_F(AFakeTimer, reports_time_of_next_alarm)
+{
+    auto const start = fake_timer.now();
+
+    fake_timer.schedule_alarm_in(20s);
+    auto const id = fake_timer.schedule_alarm_in(10s);
+    fake_timer.schedule_alarm_in(30s);
+
+    EXPECT_THAT(fake_timer.next_alarm_time(), testing::Eq(start + 10s));
+
+    fake_timer.cancel_alarm(id);
+
+    EXPECT_THAT(fake_timer.next_alarm_time(), testing::Eq(start + 20s));
+}
+
+TEST_F(AFakeTimer, reports_max_time_when_no_alarm_is_scheduled)
+{
+    EXPECT_THAT(fake_timer.next_alarm_time(),
+                testing::Eq(std::chrono::steady_clock::time_point::max()));
+}
+
+TEST_F(AFakeTimer, reports_fired_alarms_as_consumable_once)
+{
+    using namespace testing;
+
+    auto const id = fake_timer.schedule_alarm_in(10s);
+    EXPECT_CALL(*this, alarm_handler(id));
+
+    fake_timer.advance_by(10s);
+
+    EXPECT_TRUE(fake_timer.consume_fired_alarm(id));
+    EXPECT_FALSE(fake_timer.consume_fired_alarm(id));
+}
+
+TEST_F(AFakeTimer, reports_alarms_cancelled_after_firing_as_stale)
+{
+    using namespace testing;
+
+    auto const id = fake_timer.schedule_alarm_in(10s);
+    EXPECT_CALL(*this, alarm_handler(id));
+
+    fake_timer.advance_by(10s);
+    fake_timer.cancel_alarm(id);
+
+    EXPECT_FALSE(fake_timer.consume_fired_alarm(id));
+}
+
+TEST_F(AFakeTimer, does_not_report_unfired_alarms_as_consumable)
+{
+    auto const id = fake_timer.schedule_alarm_in(10s);
+
+    EXPECT_FALSE(fake_timer.consume_fired_alarm(id));
+}
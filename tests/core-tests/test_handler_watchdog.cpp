@@ -0,0 +1,133 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/core/daemon_statistics.h"
+#include "src/core/handler_watchdog.h"
+#include "src/core/infinite_timeout.h"
+
+#include "fake_log.h"
+#include "fake_shared.h"
+#include "spin_wait.h"
+
+#include <thread>
+
+#include <gmock/gmock.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+namespace rt = repowerd::test;
+
+namespace
+{
+
+struct AHandlerWatchdog : Test
+{
+    AHandlerWatchdog()
+    {
+        watchdog.start();
+    }
+
+    void run_handler_for(
+        repowerd::DaemonEventType type, std::chrono::milliseconds duration)
+    {
+        watchdog.handler_started(type);
+        std::this_thread::sleep_for(duration);
+        watchdog.handler_finished();
+    }
+
+    std::chrono::milliseconds const stall_budget{20ms};
+    std::chrono::milliseconds const stall_duration{200ms};
+    std::chrono::milliseconds const default_timeout{3s};
+
+    repowerd::DaemonStatistics daemon_statistics;
+    rt::FakeLog fake_log;
+    repowerd::HandlerWatchdog watchdog{
+        rt::fake_shared(daemon_statistics),
+        rt::fake_shared(fake_log),
+        stall_budget};
+};
+
+}
+
+TEST_F(AHandlerWatchdog, counts_handlers_running_longer_than_budget_as_stalls)
+{
+    run_handler_for(repowerd::DaemonEventType::power_button_press, stall_duration);
+
+    EXPECT_THAT(daemon_statistics.stalls(repowerd::DaemonEventType::power_button_press),
+                Eq(1));
+    EXPECT_THAT(daemon_statistics.total_stalls(), Eq(1));
+}
+
+TEST_F(AHandlerWatchdog, does_not_count_handlers_within_budget)
+{
+    for (int i = 0; i < 10; ++i)
+        run_handler_for(repowerd::DaemonEventType::power_button_press, 0ms);
+
+    std::this_thread::sleep_for(stall_budget * 2);
+
+    EXPECT_THAT(daemon_statistics.total_stalls(), Eq(0));
+}
+
+TEST_F(AHandlerWatchdog, counts_each_stalled_handler_once)
+{
+    run_handler_for(repowerd::DaemonEventType::alarm, stall_duration);
+    run_handler_for(repowerd::DaemonEventType::proximity_far, stall_duration);
+
+    EXPECT_THAT(daemon_statistics.stalls(repowerd::DaemonEventType::alarm), Eq(1));
+    EXPECT_THAT(daemon_statistics.stalls(repowerd::DaemonEventType::proximity_far), Eq(1));
+    EXPECT_THAT(daemon_statistics.total_stalls(), Eq(2));
+}
+
+TEST_F(AHandlerWatchdog, logs_event_type_and_backtrace_of_stalled_handler)
+{
+    run_handler_for(repowerd::DaemonEventType::power_button_press, stall_duration);
+
+    EXPECT_TRUE(fake_log.contains_line({"power_button_press", "stalled"}));
+    EXPECT_TRUE(fake_log.contains_line({"Backtrace"}));
+    EXPECT_TRUE(fake_log.contains_line({"#0"}));
+}
+
+TEST_F(AHandlerWatchdog, logs_recovery_of_stalled_handler)
+{
+    run_handler_for(repowerd::DaemonEventType::power_button_press, stall_duration);
+
+    auto const result = rt::spin_wait_for_condition_or_timeout(
+        [this] { return fake_log.contains_line({"power_button_press", "recovered"}); },
+        default_timeout);
+
+    EXPECT_TRUE(result);
+}
+
+TEST(AHandlerWatchdogWithInfiniteBudget, never_reports_stalls)
+{
+    repowerd::DaemonStatistics daemon_statistics;
+    rt::FakeLog fake_log;
+    repowerd::HandlerWatchdog watchdog{
+        rt::fake_shared(daemon_statistics),
+        rt::fake_shared(fake_log),
+        repowerd::infinite_timeout};
+
+    watchdog.start();
+    watchdog.handler_started(repowerd::DaemonEventType::alarm);
+    std::this_thread::sleep_for(50ms);
+    watchdog.handler_finished();
+    watchdog.stop();
+
+    EXPECT_THAT(daemon_statistics.total_stalls(), Eq(0));
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2016 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by: Alexandros Frantzis <alexandros.frantzis@canonical.com>
+ */
+
+#include "src/core/latency_histogram.h"
+
+#include <chrono>
+
+#include <gmock/gmock.h>
+
+using namespace testing;
+using namespace std::chrono_literals;
+
+TEST(ALatencyHistogram, is_initially_empty)
+{
+    repowerd::LatencyHistogram histogram;
+
+    EXPECT_THAT(histogram.count(), Eq(0));
+    EXPECT_THAT(histogram.max(), Eq(0us));
+    EXPECT_THAT(histogram.percentile(50), Eq(0us));
+}
+
+TEST(ALatencyHistogram, counts_recorded_values)
+{
+    repowerd::LatencyHistogram histogram;
+
+    histogram.record(5us);
+    histogram.record(100ms);
+    histogram.record(3s);
+
+    EXPECT_THAT(histogram.count(), Eq(3));
+    EXPECT_THAT(histogram.max(), Eq(3s));
+}
+
+TEST(ALatencyHistogram, maps_small_values_to_exact_buckets)
+{
+    for (uint64_t v = 0; v < 2 * repowerd::LatencyHistogram::sub_buckets; ++v)
+    {
+        auto const bucket = repowerd::LatencyHistogram::bucket_for(v);
+        EXPECT_THAT(repowerd::LatencyHistogram::bucket_lower_bound(bucket), Eq(v));
+    }
+}
+
+TEST(ALatencyHistogram, maps_values_to_buckets_with_bounded_relative_error)
+{
+    for (uint64_t v = 1; v < 10000000; v = v * 3 / 2 + 1)
+    {
+        auto const bucket = repowerd::LatencyHistogram::bucket_for(v);
+        auto const lower = repowerd::LatencyHistogram::bucket_lower_bound(bucket);
+        auto const upper = repowerd::LatencyHistogram::bucket_lower_bound(bucket + 1);
+
+        EXPECT_THAT(v, AllOf(Ge(lower), Lt(upper)));
+        EXPECT_THAT(upper - lower, Le(std::max<uint64_t>(1, v / repowerd::LatencyHistogram::sub_buckets)));
+    }
+}
+
+TEST(ALatencyHistogram, clamps_huge_values_to_last_bucket)
+{
+    EXPECT_THAT(repowerd::LatencyHistogram::bucket_for(UINT64_MAX),
+                Eq(repowerd::LatencyHistogram::num_buckets - 1));
+}
+
+TEST(ALatencyHistogram, reports_percentiles)
+{
+    repowerd::LatencyHistogram histogram;
+
+    for (int i = 0; i < 90; ++i)
+        histogram.record(10us);
+    for (int i = 0; i < 10; ++i)
+        histogram.record(1000us);
+
+    EXPECT_THAT(histogram.percentile(50), Eq(10us));
+    EXPECT_THAT(histogram.percentile(90), Eq(10us));
+    EXPECT_THAT(histogram.percentile(99), Eq(1000us));
+    EXPECT_THAT(histogram.percentile(100), Eq(1000us));
+}
+
+TEST(ALatencyHistogram, reports_percentiles_within_bucket_precision)
+{
+    repowerd::LatencyHistogram histogram;
+
+    histogram.record(1234us);
+
+    EXPECT_THAT(histogram.percentile(50), AllOf(Ge(1234us), Le(1234us * 9 / 8)));
+}
+
+TEST(ALatencyHistogram, ignores_negative_durations)
+{
+    repowerd::LatencyHistogram histogram;
+
+    histogram.record(-5us);
+
+    EXPECT_THAT(histogram.count(), Eq(1));
+    EXPECT_THAT(histogram.max(), Eq(0us));
+}